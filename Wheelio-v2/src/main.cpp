@@ -2,22 +2,26 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "filter_bank.h"
 #include "light_sensor.h"
 #include "mpu6050_sensor.h"
 #include "lidar_sensor.h"
+#include "json_writer.h"
+#include "rtdb_client.h"
+#include "runtime_config.h"
+#include "warning_rules.h"
+#include "wifi_portal.h"
 
 #include "actuators.h"
-#include <WiFiManager.h>
+#include <WiFi.h>
 #include <FirebaseESP32.h>
 #include <NTPClient.h>
 #include <WiFiUdp.h>
 
-// WiFiManager and button
+// Boot button: opens the WiFi config portal
 #define BUTTON_PIN 0 // ESP32 boot button (GPIO0)
-WiFiManager wm;
 
 // Firebase
-FirebaseData fbdo;
 FirebaseAuth auth;
 FirebaseConfig config;
 
@@ -25,31 +29,37 @@ FirebaseConfig config;
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, NTP_SERVER, GMT_OFFSET_SEC, 60000);
 
-void setup()
-{
-  Serial.begin(115200);
-  while (!Serial)
-    delay(10);
+// Set by networkTask once WiFi, NTP and Firebase are set up
+volatile bool networkReady = false;
 
-  pinMode(BUTTON_PIN, INPUT_PULLUP);
-
-  if (DEBUG_MODE)
-    Serial.println("Wheelio System Booting...");
+// Services the config portal while it is open, off the sensor loop: a
+// portal page load runs a WiFi scan that can take seconds
+void portalTask(void *pvParameters)
+{
+  for (;;)
+  {
+    wifiPortalPoll();
+    vTaskDelay(WIFI_PORTAL_POLL_MS / portTICK_PERIOD_MS);
+  }
+}
 
-  // WiFiManager: always open config portal on boot
-  if (DEBUG_MODE)
-    Serial.println("Starting WiFiManager config portal on boot...");
-  wm.setConfigPortalTimeout(180);
-  wm.startConfigPortal(WIFI_AP_NAME, WIFI_AP_PASSWORD);
-  if (DEBUG_MODE)
+// Boot's network half: the saved network (or the config portal, in the
+// background, if there is none; the boot button opens it later), then NTP
+// and Firebase. NTP syncs from loop(); nothing here waits for it.
+void networkTask(void *pvParameters)
+{
+  bool wifiConnected = wifiPortalBegin();
+  xTaskCreatePinnedToCore(portalTask, "portal", 8192, NULL,
+                          WIFI_PORTAL_TASK_PRIORITY, NULL, 0);
+  if (DEBUG_MODE && wifiConnected)
+  {
     Serial.print("WiFi connected: ");
-  if (DEBUG_MODE)
     Serial.println(WiFi.localIP());
+  }
+  else if (DEBUG_MODE)
+    Serial.println("No saved WiFi network, config portal open.");
 
-  // NTP
   timeClient.begin();
-  while (!timeClient.update())
-    timeClient.forceUpdate();
 
   // Firebase (modern auth)
   config.api_key = API_KEY;
@@ -58,99 +68,127 @@ void setup()
   auth.user.password = PASSWORD;
   Firebase.begin(&config, &auth);
   Firebase.reconnectWiFi(true);
+  rtdbInit();
+
+  networkReady = true;
+  if (DEBUG_MODE)
+    Serial.printf("Boot: network set up at %lu ms\n", millis());
+  vTaskDelete(NULL);
+}
 
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10);
+
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+
+  if (DEBUG_MODE)
+    Serial.println("Wheelio System Booting...");
+
+  // Safety first: actuators off and sensors running before any network
+  // wait, so the warnings work from the first loop()
+  actuatorsInit();
   lightSensorInit();
   mpu6050Init();
   lidarInit();
-  actuatorsInit();
+  if (DEBUG_MODE)
+    Serial.printf("Boot: sensors and actuators up at %lu ms\n", millis());
+
+  // WiFi, NTP and Firebase come up in the background
+  xTaskCreatePinnedToCore(networkTask, "network", 8192, NULL, 1, NULL, 0);
 }
 
 void loop()
 {
   // ...existing code...
 
+  static bool buttonWasDown = false;
+  bool buttonDown = digitalRead(BUTTON_PIN) == LOW;
+  if (buttonDown && !buttonWasDown)
+    wifiPortalRequest();
+  buttonWasDown = buttonDown;
+
   // --- Smoothing filter state (static persists across calls) ---
-  static float lumensSmooth = 0;
-  static float distanceSmooth = 0;
-  static float accelXSmooth = 0, tiltSideSmooth = 0, tiltFBSmooth = 0;
-  static bool firstRun = true;
+  enum { LUMENS, DISTANCE, ACCEL_X, TILT_SIDE, TILT_FB, CHANNELS };
+  static FilterBank<CHANNELS> smooth(SMOOTHING_ALPHA);
 
   // Read raw sensors
   float lumensRaw = readLightLevel();
   int distanceRaw = readLidarDistance();
   MpuData mpuRaw = readMpuData();
 
-  // Initialize smoothing on first run
-  if (firstRun)
-  {
-    lumensSmooth = lumensRaw;
-    distanceSmooth = distanceRaw;
-    accelXSmooth = mpuRaw.accelX;
-    tiltSideSmooth = mpuRaw.tiltSide;
-    tiltFBSmooth = mpuRaw.tiltFB;
-    firstRun = false;
-  }
-  else
-  {
-    lumensSmooth = SMOOTHING_ALPHA * lumensRaw + (1.0f - SMOOTHING_ALPHA) * lumensSmooth;
-    distanceSmooth = SMOOTHING_ALPHA * distanceRaw + (1.0f - SMOOTHING_ALPHA) * distanceSmooth;
-    accelXSmooth = SMOOTHING_ALPHA * mpuRaw.accelX + (1.0f - SMOOTHING_ALPHA) * accelXSmooth;
-    tiltSideSmooth = SMOOTHING_ALPHA * mpuRaw.tiltSide + (1.0f - SMOOTHING_ALPHA) * tiltSideSmooth;
-    tiltFBSmooth = SMOOTHING_ALPHA * mpuRaw.tiltFB + (1.0f - SMOOTHING_ALPHA) * tiltFBSmooth;
-  }
-
-  // Use smoothed values for logic
-  bool warnLidar = (distanceSmooth > 0 && distanceSmooth < DIST_THRESHOLD);
-  bool warnAccel = fabs(accelXSmooth) > ACCEL_THRESHOLD;
-  bool warnTiltSide = fabs(tiltSideSmooth) > TILT_SIDE_THRESHOLD;
-  bool warnTiltFB = fabs(tiltFBSmooth) > TILT_FB_THRESHOLD;
-  bool warnMpu = warnAccel || warnTiltSide || warnTiltFB;
-  bool alert = warnLidar || warnMpu;
+  // The first reading seeds each channel
+  const float raw[CHANNELS] = {lumensRaw, (float)distanceRaw, mpuRaw.accelX,
+                               mpuRaw.tiltSide, mpuRaw.tiltFB};
+  smooth.update(raw);
+  float lumensSmooth = smooth.getValue(LUMENS);
+  float distanceSmooth = smooth.getValue(DISTANCE);
+  float accelXSmooth = smooth.getValue(ACCEL_X);
+  float tiltSideSmooth = smooth.getValue(TILT_SIDE);
+  float tiltFBSmooth = smooth.getValue(TILT_FB);
+
+  // Use smoothed values for logic, against one config snapshot
+  const RuntimeConfig &cfg = configAcquire();
+  SensorData data;
+  data.lumensRaw = lumensSmooth;
+  data.distanceRaw = distanceSmooth;
+  data.accelXRaw = accelXSmooth;
+  data.tiltSideRaw = tiltSideSmooth;
+  data.tiltFBRaw = tiltFBSmooth;
+  static WarningRules rules;
+  ActuatorState state =
+      actuatorsFor(rules.evaluate(data, cfg, millis() * 1000ULL));
 
   // Relay 16: LED strip 1 ON only when lumens < threshold
-  bool fogOn = lumensSmooth < LIGHT_THRESHOLD;
-  setFogLight(fogOn);
+  setFogLight(state.fogLight);
   if (DEBUG_MODE)
   {
     Serial.print("[Relay] LED Strip 1 (pin 16): ");
-    Serial.println(fogOn ? "ON" : "OFF");
+    Serial.println(state.fogLight ? "ON" : "OFF");
   }
 
-  // Relay 17: LED strip 2 + buzzer ON only when alert is active
-  setWarningLight(alert);
-  setBuzzer(alert);
+  // Relay 17: LED strip 2 on any warning, buzzer on MPU warnings
+  setWarningLight(state.warningLight);
+  setBuzzer(state.buzzer);
   if (DEBUG_MODE)
   {
     Serial.print("[Relay] LED Strip 2 + Buzzer (pin 17): ");
-    Serial.println(alert ? "ON" : "OFF");
+    Serial.println(warningMessage(state.rules));
   }
 
-  // Non-blocking upload/print every 1 second
+  // Non-blocking upload/print every 1 second, once the network is set up
+  // and NTP has the time
   static unsigned long lastUpload = 0;
   unsigned long now = millis();
-  if (now - lastUpload >= 1000)
+  if (networkReady && now - lastUpload >= 1000)
   {
     lastUpload = now;
     timeClient.update();
+    if (!timeClient.isTimeSet())
+      return;
     unsigned long epoch = timeClient.getEpochTime();
     struct tm *tm_info = gmtime((time_t *)&epoch);
     char timestamp[20];
     strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", tm_info);
 
-    // Firebase upload
-    String path = String(FIREBASE_SENSOR_PATH);
-    path.concat("/");
-    path.concat(timestamp);
-    FirebaseJson json;
-    json.set("lumens", lumensSmooth);
-    json.set("distance", distanceSmooth);
-    json.set("accelX", accelXSmooth);
-    json.set("tiltSide", tiltSideSmooth);
-    json.set("tiltFB", tiltFBSmooth);
-    json.set("fogOn", fogOn);
-    json.set("warning", alert);
-    json.set("buzzer", warnMpu);
-    json.set("timestamp", timestamp);
+    // Firebase upload, serialized into a static buffer (no heap)
+    char path[48];
+    snprintf(path, sizeof(path), "%s/%s", FIREBASE_SENSOR_PATH, timestamp);
+    static char body[256];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject()
+        .field("lumens", lumensSmooth)
+        .field("distance", distanceSmooth)
+        .field("accelX", accelXSmooth)
+        .field("tiltSide", tiltSideSmooth)
+        .field("tiltFB", tiltFBSmooth)
+        .field("fogOn", state.fogLight)
+        .field("warning", state.warningLight)
+        .field("buzzer", state.buzzer)
+        .field("timestamp", timestamp)
+        .endObject();
     if (DEBUG_MODE)
     {
       Serial.print("[DEBUG] WiFi status (loop): ");
@@ -160,7 +198,8 @@ void loop()
     }
     if (Firebase.ready())
     {
-      bool fbResult = Firebase.setJSON(fbdo, path.c_str(), json);
+      bool fbResult =
+          json.ok() && rtdbWrite(RTDB_PUT, path, json.c_str(), json.length());
       if (DEBUG_MODE)
       {
         Serial.print("[DEBUG] Firebase upload status: ");
@@ -168,7 +207,7 @@ void loop()
         if (!fbResult)
         {
           Serial.print("[DEBUG] Firebase error: ");
-          Serial.println(fbdo.errorReason());
+          Serial.println(rtdbLastError());
         }
       }
     }
@@ -191,11 +230,11 @@ void loop()
       Serial.print(" | TiltFB: ");
       Serial.print(tiltFBSmooth);
       Serial.print(" | Fog: ");
-      Serial.print(fogOn);
+      Serial.print(state.fogLight);
       Serial.print(" | Warn: ");
-      Serial.print(alert);
+      Serial.print(state.warningLight);
       Serial.print(" | Buzzer: ");
-      Serial.print(warnMpu);
+      Serial.print(state.buzzer);
       Serial.print(" | Time: ");
       Serial.println(timestamp);
     }
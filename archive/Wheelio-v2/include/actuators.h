@@ -1,6 +1,6 @@
 #ifndef ACTUATORS_H
 #define ACTUATORS_H
-#include <Arduino.h>
+#include <stdint.h>
 
 void actuatorsInit();
 void setFogLight(bool on);
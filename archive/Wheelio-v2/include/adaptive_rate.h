@@ -0,0 +1,38 @@
+#ifndef ADAPTIVE_RATE_H
+#define ADAPTIVE_RATE_H
+#include "control.h"
+#include "runtime_config.h"
+#include <stdint.h>
+
+// Picks the control period from how close the readings are to their
+// warning thresholds, now or ADAPTIVE_LOOKAHEAD_MS ahead at their current
+// rate of change. Proximity is 0 far from every trigger and 1 at one: tilt
+// as |tilt| / threshold, distance as how far it has closed from
+// LIDAR_MAX_RANGE_CM towards the threshold. At cfg.fastProximity or above
+// (or while warning) the loop runs every cfg.fastPeriodMs; at
+// cfg.idleProximity or below it backs off towards cfg.idlePeriodMs, and in
+// between the period is interpolated. Speeding up is immediate; slowing
+// down stretches the period by at most ADAPTIVE_BACKOFF per tick.
+class AdaptiveRate {
+public:
+  AdaptiveRate();
+
+  // After each tick: returns the period until the next one, in ms
+  uint32_t update(const SensorData &data, const ActuatorState &state,
+                  const RuntimeConfig &cfg, uint64_t nowUs);
+
+  uint32_t periodMs() const { return (uint32_t)period; }
+  float proximity() const { return lastProximity; }
+  // Backed off all the way (never when the two periods are equal)
+  bool idle(const RuntimeConfig &cfg) const {
+    return cfg.idlePeriodMs > cfg.fastPeriodMs && period >= cfg.idlePeriodMs;
+  }
+
+private:
+  float period; // ms
+  float lastProximity;
+  float lastTiltSide, lastTiltFB, lastDistance;
+  uint64_t lastUs;
+};
+
+#endif
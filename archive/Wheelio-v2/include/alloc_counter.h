@@ -0,0 +1,12 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+#include <stdint.h>
+
+// Heap allocations since boot, to check that periodic paths such as the
+// upload stay allocation-free. The native build counts operator new; the
+// board counts malloc/calloc/realloc when built with [env:esp32-allocs]
+// (the calls are wrapped at link time) and reports 0 otherwise.
+uint32_t allocCount();
+bool allocCountEnabled();
+
+#endif
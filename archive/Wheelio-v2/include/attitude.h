@@ -0,0 +1,40 @@
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+#include "mpu6050_sensor.h"
+#include <stdint.h>
+
+// Mahony attitude filter: integrates the gyro into a quaternion and pulls
+// it toward the accelerometer's gravity direction with a PI correction.
+// The gyro gives the lean without lag; the accelerometer only removes
+// drift, so the correction is skipped for samples whose magnitude is far
+// from 1 g (bumps, braking).
+//
+// Tilt is reported with the same axes and signs as atan2 of the
+// accelerometer: tiltSide = atan2(ay, az), tiltFB = atan2(ax, az), both
+// taken on the estimated gravity vector.
+class AttitudeEstimator {
+public:
+  // kp: accel correction gain (1/s), ki: gyro bias gain, accelGate:
+  // tolerated relative deviation of |a| from 1 g
+  AttitudeEstimator(float kp, float ki, float accelGate);
+
+  // The first frame seeds the attitude from the accelerometer
+  void update(const ImuFrame &frame);
+  void reset();
+
+  float tiltSide() const; // degrees
+  float tiltFB() const;   // degrees
+  uint32_t rejectedAccel() const { return rejected; }
+
+private:
+  float q0, q1, q2, q3;
+  float biasX, biasY, biasZ; // integral term, rad/s
+  float kp, ki, accelGate;
+  uint64_t lastUs;
+  bool seeded;
+  uint32_t rejected;
+
+  void seed(const ImuFrame &frame);
+};
+
+#endif
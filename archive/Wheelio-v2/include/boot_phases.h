@@ -0,0 +1,30 @@
+#ifndef BOOT_PHASES_H
+#define BOOT_PHASES_H
+#include <stdint.h>
+
+// When each stage of the boot finished, in ms since power-on. setup()
+// brings up the safety path in order (config, actuators, sensors) and
+// starts the control task; the network stages then come up in the
+// background, in bootTask, and are reached in whatever order the network
+// allows. Each phase is logged as it completes.
+
+enum BootPhase {
+  BOOT_CONFIG,     // last-known config loaded from NVS
+  BOOT_ACTUATORS,  // relays and buzzer driven off
+  BOOT_SENSORS,    // light, IMU and lidar running
+  BOOT_FIRST_TICK, // first control decision written to the actuators
+  BOOT_WIFI,       // joined a network, or opened the config portal
+  BOOT_TIME,       // SNTP set the wall clock
+  BOOT_CLOUD,      // Firebase signed in
+  BOOT_STREAM,     // /parameters stream subscribed
+  BOOT_PHASES,
+};
+
+// Record that `phase` is done; later calls for the same phase are ignored.
+// Safe from any task.
+void bootPhaseDone(BootPhase phase);
+// When `phase` finished, or 0 if it has not yet
+uint32_t bootPhaseMs(BootPhase phase);
+const char *bootPhaseName(BootPhase phase);
+
+#endif
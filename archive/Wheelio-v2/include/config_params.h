@@ -0,0 +1,56 @@
+#ifndef CONFIG_PARAMS_H
+#define CONFIG_PARAMS_H
+#include "runtime_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Runtime tunables, set from /parameters in the RTDB. Adding one is a
+// field in RuntimeConfig plus a single line in CONFIG_PARAMS
+// (config_params.cpp).
+
+#define PARAM_PERSIST 0x01 // saved to NVS
+
+struct ParamDescriptor {
+  const char *name; // key under /parameters
+  float RuntimeConfig::*field;
+  float minValue;
+  float maxValue;
+  uint8_t flags;
+};
+
+extern const ParamDescriptor CONFIG_PARAMS[];
+extern const size_t CONFIG_PARAM_COUNT;
+
+enum ParamResult {
+  PARAM_APPLIED,
+  PARAM_UNCHANGED,
+  PARAM_UNKNOWN,
+  PARAM_OUT_OF_RANGE,
+  PARAM_BAD_VALUE,
+};
+
+// NULL if no parameter has this name (name need not be NUL-terminated)
+const ParamDescriptor *configFindParam(const char *name, size_t length);
+// Sets the draft value; the control loop sees it after configPublish()
+ParamResult configSetParam(const ParamDescriptor &param, float value);
+float configParamValue(const ParamDescriptor &param);
+
+struct ConfigEventResult {
+  uint8_t applied;
+  uint8_t unchanged;
+  uint8_t rejected; // unknown key, out of range or not a number
+  bool persistChanged;
+};
+
+typedef void (*ParamChangeFn)(const ParamDescriptor &param, ParamResult result,
+                              float value);
+
+// Applies one RTDB stream event on /parameters: path "/" carries an object
+// of keys (the whole document on connect, or a patch), "/<KEY>" a single
+// number. Keys that are absent or null keep their current value. onChange,
+// if set, is called for every key that was applied or rejected. Everything
+// an event applied is published together.
+ConfigEventResult configApplyEvent(const char *path, const char *data,
+                                   ParamChangeFn onChange = NULL);
+
+#endif
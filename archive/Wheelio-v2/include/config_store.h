@@ -0,0 +1,30 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+#include "runtime_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Every PARAM_PERSIST value in CONFIG_PARAMS as one versioned, checksummed
+// blob: a header followed by (FNV-1a hash of the key name, value) pairs.
+// Keys are matched by hash, so adding, removing or reordering rows in the
+// table keeps the other values; bump CONFIG_BLOB_VERSION only when the
+// layout itself changes.
+#define CONFIG_BLOB_VERSION 1
+#define CONFIG_BLOB_MAX_PARAMS 32
+#define CONFIG_BLOB_MAX_BYTES (12 + CONFIG_BLOB_MAX_PARAMS * 8)
+
+// Returns the blob length (0 if it does not fit). Serializes the draft
+// unless given another config, such as a tick's snapshot.
+size_t configSerialize(uint8_t *out, size_t capacity,
+                       const RuntimeConfig &from = configDraft());
+// Applies every known, in-range value. Returns false and changes nothing
+// if the blob is truncated, fails its CRC or has another version.
+bool configDeserialize(const uint8_t *data, size_t length);
+
+// Board: the blob lives under one NVS key. Load once at boot, before
+// anything reads the parameters; save is a no-op when nothing changed
+// since the last load or save.
+bool configLoad();
+bool configSave();
+
+#endif
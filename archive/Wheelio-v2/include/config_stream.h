@@ -0,0 +1,12 @@
+#ifndef CONFIG_STREAM_H
+#define CONFIG_STREAM_H
+
+// Subscribes to /parameters over the RTDB event stream. The stream delivers
+// the whole document on connect and then only the keys that change, so an
+// update reaches the bike within about a second and an idle stream costs
+// only the server's keep-alives. Changes are applied through
+// configApplyEvent(); onPersist runs in the stream task after an event
+// changed a PARAM_PERSIST value and returns false if saving failed.
+bool configStreamBegin(bool (*onPersist)());
+
+#endif
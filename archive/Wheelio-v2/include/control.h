@@ -0,0 +1,85 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+#include "config.h"
+#include "filter_bank.h"
+#include "lidar_sensor.h"
+#include "mpu6050_sensor.h"
+#include "runtime_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// One raw acquisition from every sensor, stamped when it was read.
+struct RawSample {
+  uint64_t timestampUs;
+  float lumens;
+  // Lidar ranges completed since the previous tick, oldest first
+  LidarSample lidar[LIDAR_MAX_SAMPLES_PER_TICK];
+  uint8_t lidarCount;
+  MpuData mpu;
+};
+
+// Filtered and adjusted values shared with the uploader.
+struct SensorData {
+  float lumensRaw;
+  float distanceRaw;
+  float accelXRaw, tiltSideRaw, tiltFBRaw;
+};
+
+// Which sensors raised the warning, as uploaded in each entry's "warning"
+// (warningMessage() in warning_rules.h)
+enum WarningKind {
+  WARNING_NONE,
+  WARNING_LIDAR,
+  WARNING_MPU,
+  WARNING_LIDAR_MPU,
+};
+extern const char *const WARNING_MESSAGES[];
+
+struct ActuatorState {
+  bool fogLight;
+  bool warningLight;
+  bool buzzer;
+  uint8_t rules; // RuleBit mask (warning_rules.h) the relays were set from
+};
+
+// Channels of sensorFilters, in SensorData order
+enum SensorChannel {
+  CHANNEL_LIGHT,
+  CHANNEL_LIDAR,
+  CHANNEL_ACCEL_X,
+  CHANNEL_TILT_SIDE,
+  CHANNEL_TILT_FB,
+  SENSOR_CHANNELS,
+};
+extern FilterBank<SENSOR_CHANNELS> sensorFilters;
+
+// Control pipeline stages: sensor -> FilterBank -> threshold -> actuator.
+// controlTick() runs all of them against one configAcquire() snapshot,
+// records each stage's latency (latency.h) and picks the period until the
+// next tick (adaptive_rate.h).
+void controlAcquire(RawSample &raw);
+// Sensor health from what the acquisition brought (sensor_health.h);
+// starts a background re-initialization of a failed sensor when one is due
+void controlCheckHealth(const RawSample &raw);
+void controlFilter(const RawSample &raw, const RuntimeConfig &cfg,
+                   SensorData &out);
+// Evaluates the warning rules once (warning_rules.h), leaving out the
+// rules of failed sensors; rule state carries over between calls
+ActuatorState controlDecide(const SensorData &data, const RuntimeConfig &cfg,
+                            uint64_t nowUs);
+void controlActuate(const ActuatorState &state);
+// Health, filter and decide for one acquisition, the part of a tick that
+// a trace replay (raw_trace.h) runs again; `t` is the latency lap start
+ActuatorState controlStep(const RawSample &raw, const RuntimeConfig &cfg,
+                          SensorData &out, uint32_t &t);
+// `ranOn`, if given, gets a copy of the config snapshot the tick used
+ActuatorState controlTick(SensorData &out, RuntimeConfig *ranOn = NULL);
+// Filters, rules, rate and sensor health back to their boot state, so a
+// replay starts where the recorded ride did
+void controlReset();
+// Milliseconds until the next controlTick() should run
+uint32_t controlPeriodMs();
+// How close the last tick was to a warning (0 far .. 1 at a threshold)
+float controlProximity();
+
+#endif
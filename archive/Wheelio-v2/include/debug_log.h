@@ -0,0 +1,145 @@
+#ifndef DEBUG_LOG_H
+#define DEBUG_LOG_H
+#include "config.h"
+#include "log_messages.h"
+#include "timebase.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Leveled binary logging. LOG(MSG_X, args...) queues the message id, the
+// time and the raw argument words in a lock-free ring; nothing is
+// formatted on the device. One low-priority task drains the ring with
+// logDrain() and writes the frames to the serial port, and
+// scripts/log_decode.py prints them as text. Messages above LOG_LEVEL
+// compile to nothing, arguments included. Safe from any task, not from
+// ISRs.
+
+enum LogLevel {
+  LOG_LEVEL_OFF,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG,
+};
+
+#define LOG_MESSAGE_ID(id, level, format) id,
+enum LogMessage { LOG_MESSAGES(LOG_MESSAGE_ID) LOG_MESSAGE_COUNT };
+#undef LOG_MESSAGE_ID
+
+#define LOG_MESSAGE_LEVEL(id, level, format) level,
+constexpr LogLevel LOG_LEVELS[] = {LOG_MESSAGES(LOG_MESSAGE_LEVEL)};
+#undef LOG_MESSAGE_LEVEL
+
+#define LOG_MESSAGE_FORMAT(id, level, format) format,
+constexpr const char *LOG_FORMATS[] = {LOG_MESSAGES(LOG_MESSAGE_FORMAT)};
+#undef LOG_MESSAGE_FORMAT
+
+#define LOG_ARG_WORDS 10
+
+struct LogRecord {
+  uint32_t timestampUs; // timebaseMicros(), wraps every ~71 minutes
+  uint16_t message;     // LogMessage
+  uint8_t words;        // of args in use
+  uint8_t reserved;
+  uint32_t args[LOG_ARG_WORDS];
+};
+
+// On the wire: LOG_FRAME_MAGIC, message (u16), words (u8), timestampUs
+// (u32), the argument words (u32 each), all little-endian, then the low
+// byte of the crc32 of everything after the magic
+#define LOG_FRAME_MAGIC 0xA5
+#define LOG_FRAME_BYTES(words) (9 + 4 * (words))
+
+// Format checks, at compile time
+constexpr bool logIsModifier(char c) {
+  return c == '-' || c == '+' || c == ' ' || c == '#' || c == '.' ||
+         (c >= '0' && c <= '9') || c == 'h' || c == 'l' || c == 'z';
+}
+constexpr const char *logConversion(const char *f) {
+  return logIsModifier(*f) ? logConversion(f + 1) : f;
+}
+// Arguments a format takes ("%%" takes none)
+constexpr uint8_t logFormatArgs(const char *f) {
+  return *f == '\0'   ? 0
+         : *f != '%'  ? logFormatArgs(f + 1)
+         : f[1] == '%' ? logFormatArgs(f + 2)
+                       : 1 + logFormatArgs(logConversion(f + 1) + 1);
+}
+constexpr uint8_t logFormatStrings(const char *f) {
+  return *f == '\0'   ? 0
+         : *f != '%'  ? logFormatStrings(f + 1)
+         : f[1] == '%' ? logFormatStrings(f + 2)
+                       : (*logConversion(f + 1) == 's') +
+                             logFormatStrings(logConversion(f + 1) + 1);
+}
+
+// Argument packing: one word per number (floats by bit pattern); the
+// string is copied in after them by logCommit()
+inline void logPut(LogRecord &, const char *&text, const char *value) {
+  text = value;
+}
+inline void logPut(LogRecord &, const char *&text, char *value) {
+  text = value;
+}
+inline void logPut(LogRecord &record, const char *&, float value) {
+  memcpy(&record.args[record.words++], &value, sizeof(value));
+}
+inline void logPut(LogRecord &record, const char *&text, double value) {
+  logPut(record, text, (float)value);
+}
+template <typename T>
+inline void logPut(LogRecord &record, const char *&, T value) {
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                "log arguments are numbers and at most one string");
+  record.args[record.words++] = (uint32_t)value;
+}
+
+inline void logPack(LogRecord &, const char *&) {}
+template <typename T, typename... Rest>
+inline void logPack(LogRecord &record, const char *&text, T value,
+                    Rest... rest) {
+  logPut(record, text, value);
+  logPack(record, text, rest...);
+}
+
+// Producer side of LOG(): a record to fill (NULL and counted as dropped
+// when the ring is full), then queue it with its string argument, if any
+LogRecord *logClaim(size_t &ticket);
+void logCommit(size_t ticket, LogRecord &record, const char *text);
+
+template <LogMessage M, typename... Args>
+inline void logWrite(Args... args) {
+  static_assert(sizeof...(Args) == logFormatArgs(LOG_FORMATS[M]),
+                "argument count does not match the format");
+  static_assert(logFormatStrings(LOG_FORMATS[M]) <= 1, "one %s at most");
+  static_assert(sizeof...(Args) - logFormatStrings(LOG_FORMATS[M]) <=
+                    LOG_ARG_WORDS,
+                "too many arguments");
+  size_t ticket;
+  LogRecord *record = logClaim(ticket);
+  if (record == NULL)
+    return;
+  record->timestampUs = (uint32_t)timebaseMicros();
+  record->message = M;
+  record->words = 0;
+  const char *text = NULL;
+  logPack(*record, text, args...);
+  logCommit(ticket, *record, text);
+}
+
+#define LOG(message, ...)                                                      \
+  do {                                                                         \
+    if (LOG_LEVELS[message] <= LOG_LEVEL)                                      \
+      logWrite<message>(__VA_ARGS__);                                          \
+  } while (0)
+
+// Consumer (one task): encodes queued records as frames into out and
+// returns the bytes written. Drops since the last call come first, as a
+// MSG_LOG_DROPPED frame.
+size_t logDrain(uint8_t *out, size_t capacity);
+// Records refused because the ring was full, since boot
+uint32_t logDropped();
+
+#endif
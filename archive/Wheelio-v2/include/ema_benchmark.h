@@ -0,0 +1,23 @@
+#ifndef EMA_BENCHMARK_H
+#define EMA_BENCHMARK_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-sample cost of each EMA filter variant and of the FilterBank, shared
+// by the native runner (counter in ns) and the board (counter in CPU
+// cycles).
+
+struct EmaBenchResult {
+  const char *name;
+  float countsPerSample; // counter ticks per update()
+  float maxError;        // vs a double-precision EMA, in full-scale units
+};
+
+#define EMA_BENCH_VARIANTS 8
+
+// Runs every variant over `samples` updates, timed with `counter`. Fills up
+// to maxResults entries and returns how many.
+size_t emaBenchmark(uint32_t (*counter)(), uint32_t samples,
+                    EmaBenchResult *results, size_t maxResults);
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef EMA_FILTER_H
 #define EMA_FILTER_H
 
-class EMAFilter {
+#include <stdint.h>
+
+// Float EMA with a runtime alpha, for filters tuned from /parameters. Seeds
+// itself from the first sample.
+class TunableEMAFilter {
 private:
     float alpha; // Smoothing factor
     float emaValue; // Current EMA value
@@ -9,7 +13,8 @@ private:
 
 public:
     // Constructor
-    EMAFilter(float alpha) : alpha(alpha), emaValue(0), initialized(false) {}
+    TunableEMAFilter(float alpha)
+        : alpha(alpha), emaValue(0), initialized(false) {}
 
     // Update the EMA with a new value
     float update(float newValue) {
@@ -33,4 +38,109 @@ public:
     }
 };
 
-#endif // EMA_FILTER_H
\ No newline at end of file
+// Fixed-point sample formats: Q15 in int16_t, Q31 in int32_t, both covering
+// [-1, 1). Scale physical values by their full-scale range first.
+static inline int16_t toQ15(float x) {
+    return x >= 1.0f ? INT16_MAX : x <= -1.0f ? INT16_MIN
+                                              : (int16_t)(x * 32768.0f);
+}
+static inline int32_t toQ31(float x) {
+    return x >= 1.0f ? INT32_MAX : x <= -1.0f ? INT32_MIN
+                                              : (int32_t)(x * 2147483648.0f);
+}
+static inline float fromQ15(int16_t x) { return x / 32768.0f; }
+static inline float fromQ31(int32_t x) { return x / 2147483648.0f; }
+
+namespace ema_detail {
+
+template <typename T> struct Traits;
+template <> struct Traits<int16_t> {
+    typedef int32_t Wide;
+    static const int FRACTION_BITS = 15;
+};
+template <> struct Traits<int32_t> {
+    typedef int64_t Wide;
+    static const int FRACTION_BITS = 31;
+};
+
+constexpr bool isPowerOfTwo(uint32_t x) { return x && !(x & (x - 1)); }
+constexpr int log2(uint32_t x) { return x > 1 ? 1 + log2(x >> 1) : 0; }
+
+} // namespace ema_detail
+
+// EMA with alpha = AlphaNum / AlphaDen fixed at compile time, for per-frame
+// smoothing at high sample rates. There is no first-sample branch: the
+// filter starts from the constructor value, or from reset().
+//
+// T is float, or int16_t / int32_t for Q15 / Q31 samples. In fixed point a
+// power-of-two AlphaDen is a multiply and a shift; any other ratio is
+// rounded to a Q15 / Q31 coefficient.
+template <typename T, uint32_t AlphaNum, uint32_t AlphaDen>
+class EMAFilter {
+private:
+    static_assert(AlphaNum > 0 && AlphaNum <= AlphaDen,
+                  "alpha must be in (0, 1]");
+    typedef ema_detail::Traits<T> Q;
+    typedef typename Q::Wide Wide;
+
+    static const bool SHIFT_ONLY = ema_detail::isPowerOfTwo(AlphaDen);
+    static const int SHIFT = SHIFT_ONLY ? ema_detail::log2(AlphaDen)
+                                        : Q::FRACTION_BITS;
+    static constexpr Wide COEFFICIENT =
+        SHIFT_ONLY ? (Wide)AlphaNum
+                   : (Wide)(((uint64_t)AlphaNum << Q::FRACTION_BITS) /
+                            AlphaDen);
+    static constexpr Wide ROUND = SHIFT > 0 ? (Wide)1 << (SHIFT - 1) : 0;
+    // delta spans FRACTION_BITS + 1 bits; the product must fit in Wide
+    static_assert((uint64_t)COEFFICIENT <
+                      (uint64_t)1 << (sizeof(Wide) * 8 - 2 - Q::FRACTION_BITS),
+                  "alpha numerator too wide for this sample type");
+
+    T emaValue;
+
+public:
+    explicit EMAFilter(T initial = 0) : emaValue(initial) {}
+
+    T update(T newValue) {
+        Wide delta = (Wide)newValue - emaValue;
+        emaValue = (T)(emaValue + ((delta * COEFFICIENT + ROUND) >> SHIFT));
+        return emaValue;
+    }
+
+    T getValue() const {
+        return emaValue;
+    }
+
+    void reset(T value) {
+        emaValue = value;
+    }
+};
+
+template <uint32_t AlphaNum, uint32_t AlphaDen>
+class EMAFilter<float, AlphaNum, AlphaDen> {
+private:
+    static_assert(AlphaNum > 0 && AlphaNum <= AlphaDen,
+                  "alpha must be in (0, 1]");
+    static constexpr float ALPHA = (float)AlphaNum / AlphaDen;
+    static constexpr float DECAY = (float)(AlphaDen - AlphaNum) / AlphaDen;
+
+    float emaValue;
+
+public:
+    explicit EMAFilter(float initial = 0.0f) : emaValue(initial) {}
+
+    float update(float newValue) {
+        emaValue = ALPHA * newValue + DECAY * emaValue;
+        return emaValue;
+    }
+
+    float getValue() const {
+        return emaValue;
+    }
+
+    void reset(float value) {
+        emaValue = value;
+    }
+};
+
+#endif // EMA_FILTER_H
@@ -0,0 +1,94 @@
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// N float EMA channels with their state stored contiguously, so one pass
+// updates them all and the channel loop vectorizes on the host. Each
+// channel has its own alpha and an offset added to its output. A channel
+// seeds itself from its first sample, as TunableEMAFilter does, without a
+// branch: its gain is 1 until then.
+template <size_t N>
+class FilterBank {
+private:
+    static_assert(N > 0 && N <= 32, "fresh masks are 32 bits");
+
+    float value[N];
+    float gain[N];  // alpha once the channel has seen a sample, else 1
+    float alpha[N];
+    float offset[N];
+    uint32_t seeded; // channels that have seen a sample
+
+public:
+    static const uint32_t ALL = N == 32 ? 0xFFFFFFFFu : (1u << N) - 1;
+
+    // Every channel starts with initialAlpha and no offset
+    explicit FilterBank(float initialAlpha = 1.0f) : seeded(0) {
+        for (size_t c = 0; c < N; c++) {
+            value[c] = 0.0f;
+            gain[c] = 1.0f;
+            alpha[c] = initialAlpha;
+            offset[c] = 0.0f;
+        }
+    }
+
+    void setAlpha(size_t channel, float newAlpha) {
+        alpha[channel] = newAlpha;
+        if ((seeded >> channel) & 1)
+            gain[channel] = newAlpha;
+    }
+
+    void setOffset(size_t channel, float newOffset) {
+        offset[channel] = newOffset;
+    }
+
+    // One sample per channel. Channels whose bit is clear in `fresh` hold
+    // their value.
+    void update(const float *samples, uint32_t fresh = ALL) {
+        for (size_t c = 0; c < N; c++) {
+            bool isFresh = (fresh >> c) & 1;
+            float g = isFresh ? gain[c] : 0.0f;
+            value[c] += g * (samples[c] - value[c]);
+            gain[c] = isFresh ? alpha[c] : gain[c];
+        }
+        seeded |= fresh & ALL;
+    }
+
+    // `frames` samples per channel, frame-major: samples[f * N + c]
+    void updateBlock(const float *samples, size_t frames) {
+        for (size_t f = 0; f < frames; f++) {
+            const float *frame = samples + f * N;
+            for (size_t c = 0; c < N; c++) {
+                value[c] += gain[c] * (frame[c] - value[c]);
+                gain[c] = alpha[c];
+            }
+        }
+        if (frames)
+            seeded = ALL;
+    }
+
+    // Extra samples for one channel, e.g. a sensor that delivers several
+    // per tick
+    void updateChannel(size_t channel, float sample) {
+        value[channel] += gain[channel] * (sample - value[channel]);
+        gain[channel] = alpha[channel];
+        seeded |= 1u << channel;
+    }
+
+    // Filtered value without / with the channel offset
+    float getValue(size_t channel) const {
+        return value[channel];
+    }
+
+    float output(size_t channel) const {
+        return value[channel] + offset[channel];
+    }
+
+    void outputs(float *out) const {
+        for (size_t c = 0; c < N; c++)
+            out[c] = value[c] + offset[c];
+    }
+};
+
+#endif // FILTER_BANK_H
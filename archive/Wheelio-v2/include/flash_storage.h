@@ -0,0 +1,41 @@
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+#include <stddef.h>
+#include <stdint.h>
+
+// NOR-flash-like storage: erase sets a whole sector to 0xFF, and writes can
+// only clear bits. Backed by a raw data partition on the board and by a
+// file on the host.
+class FlashStorage {
+public:
+  virtual ~FlashStorage() {}
+  virtual size_t size() const = 0;
+  virtual size_t sectorSize() const = 0;
+  virtual bool read(size_t offset, void *data, size_t length) = 0;
+  virtual bool write(size_t offset, const void *data, size_t length) = 0;
+  virtual bool eraseSector(size_t offset) = 0;
+};
+
+// Board: every partition erase waits for the control task's slack. An erase
+// suspends the flash cache on both cores, freezing the control task (which
+// runs from flash) and the IMU FIFO drain for its whole length, so it only
+// starts right after a tick whose successor is at least
+// FLASH_ERASE_SLACK_MS away. With no such gap within FLASH_ERASE_WAIT_MS
+// the erase fails and the caller drops what it was making room for.
+struct FlashEraseStats {
+  uint32_t erases;
+  uint32_t deferred; // gave up waiting for slack
+  uint32_t maxEraseUs;
+};
+// Before any partition is used (setup())
+void flashSlackInit();
+// Control task, after each tick: when the next tick is due
+void flashTickDone(uint64_t nextTickUs);
+FlashEraseStats flashEraseStats();
+
+// Board: the "tlog" partition from partitions.csv. NULL if it is missing.
+FlashStorage *telemetryFlashStorage();
+// Board: the "trace" partition (raw_trace.h). NULL if it is missing.
+FlashStorage *traceFlashStorage();
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+#include <stddef.h>
+
+// What the upload path needs from an HTTP/1.1 response head: the status,
+// how much body follows and whether the connection can carry the next
+// request. Fed one line at a time, so the caller reads into a fixed buffer
+// and nothing is allocated.
+struct HttpResponseHead {
+  int status;      // 0 until a valid status line
+  long bodyLength; // -1 when the body runs until the server closes
+  bool keepAlive;
+  bool badLength; // Content-Length that is not a number
+};
+
+void httpResponseBegin(HttpResponseHead &head);
+// One line without its CRLF, the status line first. Returns true while
+// more header lines follow; false after the blank line that ends the head,
+// or at once on a line that is not an HTTP status line (status stays 0).
+bool httpResponseLine(HttpResponseHead &head, const char *line);
+// Whether the next request can go on the same connection, given the body
+// bytes still unread. 1xx, 204 and 304 replies have no body whatever their
+// headers say; a body of unknown length ends only with the connection.
+bool httpResponseReusable(const HttpResponseHead &head, long unread);
+
+#endif
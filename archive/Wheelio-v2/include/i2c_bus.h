@@ -0,0 +1,47 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+#include <stdint.h>
+
+// Single owner for the shared SDA 21 / SCL 22 bus. Drivers hand it
+// transactions instead of calling Wire themselves; a bus task runs them one
+// at a time, always taking high-priority (IMU) work before low-priority
+// (lidar) work, and accounts per-device occupancy and queueing delay.
+//
+// Every Wire call gives up after I2C_WIRE_TIMEOUT_MS, so a dead device
+// costs a bounded slice of the bus. After I2C_RECOVERY_FAILURES failed or
+// overrunning transactions in a row, or any failure that leaves SDA held
+// low, the bus task clears the bus: it clocks SCL until the stuck device
+// lets go of SDA, sends a STOP and restarts Wire.
+
+enum I2cDevice { I2C_DEVICE_MPU6050, I2C_DEVICE_LIDAR, I2C_DEVICE_COUNT };
+
+enum I2cPriority { I2C_PRIORITY_HIGH, I2C_PRIORITY_LOW };
+
+// Runs on the bus task; may use Wire freely. Returns false on bus error.
+typedef bool (*I2cTransactionFn)(void *context);
+
+struct I2cBusStats {
+  uint32_t transactions;
+  uint32_t failures;
+  uint32_t overruns;        // ran past I2C_TRANSACTION_DEADLINE_MS
+  uint32_t rejected;        // queue full at submit time
+  uint64_t busyUs;          // time spent executing on the bus
+  uint64_t queueDelayUs;    // total submit-to-start delay
+  uint32_t maxQueueDelayUs;
+};
+
+void i2cBusInit();
+// Queue a transaction and return immediately
+bool i2cBusSubmit(I2cDevice device, I2cPriority priority, I2cTransactionFn fn,
+                  void *context);
+// Queue a transaction and wait for its result, without allocating. The
+// transaction may still run after a timeout, so `context` must not live on
+// the caller's stack. One waiter per device at a time.
+bool i2cBusRun(I2cDevice device, I2cPriority priority, I2cTransactionFn fn,
+               void *context, uint32_t timeoutMs);
+I2cBusStats i2cBusStats(I2cDevice device);
+// Bus clears since boot
+uint32_t i2cBusRecoveries();
+const char *i2cDeviceName(I2cDevice device);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Serializes JSON into a caller-owned buffer without touching the heap.
+// Calls can be chained; once the buffer is full every further call is a
+// no-op and ok() returns false. The output is always NUL-terminated.
+class JsonWriter {
+public:
+  JsonWriter(char *buffer, size_t capacity);
+
+  JsonWriter &beginObject(const char *key = NULL);
+  JsonWriter &endObject();
+  JsonWriter &field(const char *key, float value); // NaN/inf become null
+  JsonWriter &field(const char *key, bool value);
+  JsonWriter &field(const char *key, uint64_t value);
+  JsonWriter &field(const char *key, const char *value);
+  // An RTDB server value placeholder, e.g. {".sv":"timestamp"}
+  JsonWriter &serverValue(const char *key, const char *name);
+
+  const char *c_str() const { return out; }
+  size_t length() const { return len; }
+  bool ok() const { return !overflow; }
+
+private:
+  char *out;
+  size_t capacity;
+  size_t len;
+  bool overflow;
+  bool needComma;
+
+  void append(const char *text, size_t n);
+  void append(const char *text);
+  void quoted(const char *text);
+  void key(const char *name);
+};
+
+#endif
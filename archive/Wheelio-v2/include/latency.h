@@ -0,0 +1,79 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include "config.h"
+#include "control.h"
+#include "timebase.h"
+#include <stdint.h>
+
+// Control loop latency: how long each stage of a tick takes, how old the
+// sensor data is when the actuators are written, how far ticks stray from
+// their period, and samples that never made it. Recorded by the control
+// task only; the debug dump reads them without locking, so a figure can be
+// a tick behind. With LATENCY_STATS false the timing calls compile to
+// nothing; the drop counters are always kept.
+
+enum LatencyMetric {
+  LATENCY_READ,      // controlAcquire()
+  LATENCY_FILTER,    // controlFilter()
+  LATENCY_DECIDE,    // controlDecide()
+  LATENCY_ACTUATE,   // controlActuate()
+  LATENCY_TICK,      // all four
+  LATENCY_LIDAR_AGE, // newest lidar range to the actuator write
+  LATENCY_IMU_AGE,   // newest IMU frame to the actuator write
+  LATENCY_WARNING,   // sample that raised a warning to setWarningLight(true)
+  LATENCY_JITTER,    // tick start against the previous one plus its period
+  LATENCY_METRICS,
+};
+
+enum LatencyDrop {
+  DROP_LIDAR_NONE,     // ticks without a fresh range (readLidarDistance() -1)
+  DROP_TELEMETRY_FULL, // ticks lost to a full telemetryBuffer
+  LATENCY_DROPS,
+};
+
+// Bucket b counts durations of [2^b, 2^(b+1)) ns; bucket 0 also counts 0
+#define LATENCY_BUCKETS 32
+
+struct LatencyHistogram {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxNs;
+  uint64_t totalNs;
+};
+
+void latencyRecordNs(LatencyMetric metric, uint32_t ns);
+void latencyRecordCycles(LatencyMetric metric, uint32_t cycles);
+
+// Stage timing: t = latencyStart(); stage(); t = latencyLap(metric, t); ...
+inline uint32_t latencyStart() { return LATENCY_STATS ? timebaseCycles() : 0; }
+
+inline uint32_t latencyLap(LatencyMetric metric, uint32_t start) {
+  if (!LATENCY_STATS)
+    return 0;
+  uint32_t now = timebaseCycles();
+  latencyRecordCycles(metric, now - start);
+  return now;
+}
+
+// At the start of a tick: tick-to-tick jitter, the gap since the previous
+// start against the period that was asked for then
+void latencyRecordStart(uint64_t startUs, uint32_t periodMs);
+// After controlActuate(): data ages, warning latency and lidar drops of the
+// tick
+void latencyRecordTick(const RawSample &raw, const ActuatorState &state,
+                       uint64_t actuatedUs);
+void latencyCountDrop(LatencyDrop drop);
+
+// Age of the oldest sensor sample behind the last tick's actuator write
+uint32_t latencySensorAgeUs();
+
+const LatencyHistogram &latencyHistogram(LatencyMetric metric);
+uint32_t latencyDrops(LatencyDrop drop);
+const char *latencyMetricName(LatencyMetric metric);
+const char *latencyDropName(LatencyDrop drop);
+// Upper bound of the bucket holding the given fraction of samples (0..1)
+uint32_t latencyPercentileNs(const LatencyHistogram &histogram,
+                             float fraction);
+void latencyReset();
+
+#endif
@@ -1,9 +1,32 @@
 #ifndef LIDAR_SENSOR_H
 #define LIDAR_SENSOR_H
 
-#include <Arduino.h>
+#include <stdint.h>
 
+// One completed range, stamped when the data-ready interrupt fired
+struct LidarSample {
+  uint64_t timestampUs;
+  int distance; // cm, LIDAR_MAX_RANGE_CM when nothing is in range
+};
+
+struct LidarStats {
+  uint32_t samples;  // ranges queued
+  uint32_t invalid;  // ranges rejected by the sensor's status
+  uint32_t dropped;  // ranges lost because the queue was full
+};
+
+// Starts ranging. A sensor that does not answer is logged and left to
+// lidarRecover(); boot carries on without it.
 void lidarInit();
-int readLidarDistance(); // returns distance in cm
+// Queue a re-initialization (boot the sensor and restart ranging) on the
+// I2C bus task and return; false if the bus queue is full
+bool lidarRecover();
+// Pop the next completed range, oldest first. False when none is pending.
+bool lidarReadSample(LidarSample &sample);
+int readLidarDistance(); // newest pending distance in cm, -1 if none
+// Ranging period, at least LIDAR_INTER_MEASUREMENT_MS. Takes effect after
+// the range in progress.
+void lidarSetInterval(uint32_t ms);
+LidarStats lidarStats();
 
 #endif
@@ -1,8 +1,42 @@
 #ifndef LIGHT_SENSOR_H
 #define LIGHT_SENSOR_H
-#include <Arduino.h>
+#include <stdint.h>
+
+struct LightStats {
+  uint32_t samples;  // ADC conversions accumulated
+  uint32_t outputs;  // averaged estimates produced
+  uint32_t overruns; // DMA blocks lost because the reader fell behind
+};
 
 void lightSensorInit();
-float readLightLevel(); // returns lumens (filtered)
+float readLightLevel(); // returns lux (oversampled and calibrated)
+LightStats lightSensorStats();
+
+// Convert averaged 12-bit ADC counts to lux (light_calibration.cpp)
+float lightCountsToLux(float counts);
+
+// Block averager: add raw conversions, and every `decimation` samples an
+// averaged value is ready.
+class LightOversampler {
+private:
+  uint32_t sum;
+  uint32_t count;
+  uint32_t decimation;
+
+public:
+  explicit LightOversampler(uint32_t decimation)
+      : sum(0), count(0), decimation(decimation ? decimation : 1) {}
+
+  // Returns true and sets `average` when a full block has been collected
+  bool add(uint16_t counts, float &average) {
+    sum += counts;
+    if (++count < decimation)
+      return false;
+    average = (float)sum / count;
+    sum = 0;
+    count = 0;
+    return true;
+  }
+};
 
 #endif
@@ -0,0 +1,97 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+// Every log message: X(id, level, format). A record carries only the id,
+// the time and the arguments; scripts/log_decode.py reads this table to
+// print it. Arguments are 32-bit words (%d %u %x integers, %f %g floats),
+// plus at most one %s whose text is copied in after them, truncated to
+// fit. Keep each format on one line, and add new messages at the end so
+// older captures still decode.
+#define LOG_MESSAGES(X)                                                        \
+  X(MSG_LOG_DROPPED, LOG_LEVEL_WARN, "Log: %u records dropped (buffer full)")  \
+  X(MSG_BOOT, LOG_LEVEL_INFO, "Wheelio System Booting...")                     \
+  X(MSG_CONFIG_LOADED, LOG_LEVEL_INFO, "Configuration loaded from NVS.")       \
+  X(MSG_CONFIG_BLOB_BAD, LOG_LEVEL_WARN,                                       \
+    "Config blob in NVS is damaged or outdated, ignored.")                     \
+  X(MSG_WIFI_FAILED, LOG_LEVEL_WARN,                                           \
+    "No saved WiFi network reachable, config portal open.")                    \
+  X(MSG_WIFI_CONNECTED, LOG_LEVEL_INFO, "WiFi connected: %u.%u.%u.%u")         \
+  X(MSG_TLOG_UNAVAILABLE, LOG_LEVEL_ERROR,                                     \
+    "Telemetry log unavailable, offline samples are dropped.")                 \
+  X(MSG_TLOG_PENDING, LOG_LEVEL_INFO, "Telemetry log: %u samples pending")     \
+  X(MSG_UPLOADS_PAUSED, LOG_LEVEL_INFO,                                        \
+    "Uploads paused while the config portal is open")                          \
+  X(MSG_PORTAL_OPEN, LOG_LEVEL_INFO,                                           \
+    "Boot button pressed. Opening WiFi configuration portal...")               \
+  X(MSG_PORTAL_FAILED, LOG_LEVEL_WARN,                                         \
+    "Configuration portal closed without connecting to WiFi.")                 \
+  X(MSG_PORTAL_CONNECTED, LOG_LEVEL_INFO,                                      \
+    "WiFi connected through configuration portal.")                            \
+  X(MSG_UPLOADS_RESUMED, LOG_LEVEL_INFO, "Uploads resumed")                    \
+  X(MSG_DUMP_CONFIG, LOG_LEVEL_DEBUG, "Config %s: %g")                         \
+  X(MSG_DUMP_SENSORS, LOG_LEVEL_DEBUG,                                         \
+    "Sensors: light %.1f, distance %.1f, accel X %.2f, tilt side %.2f, tilt FB %.2f") \
+  X(MSG_DUMP_PERIOD, LOG_LEVEL_INFO,                                           \
+    "Control period %u ms (proximity %.2f), %.0f..%.0f ms, fast at %.2f, idle at %.2f") \
+  X(MSG_DUMP_DROPS, LOG_LEVEL_INFO,                                            \
+    "Dropped: %u telemetry, %u ticks without a lidar range; lidar %u invalid, %u dropped") \
+  X(MSG_DUMP_LATENCY, LOG_LEVEL_INFO,                                          \
+    "Latency %-10s %8u mean %9.1f p50 %9.1f p99 %9.1f max %9.1f us")           \
+  X(MSG_DUMP_UPLINK, LOG_LEVEL_INFO,                                           \
+    "Uplink: %u sent, %u logged, %u replayed, %u failed requests, %u dropped") \
+  X(MSG_DUMP_TLOG, LOG_LEVEL_INFO,                                             \
+    "Telemetry log: backlog %u, %u lost, %u corrupt, max %u erases/sector")    \
+  X(MSG_DUMP_HEAP, LOG_LEVEL_INFO,                                             \
+    "Heap: %u free, %u min free, %u largest block")                            \
+  X(MSG_DUMP_ALLOCS, LOG_LEVEL_INFO, "Heap: %u allocations/s")                 \
+  X(MSG_DUMP_I2C, LOG_LEVEL_INFO,                                              \
+    "I2C %s: %.1f%% busy, %u txns, delay avg %u us max %u us, %u failed, %u rejected") \
+  X(MSG_CONFIG_SET, LOG_LEVEL_INFO, "Config: %s = %g")                         \
+  X(MSG_CONFIG_OUT_OF_RANGE, LOG_LEVEL_WARN,                                   \
+    "Config: %s = %g rejected (range %g..%g)")                                 \
+  X(MSG_CONFIG_NOT_NUMBER, LOG_LEVEL_WARN, "Config: %s is not a number")       \
+  X(MSG_CONFIG_REJECTED, LOG_LEVEL_WARN, "Config: %u keys rejected")           \
+  X(MSG_CONFIG_SAVE_FAILED, LOG_LEVEL_ERROR, "Config: saving to NVS failed")   \
+  X(MSG_CONFIG_STREAM_TIMEOUT, LOG_LEVEL_WARN,                                 \
+    "Config stream timed out, resuming...")                                    \
+  X(MSG_CONFIG_STREAM_FAILED, LOG_LEVEL_ERROR, "Config stream failed: %s")     \
+  X(MSG_UPLOAD_PACKED, LOG_LEVEL_DEBUG, "Sent %u samples in %u packed bytes.") \
+  X(MSG_UPLOAD_SENT, LOG_LEVEL_DEBUG,                                          \
+    "Sent %u samples to Firebase in one update.")                              \
+  X(MSG_UPLOAD_FAILED, LOG_LEVEL_WARN, "Failed to send data to Firebase: %s")  \
+  X(MSG_UPLOAD_TOO_BIG, LOG_LEVEL_ERROR,                                       \
+    "Telemetry batch does not fit the upload buffer.")                         \
+  X(MSG_LIDAR_BOOT_FAILED, LOG_LEVEL_ERROR,                                    \
+    "Failed to boot VL53L0X, retrying")                                        \
+  X(MSG_MPU_INIT_FAILED, LOG_LEVEL_ERROR,                                      \
+    "Failed to initialize MPU6050 sensor, retrying")                           \
+  X(MSG_MPU_INIT_OK, LOG_LEVEL_INFO, "MPU6050 initialized successfully")       \
+  X(MSG_MPU_FIFO_UNAVAILABLE, LOG_LEVEL_WARN,                                  \
+    "MPU6050 FIFO mode unavailable, polling")                                  \
+  X(MSG_LIGHT_DMA_UNAVAILABLE, LOG_LEVEL_WARN,                                 \
+    "Light sensor ADC DMA unavailable, using analogRead")                      \
+  X(MSG_LOG_CHECK, LOG_LEVEL_INFO,                                             \
+    "Check: producer %u record %u value %g %s")                                \
+  X(MSG_BOOT_PHASE, LOG_LEVEL_INFO, "Boot: %s at %u ms")                       \
+  X(MSG_BOOT_SLOW, LOG_LEVEL_WARN,                                             \
+    "Boot: first control tick at %u ms, over the %u ms target")                \
+  X(MSG_SENSOR_STALE, LOG_LEVEL_WARN, "Sensor %s: no new data for %u ms")      \
+  X(MSG_SENSOR_FAILED, LOG_LEVEL_ERROR,                                        \
+    "Sensor %s failed; its warnings are off until it recovers")                \
+  X(MSG_SENSOR_OK, LOG_LEVEL_INFO, "Sensor %s: delivering again")              \
+  X(MSG_DUMP_HEALTH, LOG_LEVEL_INFO,                                           \
+    "Sensor %s: %u missed, %u failed, %u reinits, %u recovered")               \
+  X(MSG_DUMP_I2C_BUS, LOG_LEVEL_INFO, "I2C bus: %u overruns, %u recoveries")   \
+  X(MSG_I2C_RECOVERED, LOG_LEVEL_WARN,                                         \
+    "I2C bus cleared with %u clock pulses after %u failed transactions")       \
+  X(MSG_TRACE_UNAVAILABLE, LOG_LEVEL_ERROR,                                    \
+    "Trace partition not found, recording off")                                \
+  X(MSG_TRACE_WRITE_FAILED, LOG_LEVEL_WARN,                                    \
+    "Trace flash write failed, %u bytes lost")                                 \
+  X(MSG_DUMP_TRACE, LOG_LEVEL_INFO, "Trace: %u ticks, %u configs, %u dropped") \
+  X(MSG_DUMP_FLASH, LOG_LEVEL_INFO,                                            \
+    "Flash: %u erases, %u deferred for lack of slack, longest %u us")       \
+  X(MSG_DUMP_IMU, LOG_LEVEL_INFO,                                              \
+    "IMU: %u frames, %u dropped from the ring, %u chip FIFO overflows")
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-size multi-producer/single-consumer queue. Any task may claim a
+// cell, fill it in place and commit it; one task drains them in order.
+// Nothing blocks or allocates: producers race for a cell with one
+// compare-exchange, and a full queue refuses the item. A producer that is
+// preempted between claim() and commit() holds up the consumer (not other
+// producers) until it commits. N must be a power of two.
+template <typename T, size_t N>
+class MpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+private:
+    struct Cell {
+        // == position: free for the producer claiming it; == position + 1:
+        // committed, ready for the consumer
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Cell cells[N];
+    std::atomic<size_t> head; // next position to claim (producers)
+    size_t tail;              // next position to read (consumer)
+
+public:
+    MpscRing() : head(0), tail(0) {
+        for (size_t i = 0; i < N; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Producer: a cell to fill, or NULL when full. Pass `ticket` to
+    // commit() once the cell is filled.
+    T *claim(size_t &ticket) {
+        size_t h = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[h & (N - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t lag = (intptr_t)(sequence - h);
+            if (lag == 0) {
+                if (head.compare_exchange_weak(h, h + 1,
+                                               std::memory_order_relaxed)) {
+                    ticket = h;
+                    return &cell.item;
+                }
+            } else if (lag < 0) {
+                return NULL; // not drained yet
+            } else {
+                h = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void commit(size_t ticket) {
+        cells[ticket & (N - 1)].sequence.store(ticket + 1,
+                                               std::memory_order_release);
+    }
+
+    // Consumer: the oldest committed item, if any
+    bool pop(T &item) {
+        Cell &cell = cells[tail & (N - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != tail + 1)
+            return false;
+        item = cell.item;
+        cell.sequence.store(tail + N, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    static constexpr size_t capacity() { return N; }
+};
+
+#endif // MPSC_RING_H
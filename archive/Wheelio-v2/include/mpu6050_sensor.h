@@ -1,13 +1,44 @@
 #ifndef MPU6050_SENSOR_H
 #define MPU6050_SENSOR_H
-#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
 
 struct MpuData {
   float accelX, accelY, accelZ;
   float tiltSide, tiltFB;
+  uint64_t timestampUs; // newest frame behind these values, 0 before any
 };
 
+// One accel + gyro sample, stamped with when the chip produced it
+struct ImuFrame {
+  uint64_t timestampUs;
+  float accelX, accelY, accelZ; // m/s^2
+  float gyroX, gyroY, gyroZ;    // rad/s
+};
+
+struct MpuFifoStats {
+  uint32_t frames;     // frames moved from the chip into the ring buffer
+  uint32_t bursts;     // I2C burst drains
+  uint32_t overflows;  // chip FIFO overflowed and was reset
+  uint32_t dropped;    // frames lost because the ring buffer was full
+};
+
+// Starts acquisition. A chip that does not answer is logged and left to
+// mpu6050Recover(); boot carries on without it.
 void mpu6050Init();
 MpuData readMpuData(); // returns filtered data
 
+// Driver backend (mpu6050_sensor.cpp on the board, src/sim/ on native).
+// readMpuData() is built on these and is shared by both builds.
+bool mpu6050ReadFrame(ImuFrame &frame); // single polled read
+// Switch to FIFO + data-ready interrupt acquisition at sampleRateHz
+bool mpu6050StartFifo(uint16_t sampleRateHz);
+// Drain frames buffered since the last call, oldest first
+size_t mpu6050ReadFrames(ImuFrame *frames, size_t maxFrames);
+uint16_t mpu6050SampleRate(); // 0 while polling
+// Queue a re-initialization (reset the chip, restore the FIFO setup) on the
+// I2C bus task and return; false if the bus queue is full
+bool mpu6050Recover();
+MpuFifoStats mpu6050FifoStats();
+
 #endif
@@ -0,0 +1,115 @@
+#ifndef RAW_TRACE_H
+#define RAW_TRACE_H
+#include "control.h"
+#include "flash_storage.h"
+#include "runtime_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw sensor trace: what controlAcquire() read on every tick, before any
+// filtering, plus the config each tick ran with, so the host build can
+// replay a ride through the same filter and rule code (program replay).
+//
+// A trace is a stream of frames:
+//   u8      TRACE_FRAME_MAGIC
+//   u8      type (TraceFrameType)
+//   varint  payload length
+//   payload
+//   u8      low byte of the CRC-32 of type, length and payload
+// so it can share the serial port with the log frames (debug_log.h) and be
+// picked up from any point of a capture or a flash dump.
+//
+// TRACE_SYNC    u8 TRACE_VERSION; the next tick's time is absolute
+// TRACE_CONFIG  configSerialize() blob of the tick's snapshot
+// TRACE_TICK    varint  uptime since the previous tick, us
+//               u32     light, lux (float bits, little-endian)
+//               u8      lidar range count, then per range:
+//                 zigzag  age at the tick, us
+//                 zigzag  distance, cm
+//               zigzag  age of the newest IMU frame at the tick, us
+//               u32 x5  accel X, Y, Z, tilt side, tilt FB (float bits)
+//
+// Floats go as their bits, so a replay sees exactly what the board saw.
+// SYNC and CONFIG are repeated every TRACE_SYNC_BYTES, and after any tick
+// lost to a full buffer, so a trace decodes from any sync on.
+#define TRACE_FRAME_MAGIC 0xB7
+#define TRACE_VERSION 1
+#define TRACE_FRAME_MAX_BYTES 320 // a config frame, the largest
+
+enum TraceFrameType { TRACE_SYNC, TRACE_CONFIG, TRACE_TICK, TRACE_TYPES };
+
+// Returns the payload length, or 0 if it does not fit
+size_t traceEncodeTick(const RawSample &raw, uint64_t prevUs, uint8_t *out,
+                       size_t capacity);
+// Returns false if the payload is malformed
+bool traceDecodeTick(const uint8_t *payload, size_t length, uint64_t prevUs,
+                     RawSample &raw);
+// Wraps a payload into a frame; returns the frame length, or 0
+size_t traceFrame(TraceFrameType type, const uint8_t *payload, size_t length,
+                  uint8_t *out, size_t capacity);
+
+// Splits a byte stream into frames, skipping anything that is not one
+// (log frames, text, erased flash)
+class TraceReader {
+public:
+  typedef void (*FrameFn)(TraceFrameType type, const uint8_t *payload,
+                          size_t length, void *context);
+
+  TraceReader(FrameFn onFrame, void *context);
+  void feed(const uint8_t *data, size_t length);
+  uint32_t skipped() const { return skippedBytes; }
+
+private:
+  FrameFn onFrame;
+  void *context;
+  uint8_t buffer[2 * TRACE_FRAME_MAX_BYTES];
+  size_t length;
+  uint32_t skippedBytes;
+
+  void skip(size_t count);
+};
+
+struct TraceStats {
+  uint32_t ticks;   // ticks queued
+  uint32_t configs; // config frames queued
+  uint32_t dropped; // ticks lost to a full buffer
+};
+
+// Recorder. The control task calls traceRecord() every tick; it encodes
+// the tick (after SYNC and CONFIG when due) and queues it whole, or drops
+// it, without blocking. One sink task moves the queued frames out with
+// traceDrain(). Recording is off until traceStart().
+void traceStart();
+void traceStop();
+void traceRecord(const RawSample &raw, const RuntimeConfig &cfg);
+// Whole frames only, so they never interleave with the sink's other
+// output. Returns the bytes copied.
+size_t traceDrain(uint8_t *out, size_t capacity);
+TraceStats traceStats();
+
+// Trace sink for a flash partition: a ring of sectors, each starting with
+// a header and its sequence number, the frame stream running on across
+// sector boundaries. The newest data overwrites the oldest sector. Reads
+// back in sequence order, so a dump of the partition replays like a
+// serial capture.
+#define TRACE_SECTOR_MAGIC 0x43525457u // "WTRC", first word of a sector
+
+class TraceFlash {
+public:
+  TraceFlash();
+  // Continues after the newest sector on storage; erases nothing yet
+  bool begin(FlashStorage *storage);
+  bool append(const uint8_t *data, size_t length);
+  // Feeds every sector, oldest first, to `reader`
+  static bool readAll(FlashStorage *storage, TraceReader &reader);
+
+private:
+  FlashStorage *storage;
+  uint32_t sequence;
+  size_t sector;
+  size_t offset; // inside the sector
+
+  bool openSector(size_t index, uint32_t nextSequence);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Fixed-size single-producer/single-consumer queue. push() may only be
+// called from one task (or ISR) and pop() from one other task; neither
+// blocks or allocates. N must be a power of two.
+template <typename T, size_t N>
+class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+private:
+    T items[N];
+    std::atomic<size_t> head; // next slot to write (producer)
+    std::atomic<size_t> tail; // next slot to read (consumer)
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    // Returns false (and drops the item) when full
+    bool push(const T &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // All of `count` items or none; returns false when they do not fit
+    bool pushMany(const T *in, size_t count) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (N - (h - tail.load(std::memory_order_acquire)) < count) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            items[(h + i) & (N - 1)] = in[i];
+        }
+        head.store(h + count, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pop up to maxItems in one pass; returns how many were copied
+    size_t popMany(T *out, size_t maxItems) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - t;
+        size_t n = available < maxItems ? available : maxItems;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = items[(t + i) & (N - 1)];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) -
+               tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+};
+
+#endif // RING_BUFFER_H
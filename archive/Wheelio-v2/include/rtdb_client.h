@@ -0,0 +1,19 @@
+#ifndef RTDB_CLIENT_H
+#define RTDB_CLIENT_H
+#include <stddef.h>
+
+// Minimal Realtime Database REST writer for the upload path. Requests go
+// over one kept-alive TLS connection, and the body is written straight from
+// the caller's buffer, so a steady-state upload does not touch the heap.
+// Authentication reuses the Firebase client's ID token.
+
+enum RtdbMethod { RTDB_PUT, RTDB_PATCH };
+
+void rtdbInit();
+// `path` is relative to the database root, e.g. "/sensor_readings"
+bool rtdbWrite(RtdbMethod method, const char *path, const char *body,
+               size_t length);
+// Reason for the last failed write
+const char *rtdbLastError();
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+// Every runtime tunable, published as a whole. The writer (setup() and then
+// the config stream task) edits a private draft and publishes it; the
+// control loop takes one consistent snapshot per tick, so a tick never mixes
+// old and new settings and the reader never waits on the writer.
+struct RuntimeConfig {
+  // Warning thresholds
+  float tiltSideThreshold;
+  float tiltFBThreshold;
+  float distThreshold;
+  float lightThreshold;
+  float accelThreshold;
+  // EMA smoothing factors
+  float lightAlpha;
+  float lidarAlpha;
+  float mpuAlpha; // accel X only; tilt comes from the attitude estimator
+  // Sensor adjustments applied after filtering
+  float lightAdjustment;
+  float lidarAdjustment;
+  float accelXAdjustment;
+  float tiltSideAdjustment;
+  float tiltFBAdjustment;
+  // Control rate (adaptive_rate.h)
+  float fastPeriodMs;
+  float idlePeriodMs;
+  float fastProximity;
+  float idleProximity;
+};
+
+// Writer: the working copy. Only one task may write at a time.
+RuntimeConfig &configDraft();
+// Writer: make the draft the current config
+void configPublish();
+// Reader (the control loop only): the latest published config. The
+// reference stays valid and unchanged until the next configAcquire().
+const RuntimeConfig &configAcquire();
+
+#endif
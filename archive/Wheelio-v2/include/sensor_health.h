@@ -0,0 +1,52 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+#include <stdint.h>
+
+// Per-sensor health for the I2C sensors, updated by the control task once
+// per tick from whether the sensor delivered new data. A sensor with
+// nothing new for longer than its deadline goes STALE; stale for
+// SENSOR_FAIL_AFTER_MS more it goes FAILED, its warning rules are taken out
+// of the decision and its driver is re-initialized in the background,
+// backing off from SENSOR_RETRY_MS to SENSOR_RETRY_MAX_MS. The first new
+// data puts it back to OK. Other tasks read the figures without locking,
+// so they can be a tick behind.
+
+enum SensorId {
+  SENSOR_IMU,   // MPU6050 frames (MpuData::timestampUs advancing)
+  SENSOR_LIDAR, // VL53L0X ranges
+  SENSOR_COUNT,
+};
+
+enum HealthState {
+  HEALTH_OK,
+  HEALTH_STALE,  // past its deadline, last values held
+  HEALTH_FAILED, // out of the decision, being re-initialized
+};
+
+struct SensorHealthStats {
+  HealthState state;
+  uint32_t misses;     // deadlines missed (OK -> STALE)
+  uint32_t failures;   // taken out of the decision (STALE -> FAILED)
+  uint32_t reinits;    // background re-initializations requested
+  uint32_t recoveries; // back to OK after a failure
+};
+
+// One tick's news for `sensor`. Returns true when a re-initialization is
+// due; the caller starts it without waiting for the result.
+bool sensorHealthUpdate(SensorId sensor, bool fresh, uint64_t nowUs);
+HealthState sensorHealthState(SensorId sensor);
+SensorHealthStats sensorHealthStats(SensorId sensor);
+// RuleBits (warning_rules.h) whose sensors can be trusted
+uint8_t sensorHealthUsableRules();
+// Every sensor's HealthState, two bits each in SensorId order, as uploaded
+// with each TelemetrySample
+uint8_t sensorHealthPacked();
+inline HealthState sensorHealthUnpack(uint8_t packed, SensorId sensor) {
+  return (HealthState)((packed >> (2 * sensor)) & 3);
+}
+// Every sensor back to OK with no history, as at boot
+void sensorHealthReset();
+const char *sensorName(SensorId sensor);
+const char *healthStateName(HealthState state);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SIM_H
+#define SIM_H
+#include "sensor_health.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Controls for the simulated backends used by the native build.
+
+// Advance the virtual clock returned by timebaseMillis()/timebaseMicros().
+void simAdvanceMicros(uint64_t us);
+
+// Reseed the simulated sensors so runs are reproducible.
+void simSeed(uint32_t seed);
+
+struct SimActuatorLog {
+  bool fogLight, warningLight, buzzer;
+  uint32_t fogToggles, warningToggles, buzzerToggles;
+  uint32_t writes;
+};
+const SimActuatorLog &simActuators();
+
+struct SimUploadLog {
+  uint32_t uploads; // requests
+  uint32_t samples;
+  size_t bytes;
+  uint32_t healthReports; // uploaderSendHealth() requests
+};
+const SimUploadLog &simUploads();
+// Take the simulated uplink down (uploaderReady() false) to emulate a dead
+// zone
+void simSetOnline(bool online);
+
+// Make a simulated sensor stop answering, or repair it. A repaired sensor
+// stays silent until its driver's recover call re-initializes it.
+void simSensorFault(SensorId sensor, bool failed);
+
+// Enter credentials in the emulated WiFi portal; it connects on its next
+// wifiPortalPoll()
+void simPortalSubmit();
+
+class FlashStorage;
+// File-backed NOR flash emulator for the telemetry log. path NULL uses an
+// anonymous temporary file. Delete the result to close the file.
+FlashStorage *simFileFlash(const char *path, size_t size, size_t sectorSize);
+
+// Check modes print one line per simCheck() and end with PASS if every
+// check in the run held
+void simCheck(bool ok, const char *what);
+bool simAllOk();
+
+// Native runner modes (src/sim/), each returns the process exit code
+int runSnapshotStress(uint32_t iterations);
+int runFlashLogCheck(const char *path);
+int runCodecBenchmark(uint32_t samples);
+int runConfigCheck();
+int runEmaBenchmark(uint32_t samples);
+int runAttitudeBenchmark(uint32_t seconds);
+int runLogCheck(const char *path, uint32_t records);
+int runPortalCheck(uint32_t seconds);
+int runHealthCheck();
+int runHttpCheck();
+int runTraceCheck(const char *path, uint32_t periods);
+// timelinePath NULL prints the actuator changes to stdout
+int runTraceReplay(const char *path, const char *timelinePath);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Wait-free single-producer/single-consumer handoff of the latest value
+// (triple buffer). The producer always has a private slot to write into and
+// the consumer always has a private slot to read from; publish() and read()
+// swap slots through one atomic exchange, so neither side ever blocks and
+// the consumer never sees a half-written T.
+template <typename T>
+class Snapshot {
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t FRESH = 0x4; // middle slot holds an unread value
+
+    T slots[3];
+    uint8_t writeIndex; // producer-owned
+    uint8_t readIndex;  // consumer-owned
+    std::atomic<uint8_t> middle; // slot index | FRESH
+
+public:
+    Snapshot() : slots(), writeIndex(0), readIndex(1), middle(2) {}
+    explicit Snapshot(const T &initial)
+        : slots{initial, initial, initial}, writeIndex(0), readIndex(1),
+          middle(2) {}
+
+    // Producer: make value the latest snapshot
+    void publish(const T &value) {
+        slots[writeIndex] = value;
+        uint8_t previous =
+            middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+        writeIndex = previous & INDEX_MASK;
+    }
+
+    // Consumer: copy the latest snapshot into value. Returns false (and
+    // leaves the last value read in place) if nothing was published since.
+    bool read(T &value) {
+        bool fresh = (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+        if (fresh) {
+            uint8_t previous =
+                middle.exchange(readIndex, std::memory_order_acq_rel);
+            readIndex = previous & INDEX_MASK;
+        }
+        value = slots[readIndex];
+        return fresh;
+    }
+
+    // Consumer: the latest snapshot in place, without copying. The
+    // reference stays valid and unchanged until the next acquire() or
+    // read(); when nothing new was published this is a single load.
+    const T &acquire() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            uint8_t previous =
+                middle.exchange(readIndex, std::memory_order_acq_rel);
+            readIndex = previous & INDEX_MASK;
+        }
+        return slots[readIndex];
+    }
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include "config.h"
+#include "control.h"
+#include "ring_buffer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Every control tick, as it will be uploaded
+struct TelemetrySample {
+  uint64_t timestampUs; // timebaseMicros() at acquisition
+  uint64_t epochMs;     // timebaseEpochMs() at acquisition, 0 if unsynced
+  SensorData data;
+  ActuatorState actuators;
+  uint8_t health; // sensorHealthPacked() of this tick
+#if TELEMETRY_LATENCY
+  uint32_t latencyUs; // latencySensorAgeUs() of this tick
+#endif
+};
+
+// controlTask pushes one sample per tick; firebaseTask pops them in batches
+typedef RingBuffer<TelemetrySample, TELEMETRY_BUFFER_SAMPLES> TelemetryBuffer;
+extern TelemetryBuffer telemetryBuffer;
+
+// Collects samples from telemetryBuffer until a batch is due: either
+// TELEMETRY_BATCH_SIZE samples are waiting or the oldest one has waited
+// TELEMETRY_MAX_LATENCY_MS.
+class TelemetryBatch {
+private:
+  TelemetrySample samples[TELEMETRY_BATCH_SIZE];
+  size_t count;
+
+public:
+  TelemetryBatch() : count(0) {}
+
+  // Pull whatever fits from the ring buffer; returns true when due
+  bool fill(TelemetryBuffer &buffer, uint64_t nowUs) {
+    count += buffer.popMany(samples + count, TELEMETRY_BATCH_SIZE - count);
+    if (count == TELEMETRY_BATCH_SIZE)
+      return true;
+    return count > 0 && nowUs - samples[0].timestampUs >=
+                            TELEMETRY_MAX_LATENCY_MS * 1000ULL;
+  }
+
+  const TelemetrySample *data() const { return samples; }
+  size_t size() const { return count; }
+  void clear() { count = 0; }
+};
+
+// Whether a tick's sample should be queued. Ticks can run faster than
+// CONTROL_PERIOD_MS (adaptive_rate.h); the upload keeps at most one sample
+// per period, plus every tick that changed an actuator or a sensor's
+// health.
+bool telemetryDue(const TelemetrySample &sample);
+
+// Firebase-style push key (20 chars + NUL) for a sample taken at epochMs.
+// Keys sort by time, and keys made in the same millisecond still sort in
+// call order.
+void telemetryPushKey(uint64_t epochMs, char key[21]);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+#include "telemetry.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary encoding of a batch of TelemetrySamples, shared by the
+// device (encoder) and the ingest side (decoder).
+//
+// Batch layout, version 4 (all integers are LEB128 varints, signed values
+// zigzag-encoded):
+//   u8      version
+//   varint  sample count
+//   varint  uptime of the first sample, ms
+//   varint  wall-clock time of the first sample, ms (0 = not synced)
+//   per sample:
+//     u8      flags: bit 0 fog light, 1 warning light, 2 buzzer,
+//             3 no wall clock for this sample, 4-7 RuleBits 0-3
+//             (RULE_DARK is the fog light bit)
+//     u8      sensorHealthPacked() (sensor_health.h)
+//     varint  uptime delta from the previous sample, ms
+//     zigzag  wall-clock drift from the uptime delta, ms (when bit 3 clear)
+//     zigzag  x5  quantized sensor deltas from the previous sample, in the
+//             order and units of TELEMETRY_CODEC_SCALE
+//
+// Quantized values start from 0 at the top of each batch, so a batch
+// decodes on its own.
+#define TELEMETRY_CODEC_VERSION 4
+
+// Quantization steps: light 0.1 lux, distance 0.1 cm, accel 0.01 m/s^2,
+// tilt 0.01 degrees
+static const float TELEMETRY_CODEC_SCALE[5] = {10.0f, 10.0f, 100.0f, 100.0f,
+                                               100.0f};
+
+// Worst-case encoded size of a batch of `count` samples: header (version,
+// count, two 64-bit varints) plus flags, health, two 64-bit and five 32-bit
+// varints per sample
+#define TELEMETRY_ENCODED_BOUND(count) (26 + (count) * 47)
+
+// Returns the encoded length, or 0 if `capacity` is too small
+size_t telemetryEncode(const TelemetrySample *samples, size_t count,
+                       uint8_t *out, size_t capacity);
+
+// Returns the number of samples decoded, or -1 if the data is truncated,
+// malformed, from an unknown version, or holds more than maxSamples
+int telemetryDecode(const uint8_t *data, size_t length,
+                    TelemetrySample *samples, size_t maxSamples);
+
+// Standard base64 (RFC 4648, padded), for carrying a batch in a JSON string.
+// Encode returns the length without the NUL, or 0 if it does not fit;
+// decode returns the byte count, or -1 on invalid input.
+size_t base64Encode(const uint8_t *data, size_t length, char *out,
+                    size_t capacity);
+int base64Decode(const char *text, size_t length, uint8_t *out,
+                 size_t capacity);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef TELEMETRY_JSON_H
+#define TELEMETRY_JSON_H
+#include "config.h"
+#include "telemetry.h"
+#include <stddef.h>
+
+// Upper bound of one serialized entry (push key, sensors, actuators,
+// warning, sensor health, both timestamps and the optional latency)
+#define TELEMETRY_JSON_ENTRY_BYTES (TELEMETRY_LATENCY ? 400 : 368)
+// Sized for the largest batch the uplink sends (a replay batch)
+#define TELEMETRY_JSON_BUFFER_BYTES                                            \
+  (TELEMETRY_REPLAY_BATCH * TELEMETRY_JSON_ENTRY_BYTES + 2)
+
+// Renders a batch as the body of one multi-location update under
+// FIREBASE_TELEMETRY_PATH: {"<push key>":{"sensors":{...},...},...}. Samples
+// without a wall clock are keyed by uptime, and the newest of them gets the
+// server timestamp. Returns the body length, or 0 if it does not fit.
+size_t telemetryToJson(const TelemetrySample *samples, size_t count, char *out,
+                       size_t capacity);
+
+// Sensor health counters (sensor_health.h) and the I2C bus clears, as the
+// body written to FIREBASE_HEALTH_PATH: {"imu":{"state":"ok","missed":0,
+// ...},"lidar":{...},"i2c_recoveries":0,"timestamp":{".sv":...}}
+#define HEALTH_JSON_BYTES 320
+size_t healthToJson(uint32_t busRecoveries, char *out, size_t capacity);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+#include "flash_storage.h"
+#include "telemetry.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct TelemetryLogStats {
+  uint32_t appended;  // samples written
+  uint32_t replayed;  // samples marked sent
+  uint32_t lost;      // unsent samples overwritten because the log was full
+  uint32_t corrupt;   // records skipped on a CRC or header mismatch
+  uint32_t erases;    // sector erases since begin()
+  uint32_t maxEraseCount; // highest per-segment erase count seen
+};
+
+// Append-only store-and-forward log of TelemetrySamples.
+//
+// The storage is split into sector-sized segments used as a ring: each
+// segment starts with a header carrying a sequence number and its erase
+// count, followed by CRC-protected records. Records are marked sent in
+// place (the marker word is programmed from 0xFFFFFFFF to 0), so after a
+// reboot begin() finds the oldest unsent record without a separate index.
+// When the ring is full the oldest segment is recycled and its unsent
+// samples are counted as lost.
+class TelemetryLog {
+public:
+  TelemetryLog();
+
+  // Recover state from storage (formats it if no valid segment is found)
+  bool begin(FlashStorage *storage);
+  bool append(const TelemetrySample &sample);
+  // Copy up to maxSamples of the oldest unsent samples without consuming
+  size_t peek(TelemetrySample *samples, size_t maxSamples);
+  // Mark the `count` oldest unsent samples as sent
+  void consume(size_t count);
+
+  size_t pending() const { return pendingCount; }
+  // Unsent samples guaranteed to survive a full ring (one segment less
+  // than the storage holds, since the head segment is recycled whole)
+  size_t capacity() const;
+  TelemetryLogStats stats() const { return logStats; }
+
+private:
+  struct Position {
+    uint32_t segment;
+    uint32_t offset; // byte offset inside the segment
+  };
+
+  FlashStorage *storage;
+  uint32_t segmentCount;
+  uint32_t segmentSize;
+  uint32_t headSequence;
+  Position head; // next write
+  Position tail; // oldest unsent record (== head when empty)
+  size_t pendingCount;
+  TelemetryLogStats logStats;
+
+  size_t address(const Position &pos) const;
+  bool openSegment(uint32_t segment, uint32_t sequence);
+  bool readRecord(const Position &pos, TelemetrySample *sample, bool &sent,
+                  bool &valid, uint32_t &state);
+  bool nextRecord(Position &pos);
+  void skipSent(Position &pos);
+  uint32_t countPending(uint32_t segment);
+};
+
+#endif
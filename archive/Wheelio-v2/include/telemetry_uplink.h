@@ -0,0 +1,33 @@
+#ifndef TELEMETRY_UPLINK_H
+#define TELEMETRY_UPLINK_H
+#include "flash_storage.h"
+#include "telemetry.h"
+#include "telemetry_log.h"
+#include <stdint.h>
+
+struct UplinkStats {
+  uint32_t sent;     // live samples uploaded
+  uint32_t logged;   // samples written to the offline log
+  uint32_t replayed; // logged samples uploaded later
+  uint32_t failures; // failed upload requests
+  uint32_t dropped;  // samples lost with no log to hold them
+};
+
+// Store-and-forward policy for firebaseTask. Live batches always go first;
+// batches that cannot be sent (uploader not ready, request failed, uploads
+// paused) are appended to the offline log, which is drained in
+// TELEMETRY_REPLAY_BATCH chunks at most once per
+// TELEMETRY_REPLAY_INTERVAL_MS so a backlog never starves live uploads.
+// While the link is up the sensor health counters are also written every
+// HEALTH_REPORT_INTERVAL_MS.
+//
+// storage may be NULL, in which case unsendable batches are dropped as
+// before. Returns false if the log could not be opened.
+bool uplinkInit(FlashStorage *storage);
+// One pass of the upload task: pull from buffer, send or log, replay
+void uplinkPoll(TelemetryBuffer &buffer, bool paused, uint64_t nowUs);
+UplinkStats uplinkStats();
+size_t uplinkBacklog();
+TelemetryLogStats uplinkLogStats();
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+#include <stdint.h>
+
+// Monotonic time since boot. Backed by esp_timer on the board and by a
+// virtual clock in the native simulation build.
+uint32_t timebaseMillis();
+uint64_t timebaseMicros();
+// Wall-clock milliseconds since the Unix epoch, or 0 until SNTP has set
+// the clock
+uint64_t timebaseEpochMs();
+
+// Free-running counter for timing short code paths: CPU cycles on the
+// board, host nanoseconds in the native build (real time, not the virtual
+// clock). Wraps; only differences are meaningful.
+uint32_t timebaseCycles();
+uint32_t timebaseCyclesPerUs();
+
+#endif
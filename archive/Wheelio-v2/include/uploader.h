@@ -0,0 +1,15 @@
+#ifndef UPLOADER_H
+#define UPLOADER_H
+#include "telemetry.h"
+#include <stddef.h>
+
+// Telemetry sink. The board build talks to Firebase RTDB; the native build
+// records what would have been sent.
+void uploaderInit();
+bool uploaderReady();
+// Upload `count` samples in one request
+bool uploaderSendBatch(const TelemetrySample *samples, size_t count);
+// Overwrite the sensor health counters (healthToJson() in telemetry_json.h)
+bool uploaderSendHealth();
+
+#endif
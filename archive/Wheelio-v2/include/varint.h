@@ -0,0 +1,70 @@
+#ifndef VARINT_H
+#define VARINT_H
+#include <stddef.h>
+#include <stdint.h>
+
+// LEB128 varints and zigzag-signed varints over a caller's buffer, shared
+// by the telemetry codec and the raw trace. Neither cursor writes or reads
+// past its buffer: `ok` goes false on overflow and stays false, so a codec
+// can check once at the end.
+
+// Bounded output cursor
+struct VarintWriter {
+  uint8_t *out;
+  size_t capacity;
+  size_t length;
+  bool ok;
+
+  void byte(uint8_t b) {
+    if (length < capacity)
+      out[length++] = b;
+    else
+      ok = false;
+  }
+
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      byte((uint8_t)(value | 0x80));
+      value >>= 7;
+    }
+    byte((uint8_t)value);
+  }
+
+  void zigzag(int64_t value) {
+    varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+  }
+};
+
+// Bounded input cursor; reads past the end return 0
+struct VarintReader {
+  const uint8_t *data;
+  size_t length;
+  size_t pos;
+  bool ok;
+
+  uint8_t byte() {
+    if (pos < length)
+      return data[pos++];
+    ok = false;
+    return 0;
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      value |= (uint64_t)(b & 0x7F) << shift;
+      if (!(b & 0x80))
+        return value;
+    }
+    ok = false; // over-long
+    return 0;
+  }
+
+  int64_t zigzag() {
+    uint64_t raw = varint();
+    return (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+  }
+};
+
+#endif
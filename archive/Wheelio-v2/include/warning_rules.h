@@ -0,0 +1,138 @@
+#ifndef WARNING_RULES_H
+#define WARNING_RULES_H
+#include "config.h"
+#include "control.h"
+#include "runtime_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Every warning and actuator rule, in one table. Each tick evaluates the
+// table once into a mask of RuleBits; the relays, the upload message, the
+// flash log and the packed codec all work from that mask. Adding a rule is
+// a RuleBit plus a row in WARNING_RULES (and a threshold in RuntimeConfig).
+// scripts/test_data_rest.py parses the table; keep each row a flat {...}.
+
+enum RuleBit {
+  RULE_LIDAR,     // obstacle in range
+  RULE_TILT_SIDE, // leaning over
+  RULE_TILT_FB,   // pitched forward or back
+  RULE_ACCEL_X,   // hard forward acceleration or braking
+  RULE_DARK,      // ambient light low
+  RULE_COUNT,
+};
+
+enum RuleTest {
+  RULE_ABOVE_ABS, // |reading| > threshold
+  RULE_BELOW,     // reading < threshold
+  RULE_IN_RANGE,  // 0 < reading < threshold (0 is no target)
+};
+
+// Actuators a rule drives
+#define ACTUATE_FOG 0x01
+#define ACTUATE_WARNING_LIGHT 0x02
+#define ACTUATE_BUZZER 0x04
+
+struct Rule {
+  RuleBit bit;
+  float SensorData::*reading;
+  float RuntimeConfig::*threshold;
+  RuleTest test;
+  // Once on, the reading must clear the threshold by this much (in its own
+  // units) to turn the rule off, and not before minOnMs have passed
+  float hysteresis;
+  uint32_t minOnMs;
+  uint8_t actuators;
+  WarningKind kind; // message group; WARNING_NONE if not a warning
+};
+
+// bit, reading, threshold, test, hysteresis, minOnMs, actuators, kind
+constexpr Rule WARNING_RULES[] = {
+    {RULE_LIDAR, &SensorData::distanceRaw, &RuntimeConfig::distThreshold,
+     RULE_IN_RANGE, RULE_DIST_HYSTERESIS_CM, RULE_WARNING_MIN_ON_MS,
+     ACTUATE_WARNING_LIGHT, WARNING_LIDAR},
+    {RULE_TILT_SIDE, &SensorData::tiltSideRaw,
+     &RuntimeConfig::tiltSideThreshold, RULE_ABOVE_ABS,
+     RULE_TILT_HYSTERESIS_DEG, RULE_WARNING_MIN_ON_MS,
+     ACTUATE_WARNING_LIGHT | ACTUATE_BUZZER, WARNING_MPU},
+    {RULE_TILT_FB, &SensorData::tiltFBRaw, &RuntimeConfig::tiltFBThreshold,
+     RULE_ABOVE_ABS, RULE_TILT_HYSTERESIS_DEG, RULE_WARNING_MIN_ON_MS,
+     ACTUATE_WARNING_LIGHT | ACTUATE_BUZZER, WARNING_MPU},
+    {RULE_ACCEL_X, &SensorData::accelXRaw, &RuntimeConfig::accelThreshold,
+     RULE_ABOVE_ABS, RULE_ACCEL_HYSTERESIS, RULE_WARNING_MIN_ON_MS,
+     ACTUATE_WARNING_LIGHT | ACTUATE_BUZZER, WARNING_MPU},
+    {RULE_DARK, &SensorData::lumensRaw, &RuntimeConfig::lightThreshold,
+     RULE_BELOW, RULE_LIGHT_HYSTERESIS, RULE_FOG_MIN_ON_MS, ACTUATE_FOG,
+     WARNING_NONE},
+};
+
+// Compile-time checks and masks over the table
+constexpr bool rulesInOrder(size_t i = 0) {
+  return i == RULE_COUNT ||
+         (WARNING_RULES[i].bit == (RuleBit)i && rulesInOrder(i + 1));
+}
+constexpr uint8_t rulesDriving(uint8_t actuator, size_t i = 0) {
+  return i == RULE_COUNT
+             ? 0
+             : (uint8_t)(((WARNING_RULES[i].actuators & actuator)
+                              ? 1u << i
+                              : 0u) |
+                         rulesDriving(actuator, i + 1));
+}
+constexpr uint8_t rulesOfKind(WarningKind kind, size_t i = 0) {
+  return i == RULE_COUNT ? 0
+                         : (uint8_t)((WARNING_RULES[i].kind == kind ? 1u << i
+                                                                     : 0u) |
+                                     rulesOfKind(kind, i + 1));
+}
+
+static_assert(sizeof(WARNING_RULES) / sizeof(WARNING_RULES[0]) == RULE_COUNT,
+              "one row per RuleBit");
+static_assert(rulesInOrder(), "rows in RuleBit order");
+static_assert(RULE_COUNT <= 8, "ActuatorState keeps the mask in a byte");
+
+constexpr uint8_t RULES_ALL = (1u << RULE_COUNT) - 1;
+constexpr uint8_t FOG_RULES = rulesDriving(ACTUATE_FOG);
+constexpr uint8_t WARNING_LIGHT_RULES = rulesDriving(ACTUATE_WARNING_LIGHT);
+constexpr uint8_t BUZZER_RULES = rulesDriving(ACTUATE_BUZZER);
+constexpr uint8_t LIDAR_RULES = rulesOfKind(WARNING_LIDAR);
+constexpr uint8_t MPU_RULES = rulesOfKind(WARNING_MPU);
+
+// Rule state carried between ticks: what is on and since when
+class WarningRules {
+public:
+  WarningRules();
+
+  // Evaluates every rule against one tick's readings and snapshot; returns
+  // the mask of active RuleBits. Rules outside `usable` (a failed sensor's,
+  // sensor_health.h) are off at once, minimum on time or not.
+  uint8_t evaluate(const SensorData &data, const RuntimeConfig &cfg,
+                   uint64_t nowUs, uint8_t usable = RULES_ALL);
+  uint8_t active() const { return mask; }
+
+private:
+  uint8_t mask;
+  uint64_t onSinceUs[RULE_COUNT];
+};
+
+// Relay states for a rule mask
+inline ActuatorState actuatorsFor(uint8_t rules) {
+  ActuatorState state;
+  state.fogLight = rules & FOG_RULES;
+  state.warningLight = rules & WARNING_LIGHT_RULES;
+  state.buzzer = rules & BUZZER_RULES;
+  state.rules = rules;
+  return state;
+}
+
+// Which sensor groups a rule mask has warnings from
+inline WarningKind warningKindOf(uint8_t rules) {
+  return (WarningKind)(((rules & LIDAR_RULES) ? WARNING_LIDAR : 0) |
+                       ((rules & MPU_RULES) ? WARNING_MPU : 0));
+}
+
+// The uploaded "warning" message
+inline const char *warningMessage(uint8_t rules) {
+  return WARNING_MESSAGES[warningKindOf(rules)];
+}
+
+#endif
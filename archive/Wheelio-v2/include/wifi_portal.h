@@ -0,0 +1,28 @@
+#ifndef WIFI_PORTAL_H
+#define WIFI_PORTAL_H
+
+// WiFi provisioning that blocks nothing but its own task. WiFiManager runs
+// in non-blocking mode: opening the portal (access point WIFI_AP_NAME and
+// its captive page) returns at once, and the portal task then services it
+// one wifiPortalPoll() at a time until a network is joined or
+// WIFI_PORTAL_TIMEOUT_S passes. The board build drives WiFiManager; the
+// native build emulates a portal whose page handling takes host time.
+
+enum WifiPortalState {
+  WIFI_PORTAL_CLOSED,
+  WIFI_PORTAL_OPEN,      // access point up, waiting for credentials
+  WIFI_PORTAL_CONNECTED, // joined a network
+  WIFI_PORTAL_TIMED_OUT, // closed without one
+};
+
+// Boot: join the saved network, waiting at most WIFI_CONNECT_TIMEOUT_S, or
+// else leave the portal open. Returns true when connected.
+bool wifiPortalBegin();
+// Open the portal on the next poll (boot button); safe from any task
+void wifiPortalRequest();
+// One step of the portal, from the portal task only
+WifiPortalState wifiPortalPoll();
+// The state after the last poll, from any task
+WifiPortalState wifiPortalState();
+
+#endif
@@ -1,5 +1,6 @@
 #include "actuators.h"
 #include "config.h"
+#include <Arduino.h>
 
 void actuatorsInit() {
   pinMode(PIN_RELAY_FOG, OUTPUT);
@@ -0,0 +1,68 @@
+#include "adaptive_rate.h"
+#include "config.h"
+#include <math.h>
+
+static float tiltProximity(float tilt, float threshold) {
+  return threshold > 0.0f ? fabsf(tilt) / threshold : 0.0f;
+}
+
+// 0 with nothing in range, 1 at the threshold
+static float distanceProximity(float distance, float threshold) {
+  if (distance <= 0.0f)
+    return 0.0f;
+  float span = LIDAR_MAX_RANGE_CM - threshold;
+  if (span <= 0.0f)
+    return distance < LIDAR_MAX_RANGE_CM ? 1.0f : 0.0f;
+  return (LIDAR_MAX_RANGE_CM - distance) / span;
+}
+
+AdaptiveRate::AdaptiveRate()
+    : period(CONTROL_PERIOD_MS), lastProximity(0.0f), lastTiltSide(0.0f),
+      lastTiltFB(0.0f), lastDistance(0.0f), lastUs(0) {}
+
+uint32_t AdaptiveRate::update(const SensorData &data,
+                              const ActuatorState &state,
+                              const RuntimeConfig &cfg, uint64_t nowUs) {
+  // How many of the last tick's changes fit in the lookahead; none on the
+  // first tick
+  float ahead = 0.0f;
+  if (lastUs != 0 && nowUs > lastUs)
+    ahead = ADAPTIVE_LOOKAHEAD_MS * 1000.0f / (float)(nowUs - lastUs);
+
+  float side = data.tiltSideRaw;
+  float fb = data.tiltFBRaw;
+  float distance = data.distanceRaw;
+  float p = fmaxf(
+      tiltProximity(side, cfg.tiltSideThreshold),
+      tiltProximity(side + (side - lastTiltSide) * ahead,
+                    cfg.tiltSideThreshold));
+  p = fmaxf(p, tiltProximity(fb, cfg.tiltFBThreshold));
+  p = fmaxf(p, tiltProximity(fb + (fb - lastTiltFB) * ahead,
+                             cfg.tiltFBThreshold));
+  p = fmaxf(p, distanceProximity(distance, cfg.distThreshold));
+  if (lastDistance > 0.0f)
+    p = fmaxf(p, distanceProximity(distance + (distance - lastDistance) * ahead,
+                                   cfg.distThreshold));
+  if (state.warningLight)
+    p = 1.0f;
+  lastTiltSide = side;
+  lastTiltFB = fb;
+  lastDistance = distance;
+  lastUs = nowUs;
+  lastProximity = p;
+
+  float target;
+  if (p >= cfg.fastProximity) {
+    target = cfg.fastPeriodMs;
+  } else if (p <= cfg.idleProximity) {
+    target = cfg.idlePeriodMs;
+  } else {
+    float k = (p - cfg.idleProximity) / (cfg.fastProximity - cfg.idleProximity);
+    target = cfg.idlePeriodMs + (cfg.fastPeriodMs - cfg.idlePeriodMs) * k;
+  }
+  if (target < period)
+    period = target;
+  else
+    period = fminf(target, period * ADAPTIVE_BACKOFF);
+  return (uint32_t)period;
+}
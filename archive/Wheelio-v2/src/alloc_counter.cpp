@@ -0,0 +1,42 @@
+#include "alloc_counter.h"
+#include <stddef.h>
+
+#ifdef WHEELIO_COUNT_ALLOCS
+static uint32_t allocations = 0;
+
+static inline void countAllocation() {
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+}
+
+// Linked with -Wl,--wrap=malloc etc.: every call lands here first
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  countAllocation();
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  countAllocation();
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  countAllocation();
+  return __real_realloc(ptr, size);
+}
+}
+
+uint32_t allocCount() {
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+bool allocCountEnabled() { return true; }
+#else
+uint32_t allocCount() { return 0; }
+
+bool allocCountEnabled() { return false; }
+#endif
@@ -0,0 +1,104 @@
+#include "attitude.h"
+#include <math.h>
+
+#define GRAVITY 9.80665f
+#define RAD_TO_DEG_F 57.2957795f
+// Frames further apart than this (polling, a stalled FIFO) are integrated
+// as this long, so one late frame cannot spin the attitude
+#define MAX_DT_S 0.2f
+
+AttitudeEstimator::AttitudeEstimator(float kp, float ki, float accelGate)
+    : kp(kp), ki(ki), accelGate(accelGate), rejected(0) {
+  reset();
+}
+
+void AttitudeEstimator::reset() {
+  q0 = 1.0f;
+  q1 = q2 = q3 = 0.0f;
+  biasX = biasY = biasZ = 0.0f;
+  lastUs = 0;
+  seeded = false;
+}
+
+// Roll/pitch from gravity alone, yaw 0
+void AttitudeEstimator::seed(const ImuFrame &frame) {
+  float roll = atan2f(frame.accelY, frame.accelZ);
+  float pitch = atan2f(-frame.accelX, sqrtf(frame.accelY * frame.accelY +
+                                            frame.accelZ * frame.accelZ));
+  float cr = cosf(roll / 2), sr = sinf(roll / 2);
+  float cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+  q0 = cr * cp;
+  q1 = sr * cp;
+  q2 = cr * sp;
+  q3 = -sr * sp;
+  lastUs = frame.timestampUs;
+  seeded = true;
+}
+
+void AttitudeEstimator::update(const ImuFrame &frame) {
+  if (!seeded) {
+    seed(frame);
+    return;
+  }
+  float dt = (frame.timestampUs - lastUs) / 1e6f;
+  lastUs = frame.timestampUs;
+  if (dt > MAX_DT_S)
+    dt = MAX_DT_S;
+
+  float gx = frame.gyroX, gy = frame.gyroY, gz = frame.gyroZ;
+  float ax = frame.accelX, ay = frame.accelY, az = frame.accelZ;
+  float norm = sqrtf(ax * ax + ay * ay + az * az);
+  if (fabsf(norm - GRAVITY) <= accelGate * GRAVITY) {
+    ax /= norm;
+    ay /= norm;
+    az /= norm;
+    // Gravity as the current attitude predicts it, halved
+    float vx = q1 * q3 - q0 * q2;
+    float vy = q0 * q1 + q2 * q3;
+    float vz = q0 * q0 - 0.5f + q3 * q3;
+    // Error is the cross product between measured and predicted gravity
+    float ex = ay * vz - az * vy;
+    float ey = az * vx - ax * vz;
+    float ez = ax * vy - ay * vx;
+    if (ki > 0.0f) {
+      biasX += 2.0f * ki * ex * dt;
+      biasY += 2.0f * ki * ey * dt;
+      biasZ += 2.0f * ki * ez * dt;
+    }
+    gx += 2.0f * kp * ex;
+    gy += 2.0f * kp * ey;
+    gz += 2.0f * kp * ez;
+  } else {
+    rejected++;
+  }
+  gx += biasX;
+  gy += biasY;
+  gz += biasZ;
+
+  // q += 0.5 * q * omega * dt
+  gx *= 0.5f * dt;
+  gy *= 0.5f * dt;
+  gz *= 0.5f * dt;
+  float a = q0, b = q1, c = q2;
+  q0 += -b * gx - c * gy - q3 * gz;
+  q1 += a * gx + c * gz - q3 * gy;
+  q2 += a * gy - b * gz + q3 * gx;
+  q3 += a * gz + b * gy - c * gx;
+  float qn = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q0 *= qn;
+  q1 *= qn;
+  q2 *= qn;
+  q3 *= qn;
+}
+
+float AttitudeEstimator::tiltSide() const {
+  float vy = q0 * q1 + q2 * q3;
+  float vz = q0 * q0 - 0.5f + q3 * q3;
+  return atan2f(vy, vz) * RAD_TO_DEG_F;
+}
+
+float AttitudeEstimator::tiltFB() const {
+  float vx = q1 * q3 - q0 * q2;
+  float vz = q0 * q0 - 0.5f + q3 * q3;
+  return atan2f(vx, vz) * RAD_TO_DEG_F;
+}
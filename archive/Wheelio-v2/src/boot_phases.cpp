@@ -0,0 +1,27 @@
+#include "boot_phases.h"
+#include "config.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include <atomic>
+
+static const char *const PHASE_NAMES[BOOT_PHASES] = {
+    "config", "actuators", "sensors", "first tick", "wifi", "time", "cloud",
+    "stream"};
+
+static std::atomic<uint32_t> doneMs[BOOT_PHASES];
+
+void bootPhaseDone(BootPhase phase) {
+  uint32_t ms = timebaseMillis();
+  if (ms == 0)
+    ms = 1; // 0 reads as not done
+  uint32_t notDone = 0;
+  if (!doneMs[phase].compare_exchange_strong(notDone, ms))
+    return;
+  LOG(MSG_BOOT_PHASE, PHASE_NAMES[phase], ms);
+  if (phase == BOOT_FIRST_TICK && ms > BOOT_SAFETY_TARGET_MS)
+    LOG(MSG_BOOT_SLOW, ms, BOOT_SAFETY_TARGET_MS);
+}
+
+uint32_t bootPhaseMs(BootPhase phase) { return doneMs[phase].load(); }
+
+const char *bootPhaseName(BootPhase phase) { return PHASE_NAMES[phase]; }
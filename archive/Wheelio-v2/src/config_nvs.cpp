@@ -0,0 +1,62 @@
+#include "config.h"
+#include "config_params.h"
+#include "config_store.h"
+#include "debug_log.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+
+#define NVS_NAMESPACE "config"
+#define NVS_BLOB_KEY "params"
+
+static Preferences preferences;
+// What NVS holds, so unchanged saves skip the write
+static uint8_t stored[CONFIG_BLOB_MAX_BYTES];
+static size_t storedLength = 0;
+
+// Before the blob, thresholds were single floats. Only keys of at most 15
+// characters ever made it into NVS.
+static void loadLegacyKeys() {
+  for (size_t i = 0; i < CONFIG_PARAM_COUNT; i++) {
+    const ParamDescriptor &param = CONFIG_PARAMS[i];
+    if (strlen(param.name) <= 15 && preferences.isKey(param.name))
+      configSetParam(param, preferences.getFloat(param.name,
+                                                 configParamValue(param)));
+  }
+  configPublish();
+}
+
+bool configLoad() {
+  if (!preferences.begin(NVS_NAMESPACE, true)) {
+    // Namespace not created yet: first boot, keep the defaults
+    return false;
+  }
+  storedLength = preferences.getBytes(NVS_BLOB_KEY, stored, sizeof(stored));
+  bool loaded = storedLength > 0 && configDeserialize(stored, storedLength);
+  if (!loaded) {
+    if (storedLength > 0)
+      LOG(MSG_CONFIG_BLOB_BAD);
+    storedLength = 0;
+    loadLegacyKeys();
+  }
+  preferences.end();
+  return loaded;
+}
+
+bool configSave() {
+  uint8_t blob[CONFIG_BLOB_MAX_BYTES];
+  size_t length = configSerialize(blob, sizeof(blob));
+  if (length == 0)
+    return false;
+  if (length == storedLength && memcmp(blob, stored, length) == 0)
+    return true; // unchanged: no flash write
+
+  preferences.begin(NVS_NAMESPACE, false);
+  bool ok = preferences.putBytes(NVS_BLOB_KEY, blob, length) == length;
+  preferences.end();
+  if (ok) {
+    memcpy(stored, blob, length);
+    storedLength = length;
+  }
+  return ok;
+}
@@ -0,0 +1,194 @@
+#include "config_params.h"
+#include "config.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// name, field, min, max, flags
+constexpr ParamDescriptor CONFIG_PARAMS[] = {
+    {"TILT_SIDE_THRESHOLD", &RuntimeConfig::tiltSideThreshold, 0.0f, 90.0f,
+     PARAM_PERSIST},
+    {"TILT_FB_THRESHOLD", &RuntimeConfig::tiltFBThreshold, 0.0f, 90.0f,
+     PARAM_PERSIST},
+    {"DIST_THRESHOLD", &RuntimeConfig::distThreshold, 0.0f, 400.0f,
+     PARAM_PERSIST},
+    {"LIGHT_THRESHOLD", &RuntimeConfig::lightThreshold, 0.0f, 100000.0f,
+     PARAM_PERSIST},
+    {"ACCEL_THRESHOLD", &RuntimeConfig::accelThreshold, 0.0f, 20.0f,
+     PARAM_PERSIST},
+    {"EMA_ALPHA_LIGHT", &RuntimeConfig::lightAlpha, 0.001f, 1.0f,
+     PARAM_PERSIST},
+    {"EMA_ALPHA_LIDAR", &RuntimeConfig::lidarAlpha, 0.001f, 1.0f,
+     PARAM_PERSIST},
+    {"EMA_ALPHA_MPU", &RuntimeConfig::mpuAlpha, 0.001f, 1.0f, PARAM_PERSIST},
+    {"LIGHT_ADJUSTMENT", &RuntimeConfig::lightAdjustment, -10000.0f, 10000.0f,
+     PARAM_PERSIST},
+    {"LIDAR_ADJUSTMENT", &RuntimeConfig::lidarAdjustment, -400.0f, 400.0f,
+     PARAM_PERSIST},
+    {"ACCEL_X_ADJUSTMENT", &RuntimeConfig::accelXAdjustment, -20.0f, 20.0f,
+     PARAM_PERSIST},
+    {"TILT_SIDE_ADJUSTMENT", &RuntimeConfig::tiltSideAdjustment, -90.0f, 90.0f,
+     PARAM_PERSIST},
+    {"TILT_FB_ADJUSTMENT", &RuntimeConfig::tiltFBAdjustment, -90.0f, 90.0f,
+     PARAM_PERSIST},
+    {"FAST_PERIOD_MS", &RuntimeConfig::fastPeriodMs, 10.0f,
+     ADAPTIVE_MAX_PERIOD_MS, PARAM_PERSIST},
+    {"IDLE_PERIOD_MS", &RuntimeConfig::idlePeriodMs, 10.0f,
+     ADAPTIVE_MAX_PERIOD_MS, PARAM_PERSIST},
+    {"FAST_PROXIMITY", &RuntimeConfig::fastProximity, 0.0f, 2.0f,
+     PARAM_PERSIST},
+    {"IDLE_PROXIMITY", &RuntimeConfig::idleProximity, 0.0f, 2.0f,
+     PARAM_PERSIST},
+};
+const size_t CONFIG_PARAM_COUNT =
+    sizeof(CONFIG_PARAMS) / sizeof(CONFIG_PARAMS[0]);
+
+const ParamDescriptor *configFindParam(const char *name, size_t length) {
+  for (size_t i = 0; i < CONFIG_PARAM_COUNT; i++) {
+    if (strncmp(CONFIG_PARAMS[i].name, name, length) == 0 &&
+        CONFIG_PARAMS[i].name[length] == '\0')
+      return &CONFIG_PARAMS[i];
+  }
+  return NULL;
+}
+
+ParamResult configSetParam(const ParamDescriptor &param, float value) {
+  if (!(value >= param.minValue && value <= param.maxValue))
+    return PARAM_OUT_OF_RANGE;
+  float &target = configDraft().*param.field;
+  if (target == value)
+    return PARAM_UNCHANGED;
+  target = value;
+  return PARAM_APPLIED;
+}
+
+float configParamValue(const ParamDescriptor &param) {
+  return configDraft().*param.field;
+}
+
+static const char *skipSpace(const char *p) {
+  while (*p && isspace((unsigned char)*p))
+    p++;
+  return p;
+}
+
+// Skips one JSON value of any type; NULL if it is malformed
+static const char *skipValue(const char *p) {
+  p = skipSpace(p);
+  if (*p == '"') {
+    for (p++; *p && *p != '"'; p++) {
+      if (*p == '\\' && p[1])
+        p++;
+    }
+    return *p ? p + 1 : NULL;
+  }
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (*p) {
+      if (*p == '"') {
+        p = skipValue(p);
+        if (p == NULL)
+          return NULL;
+        continue;
+      }
+      if (*p == '{' || *p == '[')
+        depth++;
+      else if ((*p == '}' || *p == ']') && --depth == 0)
+        return p + 1;
+      p++;
+    }
+    return NULL;
+  }
+  while (*p && *p != ',' && *p != '}' && *p != ']' &&
+         !isspace((unsigned char)*p))
+    p++;
+  return p;
+}
+
+// Parses a JSON number spanning exactly [p, end)
+static bool parseNumber(const char *p, const char *end, float &value) {
+  char *stop;
+  value = strtof(p, &stop);
+  return stop != p && stop == end && isfinite(value);
+}
+
+static void applyOne(const char *name, size_t length, const char *value,
+                     const char *end, ConfigEventResult &result,
+                     ParamChangeFn onChange) {
+  if (end - value == 4 && strncmp(value, "null", 4) == 0)
+    return; // deleted key: keep the current value
+  const ParamDescriptor *param = configFindParam(name, length);
+  if (param == NULL) {
+    result.rejected++;
+    return;
+  }
+  float number = 0.0f;
+  ParamResult r = parseNumber(value, end, number)
+                      ? configSetParam(*param, number)
+                      : PARAM_BAD_VALUE;
+  if (r == PARAM_UNCHANGED) {
+    result.unchanged++;
+    return;
+  }
+  if (r == PARAM_APPLIED) {
+    result.applied++;
+    if (param->flags & PARAM_PERSIST)
+      result.persistChanged = true;
+  } else {
+    result.rejected++;
+  }
+  if (onChange)
+    onChange(*param, r, number);
+}
+
+static ConfigEventResult applyEvent(const char *path, const char *data,
+                                    ParamChangeFn onChange) {
+  ConfigEventResult result = {};
+  if (path == NULL || data == NULL || path[0] != '/')
+    return result;
+
+  if (path[1] != '\0') {
+    const char *name = path + 1;
+    const char *value = skipSpace(data);
+    const char *end = skipValue(value);
+    if (end != NULL && *skipSpace(end) == '\0')
+      applyOne(name, strlen(name), value, end, result, onChange);
+    else
+      result.rejected++;
+    return result;
+  }
+
+  // Object of keys at the root
+  const char *p = skipSpace(data);
+  if (*p != '{')
+    return result;
+  p = skipSpace(p + 1);
+  while (*p == '"') {
+    const char *name = p + 1;
+    const char *nameEnd = skipValue(p);
+    if (nameEnd == NULL)
+      break;
+    p = skipSpace(nameEnd);
+    if (*p != ':')
+      break;
+    const char *value = skipSpace(p + 1);
+    const char *end = skipValue(value);
+    if (end == NULL)
+      break;
+    applyOne(name, (size_t)(nameEnd - 1 - name), value, end, result, onChange);
+    p = skipSpace(end);
+    if (*p != ',')
+      break;
+    p = skipSpace(p + 1);
+  }
+  return result;
+}
+
+ConfigEventResult configApplyEvent(const char *path, const char *data,
+                                   ParamChangeFn onChange) {
+  ConfigEventResult result = applyEvent(path, data, onChange);
+  if (result.applied)
+    configPublish();
+  return result;
+}
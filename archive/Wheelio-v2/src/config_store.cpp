@@ -0,0 +1,76 @@
+#include "config_store.h"
+#include "config_params.h"
+#include "crc32.h"
+#include <string.h>
+
+#define CONFIG_BLOB_MAGIC 0x47464357u // "WCFG"
+
+struct ConfigBlobHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t crc; // over the entries
+};
+
+struct ConfigBlobEntry {
+  uint32_t keyHash;
+  float value;
+};
+
+static_assert(sizeof(ConfigBlobHeader) + CONFIG_BLOB_MAX_PARAMS *
+                                             sizeof(ConfigBlobEntry) ==
+                  CONFIG_BLOB_MAX_BYTES,
+              "CONFIG_BLOB_MAX_BYTES matches the layout");
+
+static uint32_t keyHash(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (; *name; name++)
+    hash = (hash ^ (uint8_t)*name) * 16777619u;
+  return hash;
+}
+
+size_t configSerialize(uint8_t *out, size_t capacity,
+                       const RuntimeConfig &from) {
+  ConfigBlobHeader header = {CONFIG_BLOB_MAGIC, CONFIG_BLOB_VERSION, 0, 0};
+  ConfigBlobEntry *entries = (ConfigBlobEntry *)(out + sizeof(header));
+  for (size_t i = 0; i < CONFIG_PARAM_COUNT; i++) {
+    const ParamDescriptor &param = CONFIG_PARAMS[i];
+    if (!(param.flags & PARAM_PERSIST))
+      continue;
+    if (header.count >= CONFIG_BLOB_MAX_PARAMS ||
+        sizeof(header) + (header.count + 1) * sizeof(ConfigBlobEntry) >
+            capacity)
+      return 0;
+    ConfigBlobEntry entry = {keyHash(param.name), from.*param.field};
+    memcpy(&entries[header.count++], &entry, sizeof(entry));
+  }
+  size_t length = header.count * sizeof(ConfigBlobEntry);
+  header.crc = crc32(entries, length);
+  memcpy(out, &header, sizeof(header));
+  return sizeof(header) + length;
+}
+
+bool configDeserialize(const uint8_t *data, size_t length) {
+  ConfigBlobHeader header;
+  if (length < sizeof(header))
+    return false;
+  memcpy(&header, data, sizeof(header));
+  size_t entriesLength = header.count * sizeof(ConfigBlobEntry);
+  if (header.magic != CONFIG_BLOB_MAGIC ||
+      header.version != CONFIG_BLOB_VERSION ||
+      length != sizeof(header) + entriesLength ||
+      crc32(data + sizeof(header), entriesLength) != header.crc)
+    return false;
+
+  for (uint16_t i = 0; i < header.count; i++) {
+    ConfigBlobEntry entry;
+    memcpy(&entry, data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    for (size_t p = 0; p < CONFIG_PARAM_COUNT; p++) {
+      const ParamDescriptor &param = CONFIG_PARAMS[p];
+      if ((param.flags & PARAM_PERSIST) && keyHash(param.name) == entry.keyHash)
+        configSetParam(param, entry.value);
+    }
+  }
+  configPublish();
+  return true;
+}
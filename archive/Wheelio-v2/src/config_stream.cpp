@@ -0,0 +1,47 @@
+#include "config_stream.h"
+#include "config.h"
+#include "config_params.h"
+#include "debug_log.h"
+#include <Arduino.h>
+#include <FirebaseESP32.h>
+
+static FirebaseData streamFbdo;
+static bool (*persistHandler)() = NULL;
+
+static void logChange(const ParamDescriptor &param, ParamResult result,
+                      float value) {
+  if (result == PARAM_APPLIED)
+    LOG(MSG_CONFIG_SET, param.name, value);
+  else if (result == PARAM_OUT_OF_RANGE)
+    LOG(MSG_CONFIG_OUT_OF_RANGE, param.name, value, param.minValue,
+        param.maxValue);
+  else
+    LOG(MSG_CONFIG_NOT_NUMBER, param.name);
+}
+
+static void streamCallback(FirebaseStream data) {
+  ConfigEventResult result = configApplyEvent(
+      data.dataPath().c_str(), data.payload().c_str(), logChange);
+  if (result.rejected)
+    LOG(MSG_CONFIG_REJECTED, result.rejected);
+  if (result.persistChanged && persistHandler != NULL && !persistHandler())
+    LOG(MSG_CONFIG_SAVE_FAILED);
+}
+
+static void streamTimeoutCallback(bool timeout) {
+  // The client reconnects by itself; the first event after that carries
+  // the whole document again
+  if (timeout)
+    LOG(MSG_CONFIG_STREAM_TIMEOUT);
+}
+
+bool configStreamBegin(bool (*onPersist)()) {
+  persistHandler = onPersist;
+  if (!Firebase.beginStream(streamFbdo, "/parameters")) {
+    LOG(MSG_CONFIG_STREAM_FAILED, streamFbdo.errorReason().c_str());
+    return false;
+  }
+  Firebase.setStreamCallback(streamFbdo, streamCallback,
+                             streamTimeoutCallback);
+  return true;
+}
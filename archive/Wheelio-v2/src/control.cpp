@@ -0,0 +1,168 @@
+#include "control.h"
+#include "actuators.h"
+#include "adaptive_rate.h"
+#include "config.h"
+#include "latency.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "raw_trace.h"
+#include "sensor_health.h"
+#include "timebase.h"
+#include "warning_rules.h"
+#include <math.h>
+
+// Smoothing for every SensorData field; alphas and offsets come from the
+// tick's RuntimeConfig
+FilterBank<SENSOR_CHANNELS> sensorFilters;
+static uint64_t lastFilterUs = 0;
+static uint64_t lastLidarUs = 0;
+static AdaptiveRate controlRate;
+static WarningRules warningRules;
+// The IMU's newest frame moves on whenever frames arrived
+static uint64_t lastImuUs = 0;
+
+// Indexed by WarningKind
+const char *const WARNING_MESSAGES[] = {"None", "Lidar warning", "MPU warning",
+                                        "Lidar+MPU warning"};
+
+void controlAcquire(RawSample &raw) {
+  raw.timestampUs = timebaseMicros();
+  raw.lumens = readLightLevel();
+  raw.lidarCount = 0;
+  while (raw.lidarCount < LIDAR_MAX_SAMPLES_PER_TICK &&
+         lidarReadSample(raw.lidar[raw.lidarCount]))
+    raw.lidarCount++;
+  raw.mpu = readMpuData();
+}
+
+// Alpha for a tick `ticks` nominal periods long, keeping the time constant
+static float alphaFor(float alpha, float ticks) {
+  return ticks == 1.0f ? alpha : 1.0f - powf(1.0f - alpha, ticks);
+}
+
+void controlFilter(const RawSample &raw, const RuntimeConfig &cfg,
+                   SensorData &out) {
+  // The configured alphas are per CONTROL_PERIOD_MS; ticks run faster or
+  // slower with the adaptive rate. The lidar channel is updated per range,
+  // and its alpha is rescaled to the spacing of the ranges instead.
+  float ticks = 1.0f;
+  if (lastFilterUs != 0 && raw.timestampUs > lastFilterUs)
+    ticks = (raw.timestampUs - lastFilterUs) / (CONTROL_PERIOD_MS * 1000.0f);
+  lastFilterUs = raw.timestampUs;
+
+  // Alphas come with the snapshot, so a change applies from the next tick
+  sensorFilters.setAlpha(CHANNEL_LIGHT, alphaFor(cfg.lightAlpha, ticks));
+  sensorFilters.setAlpha(CHANNEL_ACCEL_X, alphaFor(cfg.mpuAlpha, ticks));
+  // Tilt arrives from the attitude estimator already filtered; a second
+  // EMA would only add lag
+  sensorFilters.setAlpha(CHANNEL_TILT_SIDE, 1.0f);
+  sensorFilters.setAlpha(CHANNEL_TILT_FB, 1.0f);
+  sensorFilters.setOffset(CHANNEL_LIGHT, cfg.lightAdjustment);
+  sensorFilters.setOffset(CHANNEL_LIDAR, cfg.lidarAdjustment);
+  sensorFilters.setOffset(CHANNEL_ACCEL_X, cfg.accelXAdjustment);
+  sensorFilters.setOffset(CHANNEL_TILT_SIDE, cfg.tiltSideAdjustment);
+  sensorFilters.setOffset(CHANNEL_TILT_FB, cfg.tiltFBAdjustment);
+
+  // The lidar can deliver several ranges per tick; all but the newest go
+  // in first, and ticks without a fresh range hold the last distance
+  uint32_t fresh = FilterBank<SENSOR_CHANNELS>::ALL;
+  float lidar = 0.0f;
+  if (raw.lidarCount > 0) {
+    for (uint8_t i = 0; i < raw.lidarCount; i++) {
+      const LidarSample &range = raw.lidar[i];
+      float spacing = 1.0f;
+      if (lastLidarUs != 0 && range.timestampUs > lastLidarUs)
+        spacing = (range.timestampUs - lastLidarUs) /
+                  (CONTROL_PERIOD_MS * 1000.0f);
+      lastLidarUs = range.timestampUs;
+      sensorFilters.setAlpha(CHANNEL_LIDAR, alphaFor(cfg.lidarAlpha, spacing));
+      if (i + 1 < raw.lidarCount)
+        sensorFilters.updateChannel(CHANNEL_LIDAR, range.distance);
+    }
+    lidar = raw.lidar[raw.lidarCount - 1].distance;
+  } else {
+    fresh &= ~(1u << CHANNEL_LIDAR);
+  }
+  const float samples[SENSOR_CHANNELS] = {raw.lumens, lidar, raw.mpu.accelX,
+                                          raw.mpu.tiltSide, raw.mpu.tiltFB};
+  sensorFilters.update(samples, fresh);
+
+  float filtered[SENSOR_CHANNELS];
+  sensorFilters.outputs(filtered);
+  out.lumensRaw = filtered[CHANNEL_LIGHT];
+  out.distanceRaw = filtered[CHANNEL_LIDAR];
+  out.accelXRaw = filtered[CHANNEL_ACCEL_X];
+  out.tiltSideRaw = filtered[CHANNEL_TILT_SIDE];
+  out.tiltFBRaw = filtered[CHANNEL_TILT_FB];
+}
+
+ActuatorState controlDecide(const SensorData &data, const RuntimeConfig &cfg,
+                            uint64_t nowUs) {
+  return actuatorsFor(
+      warningRules.evaluate(data, cfg, nowUs, sensorHealthUsableRules()));
+}
+
+void controlCheckHealth(const RawSample &raw) {
+  if (sensorHealthUpdate(SENSOR_IMU, raw.mpu.timestampUs != lastImuUs,
+                         raw.timestampUs))
+    mpu6050Recover();
+  lastImuUs = raw.mpu.timestampUs;
+  if (sensorHealthUpdate(SENSOR_LIDAR, raw.lidarCount > 0, raw.timestampUs))
+    lidarRecover();
+}
+
+void controlActuate(const ActuatorState &state) {
+  setFogLight(state.fogLight);
+  setWarningLight(state.warningLight);
+  setBuzzer(state.buzzer);
+}
+
+ActuatorState controlStep(const RawSample &raw, const RuntimeConfig &cfg,
+                          SensorData &out, uint32_t &t) {
+  controlCheckHealth(raw);
+  controlFilter(raw, cfg, out);
+  t = latencyLap(LATENCY_FILTER, t);
+  ActuatorState state = controlDecide(out, cfg, raw.timestampUs);
+  t = latencyLap(LATENCY_DECIDE, t);
+  return state;
+}
+
+ActuatorState controlTick(SensorData &out, RuntimeConfig *ranOn) {
+  // One snapshot for the whole tick, even if the config changes meanwhile
+  const RuntimeConfig &cfg = configAcquire();
+  RawSample raw;
+  latencyRecordStart(timebaseMicros(), controlRate.periodMs());
+  uint32_t start = latencyStart();
+  controlAcquire(raw);
+  uint32_t t = latencyLap(LATENCY_READ, start);
+  traceRecord(raw, cfg);
+  ActuatorState state = controlStep(raw, cfg, out, t);
+  controlActuate(state);
+  t = latencyLap(LATENCY_ACTUATE, t);
+  if (LATENCY_STATS)
+    latencyRecordCycles(LATENCY_TICK, t - start);
+  latencyRecordTick(raw, state, timebaseMicros());
+
+  // Pick the next tick's period with the same snapshot
+  controlRate.update(out, state, cfg, raw.timestampUs);
+  lidarSetInterval(controlRate.idle(cfg) ? LIDAR_IDLE_INTER_MEASUREMENT_MS
+                                         : LIDAR_INTER_MEASUREMENT_MS);
+  if (ranOn != NULL)
+    *ranOn = cfg;
+  return state;
+}
+
+void controlReset() {
+  sensorFilters = FilterBank<SENSOR_CHANNELS>();
+  lastFilterUs = 0;
+  lastLidarUs = 0;
+  controlRate = AdaptiveRate();
+  warningRules = WarningRules();
+  lastImuUs = 0;
+  sensorHealthReset();
+}
+
+uint32_t controlPeriodMs() { return controlRate.periodMs(); }
+
+float controlProximity() { return controlRate.proximity(); }
@@ -0,0 +1,12 @@
+#include "crc32.h"
+
+uint32_t crc32(const void *data, size_t length, uint32_t crc) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
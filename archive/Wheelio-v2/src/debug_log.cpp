@@ -0,0 +1,73 @@
+#include "debug_log.h"
+#include "crc32.h"
+#include "mpsc_ring.h"
+#include <atomic>
+
+static MpscRing<LogRecord, LOG_BUFFER_RECORDS> ring;
+static std::atomic<uint32_t> dropped(0);
+static uint32_t reportedDrops = 0; // consumer-owned
+
+LogRecord *logClaim(size_t &ticket) {
+  LogRecord *record = ring.claim(ticket);
+  if (record == NULL)
+    dropped.fetch_add(1, std::memory_order_relaxed);
+  return record;
+}
+
+void logCommit(size_t ticket, LogRecord &record, const char *text) {
+  if (text != NULL) {
+    // Truncated to the words left, always NUL-terminated
+    size_t room = (LOG_ARG_WORDS - record.words) * 4;
+    if (room > 0) {
+      char *to = (char *)&record.args[record.words];
+      size_t length = strnlen(text, room - 1);
+      memcpy(to, text, length);
+      memset(to + length, 0, 4 - length % 4);
+      record.words += length / 4 + 1;
+    }
+  }
+  ring.commit(ticket);
+}
+
+static void put16(uint8_t *p, uint16_t value) {
+  p[0] = value;
+  p[1] = value >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    p[i] = value >> (8 * i);
+}
+
+static size_t encode(const LogRecord &record, uint8_t *out) {
+  out[0] = LOG_FRAME_MAGIC;
+  put16(out + 1, record.message);
+  out[3] = record.words;
+  put32(out + 4, record.timestampUs);
+  for (uint8_t i = 0; i < record.words; i++)
+    put32(out + 8 + 4 * i, record.args[i]);
+  size_t body = 7 + 4 * record.words;
+  out[1 + body] = (uint8_t)crc32(out + 1, body);
+  return LOG_FRAME_BYTES(record.words);
+}
+
+size_t logDrain(uint8_t *out, size_t capacity) {
+  const size_t maxFrame = LOG_FRAME_BYTES(LOG_ARG_WORDS);
+  size_t length = 0;
+  uint32_t drops = dropped.load(std::memory_order_relaxed);
+  if (drops != reportedDrops && capacity >= maxFrame) {
+    LogRecord record = {};
+    record.timestampUs = (uint32_t)timebaseMicros();
+    record.message = MSG_LOG_DROPPED;
+    record.words = 1;
+    record.args[0] = drops - reportedDrops;
+    length += encode(record, out);
+    reportedDrops = drops;
+  }
+  LogRecord record;
+  while (capacity - length >= maxFrame && ring.pop(record))
+    length += encode(record, out + length);
+  return length;
+}
+
+uint32_t logDropped() { return dropped.load(std::memory_order_relaxed); }
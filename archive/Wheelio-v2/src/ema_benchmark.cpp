@@ -0,0 +1,161 @@
+#include "ema_benchmark.h"
+#include "ema_filter.h"
+#include "filter_bank.h"
+#include <math.h>
+
+// One block of input, replayed until `samples` updates have run. Values
+// are precomputed in each format so only update() is timed.
+#define INPUT_SAMPLES 256
+
+static float inputFloat[INPUT_SAMPLES];
+static int16_t inputQ15[INPUT_SAMPLES];
+static int32_t inputQ31[INPUT_SAMPLES];
+static volatile float sink; // keeps the timed loops from being optimized out
+
+static void makeInput() {
+  uint32_t state = 12345;
+  for (int i = 0; i < INPUT_SAMPLES; i++) {
+    state = state * 1664525u + 1013904223u;
+    float noise = ((state >> 8) & 0xFFFF) / 65536.0f - 0.5f;
+    float x = 0.6f * sinf(i * 0.05f) + 0.3f * noise;
+    inputFloat[i] = x;
+    inputQ15[i] = toQ15(x);
+    inputQ31[i] = toQ31(x);
+  }
+}
+
+// Largest deviation from the same EMA in double over one pass of the input
+template <typename F, typename T, typename ToFloat>
+static float maxError(F filter, const T *input, double alpha, ToFloat toFloat) {
+  double reference = 0.0;
+  float worst = 0.0f;
+  for (int i = 0; i < INPUT_SAMPLES; i++) {
+    reference += alpha * (toFloat(input[i]) - reference);
+    float error = fabsf(toFloat(filter.update(input[i])) - (float)reference);
+    if (error > worst)
+      worst = error;
+  }
+  return worst;
+}
+
+// Each update depends on the last, so the loop cannot be elided as long as
+// the final value is used
+template <typename F, typename T>
+static float countsPerSample(F &filter, const T *input, uint32_t samples,
+                             uint32_t (*counter)()) {
+  uint32_t rounds = (samples + INPUT_SAMPLES - 1) / INPUT_SAMPLES;
+  uint32_t start = counter();
+  for (uint32_t r = 0; r < rounds; r++) {
+    for (int i = 0; i < INPUT_SAMPLES; i++)
+      filter.update(input[i]);
+  }
+  uint32_t elapsed = counter() - start;
+  sink = (float)filter.getValue();
+  return (float)elapsed / (rounds * INPUT_SAMPLES);
+}
+
+static float identity(float x) { return x; }
+
+// Five channels as the control loop has them, the input read as frames of
+// five consecutive samples
+#define BANK_CHANNELS 5
+#define BANK_FRAMES (INPUT_SAMPLES / BANK_CHANNELS)
+
+struct FiveFilters {
+  TunableEMAFilter ch[BANK_CHANNELS] = {
+      TunableEMAFilter(0.125f), TunableEMAFilter(0.125f),
+      TunableEMAFilter(0.125f), TunableEMAFilter(0.125f),
+      TunableEMAFilter(0.125f)};
+
+  void updateBlock(const float *samples, size_t frames) {
+    for (size_t f = 0; f < frames; f++) {
+      for (int c = 0; c < BANK_CHANNELS; c++)
+        ch[c].update(samples[f * BANK_CHANNELS + c]);
+    }
+  }
+  float getValue(size_t c) const { return ch[c].getValue(); }
+};
+
+template <typename F>
+static EmaBenchResult measureBank(const char *name, F &filters,
+                                  uint32_t samples, uint32_t (*counter)()) {
+  EmaBenchResult result;
+  result.name = name;
+  // Both seed from the first frame
+  double reference[BANK_CHANNELS];
+  for (int c = 0; c < BANK_CHANNELS; c++)
+    reference[c] = inputFloat[c];
+  filters.updateBlock(inputFloat, 1);
+  result.maxError = 0.0f;
+  for (int f = 1; f < BANK_FRAMES; f++) {
+    filters.updateBlock(inputFloat + f * BANK_CHANNELS, 1);
+    for (int c = 0; c < BANK_CHANNELS; c++) {
+      reference[c] +=
+          0.125 * (inputFloat[f * BANK_CHANNELS + c] - reference[c]);
+      float error = fabsf(filters.getValue(c) - (float)reference[c]);
+      if (error > result.maxError)
+        result.maxError = error;
+    }
+  }
+
+  uint32_t rounds = (samples + BANK_FRAMES * BANK_CHANNELS - 1) /
+                    (BANK_FRAMES * BANK_CHANNELS);
+  uint32_t start = counter();
+  for (uint32_t r = 0; r < rounds; r++)
+    filters.updateBlock(inputFloat, BANK_FRAMES);
+  uint32_t elapsed = counter() - start;
+  sink = filters.getValue(0);
+  result.countsPerSample =
+      (float)elapsed / (rounds * BANK_FRAMES * BANK_CHANNELS);
+  return result;
+}
+
+template <typename F, typename T, typename ToFloat>
+static EmaBenchResult measure(const char *name, F filter, const T *input,
+                              double alpha, ToFloat toFloat, uint32_t samples,
+                              uint32_t (*counter)()) {
+  EmaBenchResult result;
+  result.name = name;
+  result.maxError = maxError(filter, input, alpha, toFloat);
+  result.countsPerSample = countsPerSample(filter, input, samples, counter);
+  return result;
+}
+
+size_t emaBenchmark(uint32_t (*counter)(), uint32_t samples,
+                    EmaBenchResult *results, size_t maxResults) {
+  makeInput();
+  EmaBenchResult all[EMA_BENCH_VARIANTS];
+  size_t n = 0;
+
+  // The runtime-alpha class, seeded at 0 so it matches the reference
+  TunableEMAFilter tunable(0.125f);
+  tunable.update(0.0f);
+  all[n++] = measure("TunableEMAFilter (float, runtime)", tunable, inputFloat,
+                     0.125, identity, samples, counter);
+  all[n++] = measure("EMAFilter<float, 1, 8>", EMAFilter<float, 1, 8>(),
+                     inputFloat, 0.125, identity, samples, counter);
+  all[n++] = measure("EMAFilter<int16_t, 1, 8> (Q15 shift)",
+                     EMAFilter<int16_t, 1, 8>(), inputQ15, 0.125, fromQ15,
+                     samples, counter);
+  all[n++] = measure("EMAFilter<int32_t, 1, 8> (Q31 shift)",
+                     EMAFilter<int32_t, 1, 8>(), inputQ31, 0.125, fromQ31,
+                     samples, counter);
+  all[n++] = measure("EMAFilter<int16_t, 1, 5> (Q15 multiply)",
+                     EMAFilter<int16_t, 1, 5>(), inputQ15, 0.2, fromQ15,
+                     samples, counter);
+  all[n++] = measure("EMAFilter<int32_t, 1, 5> (Q31 multiply)",
+                     EMAFilter<int32_t, 1, 5>(), inputQ31, 0.2, fromQ31,
+                     samples, counter);
+
+  FiveFilters five;
+  all[n++] = measureBank("5 x TunableEMAFilter, per channel", five, samples,
+                         counter);
+  FilterBank<BANK_CHANNELS> bank(0.125f);
+  all[n++] = measureBank("FilterBank<5>::updateBlock, per channel", bank,
+                         samples, counter);
+
+  size_t count = n < maxResults ? n : maxResults;
+  for (size_t i = 0; i < count; i++)
+    results[i] = all[i];
+  return count;
+}
@@ -0,0 +1,96 @@
+#include "config.h"
+#include "debug_log.h"
+#include "i2c_bus.h"
+#include "rtdb_client.h"
+#include "telemetry_codec.h"
+#include "telemetry_json.h"
+#include "uploader.h"
+#include <Arduino.h>
+#include <FirebaseESP32.h>
+
+static FirebaseAuth auth;
+static FirebaseConfig config;
+
+void uploaderInit() {
+  // Firebase (modern auth); the client keeps the ID token fresh and
+  // rtdb_client.cpp sends the uploads with it
+  config.api_key = API_KEY;
+  config.database_url = FIREBASE_HOST;
+  auth.user.email = EMAIL;
+  auth.user.password = PASSWORD;
+  Firebase.begin(&config, &auth);
+  Firebase.reconnectWiFi(true);
+  rtdbInit();
+  // Wall clock for per-sample timestamps; syncs in the background
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+}
+
+bool uploaderReady() { return Firebase.ready(); }
+
+static_assert(TELEMETRY_REPLAY_BATCH >= TELEMETRY_BATCH_SIZE,
+              "upload buffers are sized for replay batches");
+
+// Only firebaseTask uploads, so one set of static buffers is enough
+static char body[TELEMETRY_JSON_BUFFER_BYTES];
+
+// The whole batch as one base64 string keyed by the newest sample
+static bool sendPacked(const TelemetrySample *samples, size_t count) {
+  static uint8_t packed[TELEMETRY_ENCODED_BOUND(TELEMETRY_REPLAY_BATCH)];
+  static_assert(sizeof(body) >= (sizeof(packed) + 2) / 3 * 4 + 3,
+                "body holds the quoted base64 batch");
+  size_t length = telemetryEncode(samples, count, packed, sizeof(packed));
+  size_t textLength =
+      length ? base64Encode(packed, length, body + 1, sizeof(body) - 2) : 0;
+  if (textLength == 0)
+    return false;
+  body[0] = '"';
+  body[textLength + 1] = '"';
+
+  const TelemetrySample &newest = samples[count - 1];
+  char key[21];
+  char path[64];
+  telemetryPushKey(newest.epochMs ? newest.epochMs
+                                  : newest.timestampUs / 1000,
+                   key);
+  snprintf(path, sizeof(path), "%s/%s", FIREBASE_PACKED_PATH, key);
+  if (rtdbWrite(RTDB_PUT, path, body, textLength + 2)) {
+    LOG(MSG_UPLOAD_PACKED, count, length);
+    return true;
+  }
+  LOG(MSG_UPLOAD_FAILED, rtdbLastError());
+  return false;
+}
+
+// All samples go into one multi-location update under
+// FIREBASE_TELEMETRY_PATH, keyed by client-generated push keys so they sort
+// like pushJSON() entries. The body is serialized into a static buffer and
+// written to the socket as is.
+bool uploaderSendBatch(const TelemetrySample *samples, size_t count) {
+  if (count == 0)
+    return true;
+  if (TELEMETRY_PACKED)
+    return sendPacked(samples, count);
+
+  size_t length = telemetryToJson(samples, count, body, sizeof(body));
+  if (length == 0) {
+    LOG(MSG_UPLOAD_TOO_BIG);
+    return false;
+  }
+  if (rtdbWrite(RTDB_PATCH, FIREBASE_TELEMETRY_PATH, body, length)) {
+    LOG(MSG_UPLOAD_SENT, count);
+    return true;
+  }
+  LOG(MSG_UPLOAD_FAILED, rtdbLastError());
+  return false;
+}
+
+bool uploaderSendHealth() {
+  static char health[HEALTH_JSON_BYTES];
+  size_t length = healthToJson(i2cBusRecoveries(), health, sizeof(health));
+  if (length == 0)
+    return false;
+  if (rtdbWrite(RTDB_PUT, FIREBASE_HEALTH_PATH, health, length))
+    return true;
+  LOG(MSG_UPLOAD_FAILED, rtdbLastError());
+  return false;
+}
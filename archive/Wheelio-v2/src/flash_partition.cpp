@@ -0,0 +1,114 @@
+#include "flash_storage.h"
+#include "config.h"
+#include "timebase.h"
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+static SemaphoreHandle_t tickDone = NULL;  // given after every control tick
+static SemaphoreHandle_t eraseLock = NULL; // one erase per gap
+static portMUX_TYPE slackMux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t nextTickUs = 0; // under slackMux
+static FlashEraseStats eraseStats = {};
+
+void flashSlackInit() {
+  if (tickDone != NULL)
+    return;
+  tickDone = xSemaphoreCreateBinary();
+  eraseLock = xSemaphoreCreateMutex();
+}
+
+void flashTickDone(uint64_t nextUs) {
+  portENTER_CRITICAL(&slackMux);
+  nextTickUs = nextUs;
+  portEXIT_CRITICAL(&slackMux);
+  if (tickDone != NULL)
+    xSemaphoreGive(tickDone);
+}
+
+FlashEraseStats flashEraseStats() { return eraseStats; }
+
+// Waits for the end of a tick with FLASH_ERASE_SLACK_MS before the next
+static bool waitForSlack() {
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeout = pdMS_TO_TICKS(FLASH_ERASE_WAIT_MS);
+  for (;;) {
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (waited > timeout ||
+        xSemaphoreTake(tickDone, timeout - waited) != pdTRUE)
+      return false;
+    portENTER_CRITICAL(&slackMux);
+    uint64_t next = nextTickUs;
+    portEXIT_CRITICAL(&slackMux);
+    if (next > timebaseMicros() + FLASH_ERASE_SLACK_MS * 1000ULL)
+      return true;
+  }
+}
+
+// Raw data partition accessed through esp_partition. Erases and writes
+// suspend the flash cache on both cores, so keep them on the upload and
+// trace tasks and small: one record, one drain or one sector at a time.
+// Erases, by far the longest, also wait for the control task's slack.
+class PartitionStorage : public FlashStorage {
+private:
+  const esp_partition_t *partition;
+
+public:
+  explicit PartitionStorage(const esp_partition_t *partition)
+      : partition(partition) {}
+
+  size_t size() const override { return partition->size; }
+  size_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+
+  bool read(size_t offset, void *data, size_t length) override {
+    return esp_partition_read(partition, offset, data, length) == ESP_OK;
+  }
+
+  bool write(size_t offset, const void *data, size_t length) override {
+    return esp_partition_write(partition, offset, data, length) == ESP_OK;
+  }
+
+  bool eraseSector(size_t offset) override {
+    if (tickDone == NULL ||
+        xSemaphoreTake(eraseLock, pdMS_TO_TICKS(FLASH_ERASE_WAIT_MS)) !=
+            pdTRUE)
+      return false;
+    bool ok = false;
+    if (waitForSlack()) {
+      uint64_t startUs = timebaseMicros();
+      ok = esp_partition_erase_range(partition, offset, SPI_FLASH_SEC_SIZE) ==
+           ESP_OK;
+      uint32_t us = (uint32_t)(timebaseMicros() - startUs);
+      eraseStats.erases++;
+      if (us > eraseStats.maxEraseUs)
+        eraseStats.maxEraseUs = us;
+    } else {
+      eraseStats.deferred++;
+    }
+    xSemaphoreGive(eraseLock);
+    return ok;
+  }
+};
+
+// NULL if the partition table has no such data partition
+static FlashStorage *openPartition(uint8_t subtype, const char *label) {
+  const esp_partition_t *partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+  return partition ? new PartitionStorage(partition) : NULL;
+}
+
+FlashStorage *telemetryFlashStorage() {
+  static FlashStorage *storage = NULL;
+  if (storage == NULL)
+    storage = openPartition(0x40, "tlog");
+  return storage;
+}
+
+FlashStorage *traceFlashStorage() {
+  static FlashStorage *storage = NULL;
+  if (storage == NULL)
+    storage = openPartition(0x41, "trace");
+  return storage;
+}
@@ -0,0 +1,74 @@
+#include "http_response.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void httpResponseBegin(HttpResponseHead &head) {
+  head.status = 0;
+  head.bodyLength = -1;
+  head.keepAlive = false;
+  head.badLength = false;
+}
+
+// The value after "Name:" with leading blanks skipped, or NULL if `line`
+// is another header
+static const char *headerValue(const char *line, const char *name) {
+  size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':')
+    return NULL;
+  line += n + 1;
+  while (*line == ' ' || *line == '\t')
+    line++;
+  return line;
+}
+
+static bool noBody(int status) {
+  return status / 100 == 1 || status == 204 || status == 304;
+}
+
+bool httpResponseLine(HttpResponseHead &head, const char *line) {
+  if (head.status == 0) {
+    // "HTTP/1.x NNN reason"; 1.1 keeps the connection unless told not to
+    if (strncmp(line, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)line[7]) ||
+        line[8] != ' ')
+      return false;
+    int status = atoi(line + 9);
+    if (status < 100 || status > 999)
+      return false;
+    head.status = status;
+    head.keepAlive = line[7] == '1';
+    if (noBody(status))
+      head.bodyLength = 0;
+    return true;
+  }
+  if (line[0] == '\0')
+    return false;
+
+  const char *value;
+  if ((value = headerValue(line, "Content-Length")) != NULL) {
+    char *end;
+    long length = strtol(value, &end, 10);
+    while (*end == ' ' || *end == '\t')
+      end++;
+    if (end == value || *end != '\0' || length < 0)
+      head.badLength = true;
+    else if (!noBody(head.status))
+      head.bodyLength = length;
+  } else if ((value = headerValue(line, "Connection")) != NULL) {
+    if (strncasecmp(value, "close", 5) == 0)
+      head.keepAlive = false;
+    else if (strncasecmp(value, "keep-alive", 10) == 0)
+      head.keepAlive = true;
+  } else if ((value = headerValue(line, "Transfer-Encoding")) != NULL) {
+    // Chunked bodies are not parsed; read them until the server closes
+    if (!noBody(head.status))
+      head.bodyLength = -1;
+  }
+  return true;
+}
+
+bool httpResponseReusable(const HttpResponseHead &head, long unread) {
+  return head.status != 0 && head.keepAlive && !head.badLength &&
+         head.bodyLength >= 0 && unread == 0;
+}
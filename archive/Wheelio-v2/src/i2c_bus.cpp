@@ -0,0 +1,191 @@
+#include "i2c_bus.h"
+#include "config.h"
+#include "debug_log.h"
+#include "timebase.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define I2C_QUEUE_LENGTH 8
+#define I2C_CLEAR_PULSES 9  // lets a device stuck mid-byte finish it
+#define I2C_HALF_CLOCK_US 5 // 100 kHz
+
+struct I2cTransaction {
+  I2cDevice device;
+  I2cTransactionFn fn;
+  void *context;
+  uint64_t submittedUs;
+  uint32_t sequence; // i2cBusRun() call it answers; 0 for submits
+};
+
+// Per-device completion for i2cBusRun(), created once in i2cBusInit(). A
+// waiter that timed out leaves its transaction queued; when it finishes
+// later, its sequence tells the next waiter the give is not for it.
+struct I2cCompletion {
+  SemaphoreHandle_t done;
+  uint32_t sequence; // last transaction finished, under statsMux
+  bool result;
+  uint32_t lastIssued; // waiter side
+};
+
+static QueueHandle_t highQueue = NULL;
+static QueueHandle_t lowQueue = NULL;
+static SemaphoreHandle_t pending = NULL; // one count per queued transaction
+static I2cBusStats stats[I2C_DEVICE_COUNT] = {};
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t failuresInRow = 0; // bus task only
+static volatile uint32_t recoveries = 0;
+static I2cCompletion completions[I2C_DEVICE_COUNT] = {};
+
+static const char *const DEVICE_NAMES[I2C_DEVICE_COUNT] = {"mpu6050",
+                                                           "lidar"};
+
+static void beginWire() {
+  Wire.begin(PIN_MPU_SDA, PIN_MPU_SCL);
+  Wire.setTimeOut(I2C_WIRE_TIMEOUT_MS);
+}
+
+// Bus clear (I2C spec 3.1.16): a device interrupted mid-read keeps driving
+// SDA low until it has clocked out the rest of its byte
+static uint32_t clearBus() {
+  Wire.end();
+  pinMode(PIN_MPU_SDA, INPUT_PULLUP);
+  pinMode(PIN_MPU_SCL, OUTPUT_OPEN_DRAIN);
+  digitalWrite(PIN_MPU_SCL, HIGH);
+  uint32_t pulses = 0;
+  while (pulses < I2C_CLEAR_PULSES && digitalRead(PIN_MPU_SDA) == LOW) {
+    digitalWrite(PIN_MPU_SCL, LOW);
+    delayMicroseconds(I2C_HALF_CLOCK_US);
+    digitalWrite(PIN_MPU_SCL, HIGH);
+    delayMicroseconds(I2C_HALF_CLOCK_US);
+    pulses++;
+  }
+  // STOP: SDA rises while SCL is high
+  pinMode(PIN_MPU_SDA, OUTPUT_OPEN_DRAIN);
+  digitalWrite(PIN_MPU_SDA, LOW);
+  delayMicroseconds(I2C_HALF_CLOCK_US);
+  digitalWrite(PIN_MPU_SDA, HIGH);
+  delayMicroseconds(I2C_HALF_CLOCK_US);
+  beginWire();
+  return pulses;
+}
+
+static void i2cBusTask(void *pvParameters) {
+  for (;;) {
+    xSemaphoreTake(pending, portMAX_DELAY);
+    I2cTransaction txn;
+    if (xQueueReceive(highQueue, &txn, 0) != pdTRUE &&
+        xQueueReceive(lowQueue, &txn, 0) != pdTRUE)
+      continue;
+
+    uint64_t startUs = timebaseMicros();
+    bool ok = txn.fn(txn.context);
+    uint64_t endUs = timebaseMicros();
+
+    uint32_t delayUs = (uint32_t)(startUs - txn.submittedUs);
+    bool overrun = endUs - startUs > I2C_TRANSACTION_DEADLINE_MS * 1000ULL;
+    portENTER_CRITICAL(&statsMux);
+    I2cBusStats &s = stats[txn.device];
+    s.transactions++;
+    s.failures += ok ? 0 : 1;
+    s.overruns += overrun ? 1 : 0;
+    s.busyUs += endUs - startUs;
+    s.queueDelayUs += delayUs;
+    if (delayUs > s.maxQueueDelayUs)
+      s.maxQueueDelayUs = delayUs;
+    portEXIT_CRITICAL(&statsMux);
+
+    if (ok && !overrun) {
+      failuresInRow = 0;
+    } else if (++failuresInRow >= I2C_RECOVERY_FAILURES ||
+               digitalRead(PIN_MPU_SDA) == LOW) {
+      uint32_t pulses = clearBus();
+      LOG(MSG_I2C_RECOVERED, pulses, failuresInRow);
+      recoveries++;
+      failuresInRow = 0;
+    }
+
+    if (txn.sequence != 0) {
+      I2cCompletion &c = completions[txn.device];
+      portENTER_CRITICAL(&statsMux);
+      c.sequence = txn.sequence;
+      c.result = ok;
+      portEXIT_CRITICAL(&statsMux);
+      xSemaphoreGive(c.done);
+    }
+  }
+}
+
+void i2cBusInit() {
+  if (pending != NULL)
+    return;
+  beginWire();
+  highQueue = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2cTransaction));
+  lowQueue = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2cTransaction));
+  pending = xSemaphoreCreateCounting(2 * I2C_QUEUE_LENGTH, 0);
+  // i2cBusRun() fails for a device whose semaphore could not be created
+  for (int d = 0; d < I2C_DEVICE_COUNT; d++)
+    completions[d].done = xSemaphoreCreateBinary();
+  // Above the driver tasks that feed it, below the control loop's ISRs
+  xTaskCreatePinnedToCore(i2cBusTask, "i2cBus", 4096, NULL, 4, NULL, 0);
+}
+
+static bool enqueue(I2cPriority priority, const I2cTransaction &txn) {
+  QueueHandle_t queue = priority == I2C_PRIORITY_HIGH ? highQueue : lowQueue;
+  if (xQueueSend(queue, &txn, 0) != pdTRUE) {
+    portENTER_CRITICAL(&statsMux);
+    stats[txn.device].rejected++;
+    portEXIT_CRITICAL(&statsMux);
+    return false;
+  }
+  xSemaphoreGive(pending);
+  return true;
+}
+
+bool i2cBusSubmit(I2cDevice device, I2cPriority priority, I2cTransactionFn fn,
+                  void *context) {
+  I2cTransaction txn = {device, fn, context, timebaseMicros(), 0};
+  return enqueue(priority, txn);
+}
+
+bool i2cBusRun(I2cDevice device, I2cPriority priority, I2cTransactionFn fn,
+               void *context, uint32_t timeoutMs) {
+  I2cCompletion &c = completions[device];
+  if (c.done == NULL)
+    return false;
+  if (++c.lastIssued == 0) // 0 marks a submit
+    c.lastIssued = 1;
+  uint32_t sequence = c.lastIssued;
+  I2cTransaction txn = {device, fn, context, timebaseMicros(), sequence};
+  if (!enqueue(priority, txn))
+    return false;
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeout = pdMS_TO_TICKS(timeoutMs);
+  for (;;) {
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (waited > timeout ||
+        xSemaphoreTake(c.done, timeout - waited) != pdTRUE)
+      return false;
+    portENTER_CRITICAL(&statsMux);
+    uint32_t finished = c.sequence;
+    bool result = c.result;
+    portEXIT_CRITICAL(&statsMux);
+    // Otherwise a run that timed out earlier has just finished
+    if (finished == sequence)
+      return result;
+  }
+}
+
+I2cBusStats i2cBusStats(I2cDevice device) {
+  portENTER_CRITICAL(&statsMux);
+  I2cBusStats copy = stats[device];
+  portEXIT_CRITICAL(&statsMux);
+  return copy;
+}
+
+uint32_t i2cBusRecoveries() { return recoveries; }
+
+const char *i2cDeviceName(I2cDevice device) { return DEVICE_NAMES[device]; }
@@ -0,0 +1,102 @@
+#include "json_writer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char *buffer, size_t capacity)
+    : out(buffer), capacity(capacity), len(0), overflow(capacity == 0),
+      needComma(false) {
+  if (capacity > 0)
+    out[0] = '\0';
+}
+
+void JsonWriter::append(const char *text, size_t n) {
+  if (overflow || n >= capacity - len) {
+    overflow = true;
+    return;
+  }
+  memcpy(out + len, text, n);
+  len += n;
+  out[len] = '\0';
+}
+
+void JsonWriter::append(const char *text) { append(text, strlen(text)); }
+
+void JsonWriter::quoted(const char *text) {
+  append("\"", 1);
+  for (const char *p = text; *p; p++) {
+    char escaped[8];
+    if (*p == '"' || *p == '\\') {
+      escaped[0] = '\\';
+      escaped[1] = *p;
+      append(escaped, 2);
+    } else if ((unsigned char)*p < 0x20) {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*p);
+      append(escaped);
+    } else {
+      append(p, 1);
+    }
+  }
+  append("\"", 1);
+}
+
+void JsonWriter::key(const char *name) {
+  if (needComma)
+    append(",", 1);
+  needComma = true;
+  if (name != NULL) {
+    quoted(name);
+    append(":", 1);
+  }
+}
+
+JsonWriter &JsonWriter::beginObject(const char *name) {
+  key(name);
+  append("{", 1);
+  needComma = false;
+  return *this;
+}
+
+JsonWriter &JsonWriter::endObject() {
+  append("}", 1);
+  needComma = true;
+  return *this;
+}
+
+JsonWriter &JsonWriter::field(const char *name, float value) {
+  key(name);
+  if (!isfinite(value)) {
+    append("null", 4);
+    return *this;
+  }
+  char text[24];
+  int n = snprintf(text, sizeof(text), "%.7g", (double)value);
+  append(text, (size_t)n);
+  return *this;
+}
+
+JsonWriter &JsonWriter::field(const char *name, bool value) {
+  key(name);
+  append(value ? "true" : "false");
+  return *this;
+}
+
+JsonWriter &JsonWriter::field(const char *name, uint64_t value) {
+  key(name);
+  char text[24];
+  int n = snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+  append(text, (size_t)n);
+  return *this;
+}
+
+JsonWriter &JsonWriter::field(const char *name, const char *value) {
+  key(name);
+  quoted(value);
+  return *this;
+}
+
+JsonWriter &JsonWriter::serverValue(const char *name, const char *value) {
+  beginObject(name);
+  field(".sv", value);
+  return endObject();
+}
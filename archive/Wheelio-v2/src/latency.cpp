@@ -0,0 +1,129 @@
+#include "latency.h"
+#include "warning_rules.h"
+#include <string.h>
+
+static LatencyHistogram histograms[LATENCY_METRICS];
+static uint32_t drops[LATENCY_DROPS];
+static uint32_t sensorAgeUs = 0;
+static bool warningOn = false;
+static uint64_t lastStartUs = 0;
+
+static const char *const METRIC_NAMES[LATENCY_METRICS] = {
+    "read", "filter", "decide", "actuate", "tick", "lidar age", "imu age",
+    "warning", "jitter"};
+static const char *const DROP_NAMES[LATENCY_DROPS] = {"lidar none",
+                                                      "telemetry full"};
+
+static uint32_t bucketOf(uint32_t ns) {
+  return ns < 2 ? 0 : 31 - __builtin_clz(ns);
+}
+
+void latencyRecordNs(LatencyMetric metric, uint32_t ns) {
+  LatencyHistogram &h = histograms[metric];
+  h.buckets[bucketOf(ns)]++;
+  h.count++;
+  h.totalNs += ns;
+  if (ns > h.maxNs)
+    h.maxNs = ns;
+}
+
+// 32-bit divides only: a 64-bit one is a library call on the ESP32
+void latencyRecordCycles(LatencyMetric metric, uint32_t cycles) {
+  uint32_t perUs = timebaseCyclesPerUs();
+  uint32_t us = cycles / perUs;
+  uint32_t ns = (cycles % perUs) * 1000 / perUs;
+  latencyRecordNs(metric, us >= 4294967 ? 0xFFFFFFFFu : us * 1000 + ns);
+}
+
+// Microsecond ages and gaps as ns, saturating past ~4 s
+static void recordAge(LatencyMetric metric, uint64_t ageUs) {
+  latencyRecordNs(metric, ageUs >= 4294967 ? 0xFFFFFFFFu
+                                           : (uint32_t)(ageUs * 1000));
+}
+
+void latencyRecordStart(uint64_t startUs, uint32_t periodMs) {
+  if (LATENCY_STATS && lastStartUs != 0) {
+    uint64_t gapUs = startUs - lastStartUs;
+    uint64_t periodUs = periodMs * 1000ULL;
+    recordAge(LATENCY_JITTER,
+              gapUs > periodUs ? gapUs - periodUs : periodUs - gapUs);
+  }
+  lastStartUs = startUs;
+}
+
+void latencyRecordTick(const RawSample &raw, const ActuatorState &state,
+                       uint64_t actuatedUs) {
+  if (raw.lidarCount == 0)
+    drops[DROP_LIDAR_NONE]++;
+  if (!LATENCY_STATS)
+    return;
+
+  // Light has no sample time of its own; it is read at the tick
+  uint64_t oldestUs = raw.timestampUs;
+  uint64_t lidarUs = 0;
+  if (raw.lidarCount > 0) {
+    lidarUs = raw.lidar[raw.lidarCount - 1].timestampUs;
+    recordAge(LATENCY_LIDAR_AGE, actuatedUs - lidarUs);
+    if (lidarUs < oldestUs)
+      oldestUs = lidarUs;
+  }
+  uint64_t imuUs = raw.mpu.timestampUs;
+  if (imuUs > 0) {
+    recordAge(LATENCY_IMU_AGE, actuatedUs - imuUs);
+    if (imuUs < oldestUs)
+      oldestUs = imuUs;
+  }
+  sensorAgeUs = (uint32_t)(actuatedUs - oldestUs);
+
+  // Charged to the older of the sensors that raised it. A lidar warning on
+  // a tick without a fresh range came from a config change; count it from
+  // the tick.
+  if (state.warningLight && !warningOn) {
+    uint64_t causeUs = actuatedUs;
+    if (state.rules & LIDAR_RULES)
+      causeUs = lidarUs ? lidarUs : raw.timestampUs;
+    if ((state.rules & MPU_RULES) && imuUs > 0 && imuUs < causeUs)
+      causeUs = imuUs;
+    recordAge(LATENCY_WARNING, actuatedUs - causeUs);
+  }
+  warningOn = state.warningLight;
+}
+
+void latencyCountDrop(LatencyDrop drop) { drops[drop]++; }
+
+uint32_t latencySensorAgeUs() { return sensorAgeUs; }
+
+const LatencyHistogram &latencyHistogram(LatencyMetric metric) {
+  return histograms[metric];
+}
+
+uint32_t latencyDrops(LatencyDrop drop) { return drops[drop]; }
+
+const char *latencyMetricName(LatencyMetric metric) {
+  return METRIC_NAMES[metric];
+}
+
+const char *latencyDropName(LatencyDrop drop) { return DROP_NAMES[drop]; }
+
+uint32_t latencyPercentileNs(const LatencyHistogram &histogram,
+                             float fraction) {
+  if (histogram.count == 0)
+    return 0;
+  uint32_t target = (uint32_t)(fraction * histogram.count);
+  if (target >= histogram.count)
+    target = histogram.count - 1;
+  uint32_t seen = 0;
+  for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+    seen += histogram.buckets[b];
+    if (seen > target) {
+      uint32_t upper = b == 31 ? 0xFFFFFFFFu : (2u << b) - 1;
+      return upper < histogram.maxNs ? upper : histogram.maxNs;
+    }
+  }
+  return histogram.maxNs;
+}
+
+void latencyReset() {
+  memset(histograms, 0, sizeof(histograms));
+  memset(drops, 0, sizeof(drops));
+}
@@ -1,27 +1,160 @@
 #include "lidar_sensor.h"
+#include "config.h"
+#include "debug_log.h"
+#include "i2c_bus.h"
+#include "timebase.h"
 #include <Adafruit_VL53L0X.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 
 static Adafruit_VL53L0X lox = Adafruit_VL53L0X();
 
-void lidarInit() {
-  if (!lox.begin()) {
-    Serial.println(F("Failed to boot VL53L0X"));
-    while (1)
-      ;
-  }
-  lox.startRangeContinuous();
+// GPIO1 goes low when a range is ready. The ISR stamps the time and wakes
+// lidarTask, which queues a low-priority read on the I2C bus task; the read
+// fetches the result (clearing the interrupt) and queues the sample.
+
+#define RANGE_STATUS_OK 0
+#define RANGE_STATUS_PHASE_FAIL 4 // no target within range
+
+static QueueHandle_t sampleQueue = NULL;
+static TaskHandle_t lidarTaskHandle = NULL;
+static LidarStats stats = {};
+static volatile bool readQueued = false;
+static volatile bool rangeSignalled = false;
+static volatile uint64_t readyUs = 0;
+static volatile uint32_t intervalMs = LIDAR_INTER_MEASUREMENT_MS;
+static portMUX_TYPE readyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR onRangeReady() {
+  portENTER_CRITICAL_ISR(&readyMux);
+  readyUs = esp_timer_get_time();
+  portEXIT_CRITICAL_ISR(&readyMux);
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(lidarTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
 }
 
-int readLidarDistance() {
-  if (lox.isRangeComplete()) {
-    int distance = lox.readRange() / 10; // Convert mm to cm
+static bool readRangeTransaction(void *context) {
+  readQueued = false;
+  LidarSample sample;
+  if (rangeSignalled) {
+    rangeSignalled = false;
+    portENTER_CRITICAL(&readyMux);
+    sample.timestampUs = readyUs;
+    portEXIT_CRITICAL(&readyMux);
+  } else if (lox.isRangeComplete()) {
+    sample.timestampUs = timebaseMicros();
+  } else {
+    return true;
+  }
+  uint16_t mm = lox.readRangeResult(); // also clears the interrupt
+  uint8_t status = lox.readRangeStatus();
 
-    // Handle out-of-range values
-    if (distance == 0 || distance > 200) { // Assuming 200 cm is the max range
-      return -1; // Return -1 for out-of-range
-    }
+  if (status == RANGE_STATUS_PHASE_FAIL || mm / 10 > LIDAR_MAX_RANGE_CM) {
+    sample.distance = LIDAR_MAX_RANGE_CM;
+  } else if (status != RANGE_STATUS_OK || mm == 0) {
+    stats.invalid++;
+    return true;
+  } else {
+    sample.distance = mm / 10; // Convert mm to cm
+  }
 
-    return distance;
+  if (xQueueSend(sampleQueue, &sample, 0) == pdTRUE)
+    stats.samples++;
+  else
+    stats.dropped++;
+  return true;
+}
+
+static void lidarTask(void *pvParameters) {
+  // Fall back to polling the sensor if GPIO1 is not wired
+  for (;;) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2 * intervalMs)) > 0)
+      rangeSignalled = true;
+    if (!readQueued) {
+      readQueued = true;
+      if (!i2cBusSubmit(I2C_DEVICE_LIDAR, I2C_PRIORITY_LOW,
+                        readRangeTransaction, NULL))
+        readQueued = false;
+    }
   }
-  return -1; // Return -1 if range is not complete
 }
+
+static bool beginTransaction(void *context) {
+  if (!lox.begin())
+    return false;
+  lox.setMeasurementTimingBudgetMicroSeconds(LIDAR_TIMING_BUDGET_US);
+  lox.setGpioConfig(VL53L0X_DEVICEMODE_CONTINUOUS_TIMED_RANGING,
+                    VL53L0X_GPIOFUNCTIONALITY_NEW_MEASURE_READY,
+                    VL53L0X_INTERRUPTPOLARITY_LOW);
+  return true;
+}
+
+static bool startTransaction(void *context) {
+  return lox.startRangeContinuous(intervalMs);
+}
+
+static bool restartTransaction(void *context) {
+  lox.stopRangeContinuous();
+  return lox.startRangeContinuous(intervalMs);
+}
+
+// After a power glitch or a bus clear the sensor is back at its defaults
+static bool recoverTransaction(void *context) {
+  return beginTransaction(context) && startTransaction(context);
+}
+
+void lidarInit() {
+  i2cBusInit();
+  // The control loop runs without the lidar; sensor health notices the
+  // missing ranges and retries through lidarRecover()
+  bool booted = i2cBusRun(I2C_DEVICE_LIDAR, I2C_PRIORITY_LOW,
+                          beginTransaction, NULL, 2000);
+  if (!booted)
+    LOG(MSG_LIDAR_BOOT_FAILED);
+
+  sampleQueue = xQueueCreate(16, sizeof(LidarSample));
+  xTaskCreatePinnedToCore(lidarTask, "lidar", 4096, NULL, 2, &lidarTaskHandle,
+                          0);
+  pinMode(PIN_LIDAR_INT, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(PIN_LIDAR_INT), onRangeReady, FALLING);
+
+  if (booted)
+    i2cBusRun(I2C_DEVICE_LIDAR, I2C_PRIORITY_LOW, startTransaction, NULL,
+              1000);
+}
+
+bool lidarRecover() {
+  return i2cBusSubmit(I2C_DEVICE_LIDAR, I2C_PRIORITY_LOW, recoverTransaction,
+                      NULL);
+}
+
+bool lidarReadSample(LidarSample &sample) {
+  return sampleQueue != NULL && xQueueReceive(sampleQueue, &sample, 0) == pdTRUE;
+}
+
+int readLidarDistance() {
+  LidarSample sample;
+  int distance = -1;
+  while (lidarReadSample(sample))
+    distance = sample.distance;
+  return distance;
+}
+
+void lidarSetInterval(uint32_t ms) {
+  if (ms < LIDAR_INTER_MEASUREMENT_MS)
+    ms = LIDAR_INTER_MEASUREMENT_MS;
+  if (ms == intervalMs)
+    return;
+  uint32_t previous = intervalMs;
+  intervalMs = ms;
+  // Bus queue full: keep the old period and let the next call retry
+  if (!i2cBusSubmit(I2C_DEVICE_LIDAR, I2C_PRIORITY_LOW, restartTransaction,
+                    NULL))
+    intervalMs = previous;
+}
+
+LidarStats lidarStats() { return stats; }
@@ -0,0 +1,32 @@
+#include "light_sensor.h"
+
+// Grove Light Sensor v1.2 on GPIO 33, 11 dB attenuation, 12-bit counts.
+// The phototransistor output is strongly non-linear, so the curve is a
+// piecewise-linear table. These are starting points; replace them with
+// points measured against a lux meter for each sensor batch.
+struct CalibrationPoint {
+  float counts;
+  float lux;
+};
+
+static const CalibrationPoint CALIBRATION[] = {
+    {0.0f, 0.0f},       {200.0f, 10.0f},    {600.0f, 60.0f},
+    {1200.0f, 200.0f},  {2000.0f, 500.0f},  {2700.0f, 1000.0f},
+    {3300.0f, 1800.0f}, {3800.0f, 3000.0f}, {4095.0f, 4500.0f},
+};
+static const int CALIBRATION_POINTS =
+    sizeof(CALIBRATION) / sizeof(CALIBRATION[0]);
+
+float lightCountsToLux(float counts) {
+  if (counts <= CALIBRATION[0].counts)
+    return CALIBRATION[0].lux;
+  for (int i = 1; i < CALIBRATION_POINTS; i++) {
+    const CalibrationPoint &lo = CALIBRATION[i - 1];
+    const CalibrationPoint &hi = CALIBRATION[i];
+    if (counts <= hi.counts) {
+      return lo.lux +
+             (counts - lo.counts) * (hi.lux - lo.lux) / (hi.counts - lo.counts);
+    }
+  }
+  return CALIBRATION[CALIBRATION_POINTS - 1].lux;
+}
@@ -1,9 +1,101 @@
 #include "light_sensor.h"
 #include "config.h"
+#include "debug_log.h"
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
-void lightSensorInit() { pinMode(PIN_LIGHT_SENSOR, INPUT); }
+// With LIGHT_USE_ADC_DMA the ADC converts GPIO 33 continuously into DMA
+// buffers (I2S0 on the ESP32). lightAdcTask sleeps until a block is ready,
+// averages LIGHT_ADC_SAMPLE_RATE_HZ / LIGHT_OUTPUT_RATE_HZ conversions per
+// estimate and publishes the calibrated lux. readLightLevel() only reads
+// that value, so the control loop never waits on a conversion.
+
+#define LIGHT_ADC_CHANNEL ADC1_CHANNEL_5 // GPIO 33
+#define DMA_BLOCK_BYTES 1024             // 256 conversions per read
+
+static volatile float luxEstimate = 0.0f;
+static LightStats stats = {};
+static bool dmaRunning = false;
+
+static void lightAdcTask(void *pvParameters) {
+  static uint8_t block[DMA_BLOCK_BYTES];
+  LightOversampler oversampler(LIGHT_ADC_SAMPLE_RATE_HZ / LIGHT_OUTPUT_RATE_HZ);
+  for (;;) {
+    uint32_t length = 0;
+    esp_err_t err =
+        adc_digi_read_bytes(block, sizeof(block), &length, ADC_MAX_DELAY);
+    if (err == ESP_ERR_INVALID_STATE) {
+      stats.overruns++; // data was lost, keep averaging what follows
+    } else if (err != ESP_OK) {
+      continue;
+    }
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length;
+         i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t *result =
+          (const adc_digi_output_data_t *)&block[i];
+      if (result->type1.channel != LIGHT_ADC_CHANNEL)
+        continue;
+      stats.samples++;
+      float average;
+      if (oversampler.add(result->type1.data, average)) {
+        luxEstimate = lightCountsToLux(average);
+        stats.outputs++;
+      }
+    }
+  }
+}
+
+static bool startAdcDma() {
+  adc_digi_init_config_t initConfig = {};
+  initConfig.max_store_buf_size = 4 * DMA_BLOCK_BYTES;
+  initConfig.conv_num_each_intr = DMA_BLOCK_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+  initConfig.adc1_chan_mask = BIT(LIGHT_ADC_CHANNEL);
+  initConfig.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&initConfig) != ESP_OK)
+    return false;
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_11;
+  pattern.channel = LIGHT_ADC_CHANNEL;
+  pattern.unit = 0; // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t digiConfig = {};
+  digiConfig.conv_limit_en = 1; // required on the ESP32
+  digiConfig.conv_limit_num = 250;
+  digiConfig.pattern_num = 1;
+  digiConfig.adc_pattern = &pattern;
+  digiConfig.sample_freq_hz = LIGHT_ADC_SAMPLE_RATE_HZ;
+  digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&digiConfig) != ESP_OK ||
+      adc_digi_start() != ESP_OK) {
+    adc_digi_deinitialize();
+    return false;
+  }
+  return true;
+}
+
+void lightSensorInit() {
+  pinMode(PIN_LIGHT_SENSOR, INPUT);
+  if (LIGHT_USE_ADC_DMA) {
+    dmaRunning = startAdcDma();
+    if (dmaRunning) {
+      xTaskCreatePinnedToCore(lightAdcTask, "lightAdc", 4096, NULL, 2, NULL,
+                              0);
+    } else {
+      LOG(MSG_LIGHT_DMA_UNAVAILABLE);
+    }
+  }
+}
 
 float readLightLevel() {
+  if (dmaRunning)
+    return luxEstimate;
   // Read raw analog value from the light sensor
-  return analogRead(PIN_LIGHT_SENSOR);
+  return lightCountsToLux(analogRead(PIN_LIGHT_SENSOR));
 }
+
+LightStats lightSensorStats() { return stats; }
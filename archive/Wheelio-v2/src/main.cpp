@@ -1,323 +1,240 @@
 // --- All includes must be at the very top ---
 #include "actuators.h"
+#include "alloc_counter.h"
+#include "boot_phases.h"
 #include "config.h"
+#include "config_params.h"
+#include "config_store.h"
+#include "config_stream.h"
+#include "control.h"
+#include "debug_log.h"
+#include "ema_benchmark.h"
+#include "flash_storage.h"
+#include "i2c_bus.h"
+#include "latency.h"
 #include "lidar_sensor.h"
 #include "light_sensor.h"
 #include "mpu6050_sensor.h"
-#include "ema_filter.h"
+#include "raw_trace.h"
+#include "runtime_config.h"
+#include "sensor_health.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "telemetry_uplink.h"
+#include "timebase.h"
+#include "uploader.h"
+#include "wifi_portal.h"
 #include <Arduino.h>
 #include <FirebaseESP32.h>
-#include <WiFiManager.h>
+#include <WiFi.h>
 #include <WiFiUdp.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
-#include <Preferences.h>
-#include "ema_filter.h"
-
-// Declare EMAFilter objects globally
-EMAFilter lightFilter(EMA_ALPHA_LIGHT);
-EMAFilter lidarFilter(EMA_ALPHA_LIDAR);
-EMAFilter accelXFilter(EMA_ALPHA_MPU);
-EMAFilter tiltSideFilter(EMA_ALPHA_MPU);
-EMAFilter tiltFBFilter(EMA_ALPHA_MPU);
 
 // --- Globals ---
-struct SensorData {
-  float lumensRaw;
-  float distanceRaw;
-  float accelXRaw, tiltSideRaw, tiltFBRaw;
+// What the control task hands the debug dump in loop() after every tick
+struct ControlStatus {
+  SensorData data;
+  RuntimeConfig cfg; // the snapshot the tick ran on
+  uint32_t periodMs;
+  float proximity;
 };
-static SensorData sharedData;
-static SemaphoreHandle_t dataMutex;
-volatile bool pauseUploads = false;
-WiFiManager wm;
-FirebaseData fbdo;
-FirebaseAuth auth;
-FirebaseConfig config;
+static Snapshot<ControlStatus> controlStatus;
+volatile bool pauseUploads = false; // while the config portal is open
 WiFiUDP ntpUDP;
-Preferences preferences;
 // Define BUTTON_PIN if not in config.h
 #ifndef BUTTON_PIN
 #define BUTTON_PIN 0 // ESP32 boot button (GPIO0)
 #endif
 
-// --- Shared actuator/warning logic ---
-static bool getFogLightState(float lumens) { return lumens < LIGHT_THRESHOLD; }
-static bool getWarningLightState(float distance, float tiltSide, float tiltFB) {
-  return (distance > 0 && distance < DIST_THRESHOLD) ||
-         (fabs(tiltSide) > TILT_SIDE_THRESHOLD ||
-          fabs(tiltFB) > TILT_FB_THRESHOLD);
-}
-static bool getBuzzerState(float distance, float tiltSide, float tiltFB) {
-  return getWarningLightState(distance, tiltSide, tiltFB);
-}
-static String getWarningMessage(float distance, float tiltSide, float tiltFB) {
-  bool warnLidar = (distance > 0 && distance < DIST_THRESHOLD);
-  bool warnMpu = (fabs(tiltSide) > TILT_SIDE_THRESHOLD ||
-                  fabs(tiltFB) > TILT_FB_THRESHOLD);
-  if (warnLidar && warnMpu)
-    return String("Lidar+MPU warning");
-  if (warnLidar)
-    return String("Lidar warning");
-  if (warnMpu)
-    return String("MPU warning");
-  return String("None");
-}
-
 // --- Firebase upload task (runs on Core 0) ---
+// Collects every tick from telemetryBuffer and sends them in batches of
+// TELEMETRY_BATCH_SIZE, or sooner once the oldest has waited
+// TELEMETRY_MAX_LATENCY_MS. Batches that cannot be sent go to the offline
+// log on flash and are replayed once Firebase is reachable again.
 void firebaseTask(void *pvParameters) {
   for (;;) {
-    vTaskDelay(1000 / portTICK_PERIOD_MS); // 1s interval
-    SensorData dataCopy;
-    if (xSemaphoreTake(dataMutex, (TickType_t)10) == pdTRUE) {
-      dataCopy = sharedData;
-      xSemaphoreGive(dataMutex);
-    } else {
-      continue; // skip this cycle if can't get data
-    }
-
-    if (pauseUploads) {
-      // Paused: skip upload
-      continue;
-    }
-    if (Firebase.ready()) {
-      String path = "/sensor_readings_test2";
-      FirebaseJson json;
-      json.set("sensors/light", dataCopy.lumensRaw);
-      json.set("sensors/lidar", dataCopy.distanceRaw);
-      json.set("sensors/tilt_side", dataCopy.tiltSideRaw);
-      json.set("sensors/tilt_fb", dataCopy.tiltFBRaw);
-      json.set("sensors/accel_x", dataCopy.accelXRaw);
-      json.set("actuators/fog_light", getFogLightState(dataCopy.lumensRaw));
-      json.set("actuators/warning_light",
-               getWarningLightState(dataCopy.distanceRaw,
-                                    dataCopy.tiltSideRaw,
-                                    dataCopy.tiltFBRaw));
-      json.set("actuators/buzzer",
-               getBuzzerState(dataCopy.distanceRaw, dataCopy.tiltSideRaw,
-                              dataCopy.tiltFBRaw));
-      json.set("warning", getWarningMessage(dataCopy.distanceRaw,
-                                            dataCopy.tiltSideRaw,
-                                            dataCopy.tiltFBRaw));
-      json.set("timestamp/.sv", "timestamp");
-      if (Firebase.pushJSON(fbdo, path.c_str(), json)) {
-        Serial.println("[Core0] Data sent to Firebase successfully with "
-                       "server-side timestamp field.");
-      } else {
-        Serial.print("[Core0] Failed to send data to Firebase: ");
-        Serial.println(fbdo.errorReason());
-      }
-    } else {
-      Serial.println("[Core0] Firebase not ready.");
-    }
+    vTaskDelay(CONTROL_PERIOD_MS / portTICK_PERIOD_MS);
+    uplinkPoll(telemetryBuffer, pauseUploads, timebaseMicros());
+    if (bootPhaseMs(BOOT_CLOUD) == 0 && uploaderReady())
+      bootPhaseDone(BOOT_CLOUD);
   }
 }
 
-// Define modifiable global variables for thresholds
-float TILT_SIDE_THRESHOLD = 30.0f;
-float TILT_FB_THRESHOLD = 9.0f;
-float DIST_THRESHOLD = 120.0f;
-float LIGHT_THRESHOLD = 1000.0f;
-
-// Define modifiable global variables for sensor adjustments
-float LIGHT_ADJUSTMENT = 0.0f;
-float LIDAR_ADJUSTMENT = 0.0f;
-float ACCEL_X_ADJUSTMENT = 0.0f;
-float TILT_SIDE_ADJUSTMENT = 0.0f;
-float TILT_FB_ADJUSTMENT = 0.0f;
-
-void saveThresholdsToNVS() {
-  preferences.begin("config", false);
-  preferences.putFloat("TILT_SIDE_THRESHOLD", TILT_SIDE_THRESHOLD);
-  preferences.putFloat("TILT_FB_THRESHOLD", TILT_FB_THRESHOLD);
-  preferences.putFloat("DIST_THRESHOLD", DIST_THRESHOLD);
-  preferences.putFloat("LIGHT_THRESHOLD", LIGHT_THRESHOLD);
-  preferences.end();
-}
-
-// Function to load thresholds from NVS
-void loadThresholdsFromNVS() {
-  preferences.begin("config", true);
-  TILT_SIDE_THRESHOLD = preferences.getFloat("TILT_SIDE_THRESHOLD", 30.0f);
-  TILT_FB_THRESHOLD = preferences.getFloat("TILT_FB_THRESHOLD", 9.0f);
-  DIST_THRESHOLD = preferences.getFloat("DIST_THRESHOLD", 120.0f);
-  LIGHT_THRESHOLD = preferences.getFloat("LIGHT_THRESHOLD", 1000.0f);
-  preferences.end();
-}
-
-// Function to update configuration dynamically from Firebase
-void updateConfigFromFirebase() {
-  Serial.println("Attempting to fetch configuration from Firebase...");
-
-  if (Firebase.getJSON(fbdo, "/parameters")) {
-    Serial.println("Configuration fetched successfully.");
-
-    // Log the raw JSON fetched from Firebase
-    String rawJson;
-    fbdo.jsonObject().toString(rawJson, true);
-    Serial.print("Raw JSON: ");
-    Serial.println(rawJson);
-
-    FirebaseJson &json = fbdo.jsonObject();
-    FirebaseJsonData jsonData;
-
-    // Update thresholds
-    if (json.get(jsonData, "TILT_SIDE_THRESHOLD")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("TILT_SIDE_THRESHOLD: ");
-        Serial.println((float)jsonData.floatValue);
-        TILT_SIDE_THRESHOLD = (float)jsonData.floatValue;
-      } else {
-        Serial.println("TILT_SIDE_THRESHOLD key found but type mismatch.");
-      }
-    } else {
-      Serial.println("TILT_SIDE_THRESHOLD key not found.");
-    }
-
-    if (json.get(jsonData, "TILT_FB_THRESHOLD")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("TILT_FB_THRESHOLD: ");
-        Serial.println((float)jsonData.floatValue);
-        TILT_FB_THRESHOLD = (float)jsonData.floatValue;
-      } else {
-        Serial.println("TILT_FB_THRESHOLD key found but type mismatch.");
-      }
-    } else {
-      Serial.println("TILT_FB_THRESHOLD key not found.");
-    }
-
-    if (json.get(jsonData, "DIST_THRESHOLD")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("DIST_THRESHOLD: ");
-        Serial.println((float)jsonData.floatValue);
-        DIST_THRESHOLD = (float)jsonData.floatValue;
-      } else {
-        Serial.println("DIST_THRESHOLD key found but type mismatch.");
-      }
-    } else {
-      Serial.println("DIST_THRESHOLD key not found.");
+// --- Control task (Core 1, above everything else) ---
+// Read, filter, decide and actuate at the period the last tick asked for.
+// vTaskDelayUntil anchors each wake to the previous one, so time spent in
+// the tick does not stretch the period; a tick that overruns restarts the
+// schedule instead of running the missed ones back to back. loop() and the
+// uploader only ever see the results.
+void controlTask(void *pvParameters) {
+  TickType_t lastWake = xTaskGetTickCount();
+  bool firstTick = true;
+  for (;;) {
+    TelemetrySample sample;
+    sample.timestampUs = timebaseMicros();
+    sample.epochMs = timebaseEpochMs();
+    ControlStatus status;
+    sample.actuators = controlTick(status.data, &status.cfg);
+    sample.data = status.data;
+    sample.health = sensorHealthPacked();
+    if (firstTick) {
+      bootPhaseDone(BOOT_FIRST_TICK);
+      firstTick = false;
     }
+#if TELEMETRY_LATENCY
+    sample.latencyUs = latencySensorAgeUs();
+#endif
 
-    if (json.get(jsonData, "LIGHT_THRESHOLD")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("LIGHT_THRESHOLD: ");
-        Serial.println((float)jsonData.floatValue);
-        LIGHT_THRESHOLD = (float)jsonData.floatValue;
-      } else {
-        Serial.println("LIGHT_THRESHOLD key found but type mismatch.");
-      }
-    } else {
-      Serial.println("LIGHT_THRESHOLD key not found.");
+    // Queue the tick for the Firebase task; never blocks
+    if (telemetryDue(sample) && !telemetryBuffer.push(sample)) {
+      latencyCountDrop(DROP_TELEMETRY_FULL);
     }
 
-    // Update EMA sensitivity
-    if (json.get(jsonData, "EMA_ALPHA_LIGHT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("EMA_ALPHA_LIGHT: ");
-        Serial.println((float)jsonData.floatValue);
-        lightFilter.setAlpha((float)jsonData.floatValue);
-      } else {
-        Serial.println("EMA_ALPHA_LIGHT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("EMA_ALPHA_LIGHT key not found.");
-    }
+    status.periodMs = controlPeriodMs();
+    status.proximity = controlProximity();
+    controlStatus.publish(status);
+
+    TickType_t period = pdMS_TO_TICKS(status.periodMs);
+    if (period == 0)
+      period = 1;
+    TickType_t now = xTaskGetTickCount();
+    if (now - lastWake >= period)
+      lastWake = now;
+    // Flash erases may run until the next tick (flash_storage.h)
+    flashTickDone(timebaseMicros() +
+                  (lastWake + period - now) * portTICK_PERIOD_MS * 1000ULL);
+    vTaskDelayUntil(&lastWake, period);
+  }
+}
 
-    if (json.get(jsonData, "EMA_ALPHA_LIDAR")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("EMA_ALPHA_LIDAR: ");
-        Serial.println((float)jsonData.floatValue);
-        lidarFilter.setAlpha((float)jsonData.floatValue);
+// --- WiFi portal task (Core 0) ---
+// Services the config portal one non-blocking step at a time while it is
+// open. A page load runs a WiFi scan that can take seconds; here that only
+// delays this task, never controlTask or loop(). Uploads pause while the
+// portal holds the radio in access point mode.
+void portalTask(void *pvParameters) {
+  WifiPortalState last = wifiPortalState();
+  for (;;) {
+    WifiPortalState state = wifiPortalPoll();
+    if (state != last) {
+      pauseUploads = state == WIFI_PORTAL_OPEN;
+      if (state == WIFI_PORTAL_OPEN) {
+        LOG(MSG_UPLOADS_PAUSED);
       } else {
-        Serial.println("EMA_ALPHA_LIDAR key found but type mismatch.");
+        if (state == WIFI_PORTAL_CONNECTED)
+          LOG(MSG_PORTAL_CONNECTED);
+        else
+          LOG(MSG_PORTAL_FAILED);
+        if (last == WIFI_PORTAL_OPEN)
+          LOG(MSG_UPLOADS_RESUMED);
       }
-    } else {
-      Serial.println("EMA_ALPHA_LIDAR key not found.");
+      last = state;
     }
+    vTaskDelay(pdMS_TO_TICKS(WIFI_PORTAL_POLL_MS));
+  }
+}
 
-    if (json.get(jsonData, "EMA_ALPHA_MPU")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("EMA_ALPHA_MPU: ");
-        Serial.println((float)jsonData.floatValue);
-        accelXFilter.setAlpha((float)jsonData.floatValue);
-        tiltSideFilter.setAlpha((float)jsonData.floatValue);
-        tiltFBFilter.setAlpha((float)jsonData.floatValue);
-      } else {
-        Serial.println("EMA_ALPHA_MPU key found but type mismatch.");
-      }
-    } else {
-      Serial.println("EMA_ALPHA_MPU key not found.");
-    }
+// --- Network boot task (Core 0) ---
+// Everything setup() leaves out so the safety path is up within
+// milliseconds: the offline log scan, Firebase and SNTP setup, the
+// uploader, WiFi (up to WIFI_CONNECT_TIMEOUT_S for the saved network), then
+// the /parameters stream once Firebase is signed in. The bike runs on its
+// NVS config until then. Ends once every network phase is done.
+void bootTask(void *pvParameters) {
+  // Offline telemetry log; samples left over from the last power cycle are
+  // replayed once Firebase is ready
+  FlashStorage *flash = telemetryFlashStorage();
+  if (!uplinkInit(flash) || flash == NULL) {
+    LOG(MSG_TLOG_UNAVAILABLE);
+  } else {
+    LOG(MSG_TLOG_PENDING, uplinkBacklog());
+  }
 
-    // Update sensor adjustments
-    if (json.get(jsonData, "LIGHT_ADJUSTMENT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("LIGHT_ADJUSTMENT: ");
-        Serial.println((float)jsonData.floatValue);
-        LIGHT_ADJUSTMENT = (float)jsonData.floatValue;
-      } else {
-        Serial.println("LIGHT_ADJUSTMENT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("LIGHT_ADJUSTMENT key not found.");
-    }
+  // Sign-in and SNTP wait for the network on their own; until Firebase is
+  // ready the uploader sends the control task's samples to the offline log
+  uploaderInit();
+  xTaskCreatePinnedToCore(firebaseTask, "firebaseTask", 8192, NULL, 1, NULL, 0);
 
-    if (json.get(jsonData, "LIDAR_ADJUSTMENT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("LIDAR_ADJUSTMENT: ");
-        Serial.println((float)jsonData.floatValue);
-        LIDAR_ADJUSTMENT = (float)jsonData.floatValue;
-      } else {
-        Serial.println("LIDAR_ADJUSTMENT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("LIDAR_ADJUSTMENT key not found.");
+  // Join the saved network, or leave the config portal open for portalTask
+  if (!wifiPortalBegin()) {
+    pauseUploads = true;
+    LOG(MSG_WIFI_FAILED);
+  } else {
+    IPAddress ip = WiFi.localIP();
+    LOG(MSG_WIFI_CONNECTED, ip[0], ip[1], ip[2], ip[3]);
+  }
+  bootPhaseDone(BOOT_WIFI);
+  xTaskCreatePinnedToCore(portalTask, "portal", 8192, NULL,
+                          WIFI_PORTAL_TASK_PRIORITY, NULL, 0);
+
+  uint32_t lastStreamTry = 0;
+  while (bootPhaseMs(BOOT_TIME) == 0 || bootPhaseMs(BOOT_STREAM) == 0) {
+    vTaskDelay(pdMS_TO_TICKS(BOOT_POLL_MS));
+    if (timebaseEpochMs() != 0)
+      bootPhaseDone(BOOT_TIME);
+    // Parameter changes are pushed from /parameters as they happen
+    uint32_t now = timebaseMillis();
+    if (bootPhaseMs(BOOT_CLOUD) != 0 && bootPhaseMs(BOOT_STREAM) == 0 &&
+        (lastStreamTry == 0 || now - lastStreamTry >= BOOT_STREAM_RETRY_MS)) {
+      lastStreamTry = now;
+      if (configStreamBegin(configSave))
+        bootPhaseDone(BOOT_STREAM);
     }
+  }
+  vTaskDelete(NULL);
+}
 
-    if (json.get(jsonData, "ACCEL_X_ADJUSTMENT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("ACCEL_X_ADJUSTMENT: ");
-        Serial.println((float)jsonData.floatValue);
-        ACCEL_X_ADJUSTMENT = (float)jsonData.floatValue;
-      } else {
-        Serial.println("ACCEL_X_ADJUSTMENT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("ACCEL_X_ADJUSTMENT key not found.");
-    }
+// --- Log drain task (Core 0, lowest priority) ---
+// Moves queued log records to the serial port as binary frames
+// (scripts/log_decode.py prints them). Only this task writes to Serial once
+// it is running. With TRACE_SINK 1 the raw trace goes out between them,
+// whole frames at a time.
+void logTask(void *pvParameters) {
+  static uint8_t frames[1024];
+  static uint8_t trace[1024];
+  for (;;) {
+    size_t length = logDrain(frames, sizeof(frames));
+    if (length > 0)
+      Serial.write(frames, length);
+    size_t traced = TRACE_SINK == 1 ? traceDrain(trace, sizeof(trace)) : 0;
+    if (traced > 0)
+      Serial.write(trace, traced);
+    if (length == 0 && traced == 0)
+      vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
 
-    if (json.get(jsonData, "TILT_SIDE_ADJUSTMENT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("TILT_SIDE_ADJUSTMENT: ");
-        Serial.println((float)jsonData.floatValue);
-        TILT_SIDE_ADJUSTMENT = (float)jsonData.floatValue;
-      } else {
-        Serial.println("TILT_SIDE_ADJUSTMENT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("TILT_SIDE_ADJUSTMENT key not found.");
-    }
+// --- Trace flash task (Core 0, lowest priority) ---
+// With TRACE_SINK 2, moves the raw trace to the "trace" partition, the
+// newest sectors overwriting the oldest (raw_trace.h)
+void traceTask(void *pvParameters) {
+  static uint8_t frames[1024];
+  static TraceFlash flash;
+  if (!flash.begin(traceFlashStorage())) {
+    LOG(MSG_TRACE_UNAVAILABLE);
+    traceStop();
+    vTaskDelete(NULL);
+  }
+  for (;;) {
+    size_t length = traceDrain(frames, sizeof(frames));
+    if (length > 0 && !flash.append(frames, length))
+      LOG(MSG_TRACE_WRITE_FAILED, length);
+    if (length < sizeof(frames) / 2)
+      vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_INTERVAL_MS));
+  }
+}
 
-    if (json.get(jsonData, "TILT_FB_ADJUSTMENT")) {
-      if (jsonData.type == "float" || jsonData.type == "int") {
-        Serial.print("TILT_FB_ADJUSTMENT: ");
-        Serial.println((float)jsonData.floatValue);
-        TILT_FB_ADJUSTMENT = (float)jsonData.floatValue;
-      } else {
-        Serial.println("TILT_FB_ADJUSTMENT key found but type mismatch.");
-      }
-    } else {
-      Serial.println("TILT_FB_ADJUSTMENT key not found.");
-    }
+static uint32_t cycleCount() { return ESP.getCycleCount(); }
 
-    // Save updated thresholds and adjustments to NVS
-    saveThresholdsToNVS();
-    Serial.println("Configuration updated and saved to NVS.");
-  } else {
-    Serial.print("Failed to fetch configuration: ");
-    Serial.println(fbdo.errorReason());
-  }
+static void printEmaBenchmark() {
+  EmaBenchResult results[EMA_BENCH_VARIANTS];
+  size_t n = emaBenchmark(cycleCount, 100000, results, EMA_BENCH_VARIANTS);
+  Serial.println("EMA filters (CPU cycles per sample, max error):");
+  for (size_t i = 0; i < n; i++)
+    Serial.printf("  %-42s %6.1f %.2g\n", results[i].name,
+                  results[i].countsPerSample, results[i].maxError);
 }
 
 void setup() {
@@ -327,59 +244,43 @@ void setup() {
 
   pinMode(BUTTON_PIN, INPUT_PULLUP);
 
-  if (DEBUG_MODE)
-    Serial.println("Wheelio System Booting...");
-
-  // Turn off all actuators and sensors initially
-  setFogLight(false);
-  setWarningLight(false);
-  setBuzzer(false);
-
-  // Use WiFiManager to auto-connect to known WiFi or open config portal if
-  // needed
-  wm.setConfigPortalTimeout(180);
-  if (!wm.autoConnect(WIFI_AP_NAME, WIFI_AP_PASSWORD)) {
-    Serial.println("Failed to connect to WiFi or config portal timed out.");
-  } else {
-    Serial.println("WiFi connected.");
-  }
-
-  if (DEBUG_MODE)
-    Serial.print("WiFi connected: ");
-  if (DEBUG_MODE)
-    Serial.println(WiFi.localIP());
-
-  // Firebase (modern auth)
-  config.api_key = API_KEY;
-  config.database_url = FIREBASE_HOST;
-  auth.user.email = EMAIL;
-  auth.user.password = PASSWORD;
-  Firebase.begin(&config, &auth);
-  Firebase.reconnectWiFi(true);
-
-  // Initialize sensors and actuators only after WiFi setup
+  // Printed as text, before the binary log takes over the port
+  if (EMA_BENCHMARK_AT_BOOT)
+    printEmaBenchmark();
+  xTaskCreatePinnedToCore(logTask, "log", 4096, NULL, LOG_TASK_PRIORITY, NULL,
+                          0);
+  LOG(MSG_BOOT);
+
+  // Safety path first: the last-known-good tuning from NVS, the actuators
+  // off, the sensors, then the control task. No network on the way.
+  if (configLoad())
+    LOG(MSG_CONFIG_LOADED);
+  bootPhaseDone(BOOT_CONFIG);
+  actuatorsInit();
+  bootPhaseDone(BOOT_ACTUATORS);
   lightSensorInit();
   mpu6050Init();
   lidarInit();
-  actuatorsInit();
-
-  // Create mutex and start Firebase upload task (after all init is done)
-  dataMutex = xSemaphoreCreateMutex();
-  xTaskCreatePinnedToCore(firebaseTask, "firebaseTask", 8192, NULL, 1, NULL, 0);
-
-  // Load thresholds from NVS on boot
-  loadThresholdsFromNVS();
-
-  // Fetch initial configuration from Firebase
-  updateConfigFromFirebase();
-
-  // Set up a periodic task to fetch updates from Firebase
-  xTaskCreatePinnedToCore([](void *pvParameters) {
-    for (;;) {
-      updateConfigFromFirebase();
-      vTaskDelay(60000 / portTICK_PERIOD_MS); // Fetch updates every 60 seconds
-    }
-  }, "ConfigUpdater", 8192, NULL, 1, NULL, 0);
+  bootPhaseDone(BOOT_SENSORS);
+
+  // Partition erases wait for the control task's slack
+  flashSlackInit();
+
+  // Raw sensor trace from the first tick on; the flash sink catches up
+  // with what was queued while it opened the partition
+  if (TRACE_SINK != 0)
+    traceStart();
+  if (TRACE_SINK == 2)
+    xTaskCreatePinnedToCore(traceTask, "trace", 4096, NULL,
+                            TRACE_TASK_PRIORITY, NULL, 0);
+
+  // The control loop, from here on independent of loop()
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, NULL,
+                          CONTROL_TASK_PRIORITY, NULL, CONTROL_TASK_CORE);
+
+  // Network, time and cloud in the background
+  xTaskCreatePinnedToCore(bootTask, "boot", 8192, NULL, BOOT_TASK_PRIORITY,
+                          NULL, 0);
 }
 
 void loop() {
@@ -389,118 +290,91 @@ void loop() {
   static unsigned long lastUpdate = 0;
   unsigned long currentMillis = millis();
 
-  // Check if the boot button is pressed
-  if (digitalRead(BUTTON_PIN) == LOW) {
-    if (!pauseUploads) {
-      pauseUploads = true;
-      Serial.println("Uploads paused (boot button pressed)");
-    }
-    Serial.println("Boot button pressed. Opening WiFi configuration portal...");
-    wm.setConfigPortalTimeout(180);
-    if (!wm.startConfigPortal(WIFI_AP_NAME, WIFI_AP_PASSWORD)) {
-      Serial.println("Failed to connect to WiFi through configuration portal.");
-    } else {
-      Serial.println("WiFi connected through configuration portal.");
-    }
-  } else {
-    if (pauseUploads) {
-      pauseUploads = false;
-      Serial.println("Uploads resumed (boot button released)");
-    }
-  }
-
-  // Sensor/control logic every 100ms
-  static unsigned long lastSensorUpdate = 0;
-  if (currentMillis - lastSensorUpdate >= 100) {
-    lastSensorUpdate = currentMillis;
-
-    // Read raw sensors
-    float lumensRaw = readLightLevel();
-    int distanceRaw = readLidarDistance();
-    MpuData mpuRaw = readMpuData();
-
-    // Apply EMA filters and adjustments
-    sharedData.lumensRaw = lightFilter.update(lumensRaw) + LIGHT_ADJUSTMENT;
-    sharedData.distanceRaw = lidarFilter.update(distanceRaw) + LIDAR_ADJUSTMENT;
-    sharedData.accelXRaw = accelXFilter.update(mpuRaw.accelX) + ACCEL_X_ADJUSTMENT;
-    sharedData.tiltSideRaw = tiltSideFilter.update(mpuRaw.tiltSide) + TILT_SIDE_ADJUSTMENT;
-    sharedData.tiltFBRaw = tiltFBFilter.update(mpuRaw.tiltFB) + TILT_FB_ADJUSTMENT;
-
-    // Use smoothed and adjusted values for logic
-    bool fogOn = sharedData.lumensRaw < LIGHT_THRESHOLD;
-    setFogLight(fogOn);
-
-    bool warnLidar = (sharedData.distanceRaw > 0 && sharedData.distanceRaw < DIST_THRESHOLD);
-    bool warnMpu = (fabs(sharedData.tiltSideRaw) > TILT_SIDE_THRESHOLD ||
-                    fabs(sharedData.tiltFBRaw) > TILT_FB_THRESHOLD);
-    bool warning = warnLidar || warnMpu;
-
-    setWarningLight(warning);
-    setBuzzer(warning);
-
-    // if (DEBUG_MODE) {
-    //   Serial.print("Lumens (adjusted): ");
-    //   Serial.print(sharedData.lumensRaw);
-    //   Serial.print(" | Distance (adjusted): ");
-    //   Serial.print(sharedData.distanceRaw);
-    //   Serial.print(" | Tilt Side (adjusted): ");
-    //   Serial.print(sharedData.tiltSideRaw);
-    //   Serial.print(" | Tilt FB (adjusted): ");
-    //   Serial.println(sharedData.tiltFBRaw);
-    // }
-
-    // Update shared data for Firebase task
-    if (xSemaphoreTake(dataMutex, (TickType_t)10) == pdTRUE) {
-      sharedData = sharedData;
-      xSemaphoreGive(dataMutex);
-    }
+  // The boot button opens the config portal; portalTask runs it
+  static bool buttonWasDown = false;
+  bool buttonDown = digitalRead(BUTTON_PIN) == LOW;
+  if (buttonDown && !buttonWasDown &&
+      wifiPortalState() != WIFI_PORTAL_OPEN) {
+    LOG(MSG_PORTAL_OPEN);
+    wifiPortalRequest();
   }
+  buttonWasDown = buttonDown;
 
-  // Non-blocking timing for serial print every second
+  // Status to the log once a second
   if (currentMillis - lastPrintTime >= 1000) {
     lastPrintTime = currentMillis;
 
-    Serial.println("Current Configuration:");
-    Serial.print("TILT_SIDE_THRESHOLD: ");
-    Serial.println(TILT_SIDE_THRESHOLD);
-    Serial.print("TILT_FB_THRESHOLD: ");
-    Serial.println(TILT_FB_THRESHOLD);
-    Serial.print("DIST_THRESHOLD: ");
-    Serial.println(DIST_THRESHOLD);
-    Serial.print("LIGHT_THRESHOLD: ");
-    Serial.println(LIGHT_THRESHOLD);
-
-    Serial.print("EMA_ALPHA_LIGHT: ");
-    Serial.println(lightFilter.getValue());
-    Serial.print("EMA_ALPHA_LIDAR: ");
-    Serial.println(lidarFilter.getValue());
-    Serial.print("EMA_ALPHA_MPU: ");
-    Serial.println(accelXFilter.getValue());
-
-    Serial.print("LIGHT_ADJUSTMENT: ");
-    Serial.println(LIGHT_ADJUSTMENT);
-    Serial.print("LIDAR_ADJUSTMENT: ");
-    Serial.println(LIDAR_ADJUSTMENT);
-    Serial.print("ACCEL_X_ADJUSTMENT: ");
-    Serial.println(ACCEL_X_ADJUSTMENT);
-    Serial.print("TILT_SIDE_ADJUSTMENT: ");
-    Serial.println(TILT_SIDE_ADJUSTMENT);
-    Serial.print("TILT_FB_ADJUSTMENT: ");
-    Serial.println(TILT_FB_ADJUSTMENT);
-
-    // Print sensor values
-    Serial.println("Current Sensor Values:");
-    Serial.print("Lumens (Raw): ");
-    Serial.println(sharedData.lumensRaw);
-    Serial.print("Distance (Raw): ");
-    Serial.println(sharedData.distanceRaw);
-    Serial.print("Accel X (Raw): ");
-    Serial.println(sharedData.accelXRaw);
-    Serial.print("Tilt Side (Raw): ");
-    Serial.println(sharedData.tiltSideRaw);
-    Serial.print("Tilt FB (Raw): ");
-    Serial.println(sharedData.tiltFBRaw);
+    // Housekeeping only: the figures are from the control task's last tick
+    ControlStatus status;
+    controlStatus.read(status);
+    const RuntimeConfig &cfg = status.cfg;
+    const SensorData &sharedData = status.data;
+    for (size_t i = 0; i < CONFIG_PARAM_COUNT; i++)
+      LOG(MSG_DUMP_CONFIG, CONFIG_PARAMS[i].name, cfg.*CONFIG_PARAMS[i].field);
+    LOG(MSG_DUMP_SENSORS, sharedData.lumensRaw, sharedData.distanceRaw,
+        sharedData.accelXRaw, sharedData.tiltSideRaw, sharedData.tiltFBRaw);
+    LOG(MSG_DUMP_PERIOD, status.periodMs, status.proximity, cfg.fastPeriodMs,
+        cfg.idlePeriodMs, cfg.fastProximity, cfg.idleProximity);
+    LidarStats lidar = lidarStats();
+    LOG(MSG_DUMP_DROPS, latencyDrops(DROP_TELEMETRY_FULL),
+        latencyDrops(DROP_LIDAR_NONE), lidar.invalid, lidar.dropped);
+    if (LATENCY_STATS) {
+      // Stages are CPU time; ages run from the sensor's sample time
+      for (int m = 0; m < LATENCY_METRICS; m++) {
+        const LatencyHistogram &h = latencyHistogram((LatencyMetric)m);
+        LOG(MSG_DUMP_LATENCY, latencyMetricName((LatencyMetric)m), h.count,
+            h.count ? h.totalNs / 1000.0 / h.count : 0.0,
+            latencyPercentileNs(h, 0.5f) / 1000.0,
+            latencyPercentileNs(h, 0.99f) / 1000.0, h.maxNs / 1000.0);
+      }
+    }
+    UplinkStats uplink = uplinkStats();
+    TelemetryLogStats tlog = uplinkLogStats();
+    LOG(MSG_DUMP_UPLINK, uplink.sent, uplink.logged, uplink.replayed,
+        uplink.failures, uplink.dropped);
+    LOG(MSG_DUMP_TLOG, uplinkBacklog(), tlog.lost, tlog.corrupt,
+        tlog.maxEraseCount);
+    FlashEraseStats erase = flashEraseStats();
+    LOG(MSG_DUMP_FLASH, erase.erases, erase.deferred, erase.maxEraseUs);
+    MpuFifoStats imu = mpu6050FifoStats();
+    LOG(MSG_DUMP_IMU, imu.frames, imu.dropped, imu.overflows);
+
+    // Heap fragmentation shows as a shrinking largest block
+    static uint32_t lastAllocs = 0;
+    uint32_t allocs = allocCount();
+    LOG(MSG_DUMP_HEAP, ESP.getFreeHeap(), ESP.getMinFreeHeap(),
+        ESP.getMaxAllocHeap());
+    if (allocCountEnabled())
+      LOG(MSG_DUMP_ALLOCS, allocs - lastAllocs);
+    lastAllocs = allocs;
+
+    // I2C bus occupancy since the last print, queueing delay since boot
+    static uint64_t lastBusyUs[I2C_DEVICE_COUNT] = {};
+    uint32_t overruns = 0;
+    for (int d = 0; d < I2C_DEVICE_COUNT; d++) {
+      I2cBusStats bus = i2cBusStats((I2cDevice)d);
+      float occupancy = (bus.busyUs - lastBusyUs[d]) / 10000.0f; // % of 1 s
+      lastBusyUs[d] = bus.busyUs;
+      LOG(MSG_DUMP_I2C, i2cDeviceName((I2cDevice)d), occupancy,
+          bus.transactions,
+          bus.transactions ? (uint32_t)(bus.queueDelayUs / bus.transactions)
+                           : 0,
+          bus.maxQueueDelayUs, bus.failures, bus.rejected);
+      overruns += bus.overruns;
+    }
+    LOG(MSG_DUMP_I2C_BUS, overruns, i2cBusRecoveries());
+    // Sensor health since boot
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+      SensorHealthStats health = sensorHealthStats((SensorId)s);
+      LOG(MSG_DUMP_HEALTH, sensorName((SensorId)s), health.misses,
+          health.failures, health.reinits, health.recoveries);
+    }
+    if (TRACE_SINK != 0) {
+      TraceStats trace = traceStats();
+      LOG(MSG_DUMP_TRACE, trace.ticks, trace.configs, trace.dropped);
+    }
   }
 
-  // Firebase upload is handled by the FreeRTOS task on Core 0
+  // The control loop runs in controlTask on Core 1, Firebase upload in
+  // firebaseTask on Core 0
 }
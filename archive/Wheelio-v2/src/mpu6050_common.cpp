@@ -0,0 +1,102 @@
+#include "attitude.h"
+#include "config.h"
+#include "filter_bank.h"
+#include "mpu6050_sensor.h"
+#include <math.h>
+
+// Hardware-independent half of the MPU6050 driver: attitude from gyro and
+// accel, and the accel smoothing, run once per frame whichever way frames
+// arrive. The accel alpha is solved at compile time from
+// MPU_SMOOTHING_ALPHA and MPU_SAMPLE_RATE_HZ.
+
+static constexpr double powInt(double base, uint32_t n) {
+  double result = 1.0;
+  for (uint32_t i = 0; i < n; i++)
+    result *= base;
+  return result;
+}
+
+// MPU_SMOOTHING_ALPHA is tuned for one sample per control tick. The
+// per-frame alpha that keeps the same time constant solves
+// (1 - x)^framesPerTick = 1 - MPU_SMOOTHING_ALPHA; bisect for it.
+static constexpr double frameAlpha(uint32_t framesPerTick) {
+  double low = 0.0, high = 1.0;
+  for (int i = 0; i < 64; i++) {
+    double mid = (low + high) / 2;
+    if (powInt(1.0 - mid, framesPerTick) > 1.0 - MPU_SMOOTHING_ALPHA)
+      low = mid;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// The chip divides its 1 kHz rate, as in mpu6050StartFifo()
+static constexpr uint32_t FIFO_RATE_HZ = 1000 / (1000 / MPU_SAMPLE_RATE_HZ);
+static constexpr uint32_t FRAMES_PER_TICK =
+    (FIFO_RATE_HZ * CONTROL_PERIOD_MS + 500) / 1000;
+// Frames wait in the driver's ring for a whole tick, so it has to hold the
+// longest tick the periods can be set to, and then some for a late one
+static_assert(MPU_FRAME_RING >=
+                  FIFO_RATE_HZ * (ADAPTIVE_MAX_PERIOD_MS + MPU_RING_SLACK_MS) /
+                      1000,
+              "MPU_FRAME_RING cannot hold ADAPTIVE_MAX_PERIOD_MS of frames");
+static constexpr float FIFO_ALPHA =
+    FRAMES_PER_TICK > 1 ? (float)frameAlpha(FRAMES_PER_TICK)
+                        : MPU_SMOOTHING_ALPHA;
+
+// Accel axes are smoothed for the accelX/Y/Z fields; tilt comes from the
+// gyro + accel estimator, which needs no extra smoothing
+static const size_t ACCEL_CHANNELS = 3;
+static FilterBank<ACCEL_CHANNELS> accelSmoother;
+static AttitudeEstimator attitude(MPU_FUSION_KP, MPU_FUSION_KI,
+                                  MPU_FUSION_ACCEL_GATE);
+static uint16_t alphaRate = 0xFFFF; // rate the alphas were set for
+static uint64_t newestUs = 0;
+
+static void addFrame(const ImuFrame &frame, float *accel) {
+  attitude.update(frame);
+  newestUs = frame.timestampUs;
+  accel[0] = frame.accelX;
+  accel[1] = frame.accelY;
+  accel[2] = frame.accelZ;
+}
+
+static MpuData current() {
+  float accel[ACCEL_CHANNELS];
+  accelSmoother.outputs(accel);
+  return {accel[0], accel[1], accel[2], attitude.tiltSide(),
+          attitude.tiltFB(), newestUs};
+}
+
+MpuData readMpuData() {
+  uint16_t rate = mpu6050SampleRate();
+  if (rate != alphaRate) {
+    float alpha = rate == 0 ? MPU_SMOOTHING_ALPHA : FIFO_ALPHA;
+    for (size_t c = 0; c < ACCEL_CHANNELS; c++)
+      accelSmoother.setAlpha(c, alpha);
+    alphaRate = rate;
+  }
+
+  if (rate == 0) {
+    ImuFrame frame;
+    if (mpu6050ReadFrame(frame)) {
+      float accel[ACCEL_CHANNELS];
+      addFrame(frame, accel);
+      accelSmoother.update(accel);
+    }
+    return current();
+  }
+
+  // The estimator runs on every frame of a burst, then the accel axes get
+  // one tight filter pass over it
+  ImuFrame frames[32];
+  float block[32][ACCEL_CHANNELS];
+  size_t n;
+  while ((n = mpu6050ReadFrames(frames, 32)) > 0) {
+    for (size_t i = 0; i < n; i++)
+      addFrame(frames[i], block[i]);
+    accelSmoother.updateBlock(&block[0][0], n);
+  }
+  return current();
+}
@@ -1,36 +1,268 @@
 #include "mpu6050_sensor.h"
 #include "config.h"
+#include "debug_log.h"
+#include "i2c_bus.h"
+#include "ring_buffer.h"
+#include "timebase.h"
+#include <Arduino.h>
 #include <Adafruit_MPU6050.h>
 #include <Adafruit_Sensor.h>
 #include <Wire.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 static Adafruit_MPU6050 mpu;
-static MpuData prevData = {0, 0, 0, 0, 0};
-static const float alpha = 0.2f;
+
+// --- FIFO acquisition ---
+// The data-ready interrupt only counts samples; every MPU_FIFO_BURST_FRAMES
+// it wakes mpuFifoTask, which queues a high-priority drain on the I2C bus
+// task. The drain reads the chip FIFO in bursts into fifoFrames, and the
+// control loop pops from fifoFrames without touching I2C.
+
+#define MPU_ADDR 0x68
+#define REG_SMPLRT_DIV 0x19
+#define REG_CONFIG 0x1A
+#define REG_FIFO_EN 0x23
+#define REG_INT_PIN_CFG 0x37
+#define REG_INT_ENABLE 0x38
+#define REG_INT_STATUS 0x3A
+#define REG_USER_CTRL 0x6A
+#define REG_FIFO_COUNTH 0x72
+#define REG_FIFO_R_W 0x74
+
+#define FIFO_EN_ACCEL_GYRO 0x78 // XG, YG, ZG and ACCEL
+#define USER_CTRL_FIFO_EN 0x40
+#define USER_CTRL_FIFO_RESET 0x04
+#define INT_DATA_RDY 0x01
+#define INT_FIFO_OFLOW 0x10
+#define FIFO_FRAME_BYTES 12 // accel XYZ then gyro XYZ, big-endian int16
+#define FIFO_SIZE_BYTES 1024
+#define WIRE_BURST_FRAMES 10 // 120 bytes fits the 128-byte Wire buffer
+
+// +-4 g and +-500 deg/s, set explicitly so the scales below hold
+static const float ACCEL_SCALE = 9.80665f / 8192.0f;
+static const float GYRO_SCALE = (500.0f / 32768.0f) * (PI / 180.0f);
+
+static RingBuffer<ImuFrame, MPU_FRAME_RING> fifoFrames;
+static MpuFifoStats fifoStats = {};
+static uint16_t sampleRate = 0;
+static uint32_t samplePeriodUs = 0;
+static TaskHandle_t fifoTaskHandle = NULL;
+static volatile uint32_t readyCount = 0;
+static volatile bool drainQueued = false;
+static volatile uint64_t lastReadyUs = 0;
+static portMUX_TYPE readyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void writeRegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(MPU_ADDR);
+  Wire.write(reg);
+  Wire.write(value);
+  Wire.endTransmission();
+}
+
+static bool readRegisters(uint8_t reg, uint8_t *buf, size_t len) {
+  Wire.beginTransmission(MPU_ADDR);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0)
+    return false;
+  if (Wire.requestFrom((uint8_t)MPU_ADDR, len) != len)
+    return false;
+  for (size_t i = 0; i < len; i++)
+    buf[i] = Wire.read();
+  return true;
+}
+
+static int16_t be16(const uint8_t *p) { return (int16_t)((p[0] << 8) | p[1]); }
+
+static void resetFifo() {
+  writeRegister(REG_USER_CTRL, 0);
+  writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_RESET);
+  writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_EN);
+}
+
+static void IRAM_ATTR onDataReady() {
+  portENTER_CRITICAL_ISR(&readyMux);
+  lastReadyUs = esp_timer_get_time();
+  portEXIT_CRITICAL_ISR(&readyMux);
+  if (++readyCount % MPU_FIFO_BURST_FRAMES == 0) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(fifoTaskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+// False on a bus error
+static bool drainFifo() {
+  // The newest frame in the FIFO is the one the last interrupt announced
+  // (give or take one that lands while we read the count)
+  portENTER_CRITICAL(&readyMux);
+  uint64_t newestUs = lastReadyUs;
+  portEXIT_CRITICAL(&readyMux);
+  uint64_t nowUs = timebaseMicros();
+  if (nowUs - newestUs > (uint64_t)samplePeriodUs * MPU_FIFO_BURST_FRAMES * 2)
+    newestUs = nowUs; // no interrupts seen lately (INT not wired?)
+
+  uint8_t status;
+  uint8_t countBuf[2];
+  if (!readRegisters(REG_INT_STATUS, &status, 1) ||
+      !readRegisters(REG_FIFO_COUNTH, countBuf, 2))
+    return false;
+
+  uint16_t count = (countBuf[0] << 8) | countBuf[1];
+  if ((status & INT_FIFO_OFLOW) || count >= FIFO_SIZE_BYTES) {
+    // Frame alignment is lost once the FIFO wraps; start over
+    fifoStats.overflows++;
+    resetFifo();
+    return true;
+  }
+
+  size_t pending = count / FIFO_FRAME_BYTES;
+  uint8_t buf[WIRE_BURST_FRAMES * FIFO_FRAME_BYTES];
+  size_t index = 0;
+  while (index < pending) {
+    size_t n = pending - index;
+    if (n > WIRE_BURST_FRAMES)
+      n = WIRE_BURST_FRAMES;
+    if (!readRegisters(REG_FIFO_R_W, buf, n * FIFO_FRAME_BYTES))
+      return false;
+    fifoStats.bursts++;
+    for (size_t i = 0; i < n; i++, index++) {
+      const uint8_t *p = buf + i * FIFO_FRAME_BYTES;
+      ImuFrame frame;
+      frame.timestampUs =
+          newestUs - (uint64_t)(pending - 1 - index) * samplePeriodUs;
+      frame.accelX = be16(p + 0) * ACCEL_SCALE;
+      frame.accelY = be16(p + 2) * ACCEL_SCALE;
+      frame.accelZ = be16(p + 4) * ACCEL_SCALE;
+      frame.gyroX = be16(p + 6) * GYRO_SCALE;
+      frame.gyroY = be16(p + 8) * GYRO_SCALE;
+      frame.gyroZ = be16(p + 10) * GYRO_SCALE;
+      if (fifoFrames.push(frame))
+        fifoStats.frames++;
+      else
+        fifoStats.dropped++;
+    }
+  }
+  return true;
+}
+
+static bool drainTransaction(void *context) {
+  bool ok = drainFifo();
+  drainQueued = false;
+  return ok;
+}
+
+static void mpuFifoTask(void *pvParameters) {
+  // If INT is not wired we still drain on timeout, just later
+  TickType_t timeout = pdMS_TO_TICKS(
+      2 * 1000 * MPU_FIFO_BURST_FRAMES / sampleRate + 1);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, timeout);
+    // One drain in flight is enough; it empties whatever has accumulated
+    if (!drainQueued) {
+      drainQueued = true;
+      if (!i2cBusSubmit(I2C_DEVICE_MPU6050, I2C_PRIORITY_HIGH,
+                        drainTransaction, NULL))
+        drainQueued = false;
+    }
+  }
+}
+
+static bool beginTransaction(void *context) { return mpu.begin(); }
+
+static void startFifoTask(uint16_t sampleRateHz);
 
 void mpu6050Init() {
-  Wire.begin(PIN_MPU_SDA, PIN_MPU_SCL);
-  if (!mpu.begin()) {
-    Serial.println("Failed to initialize MPU6050 sensor");
+  i2cBusInit();
+  if (!i2cBusRun(I2C_DEVICE_MPU6050, I2C_PRIORITY_HIGH, beginTransaction, NULL,
+                 1000)) {
+    LOG(MSG_MPU_INIT_FAILED);
+    // Acquire as if the chip were there; sensor health notices the missing
+    // frames and mpu6050Recover() sets it up once it answers
+    if (MPU_USE_FIFO)
+      startFifoTask(MPU_SAMPLE_RATE_HZ);
     return;
   }
-  Serial.println("MPU6050 initialized successfully");
-}
-
-MpuData readMpuData() {
-  sensors_event_t a, g, temp;
-  mpu.getEvent(&a, &g, &temp);
-  float accelX = a.acceleration.x;
-  float accelY = a.acceleration.y;
-  float accelZ = a.acceleration.z;
-  // Tilt calculations
-  float tiltSide = atan2(accelY, accelZ) * 180.0 / PI;
-  float tiltFB = atan2(accelX, accelZ) * 180.0 / PI;
-  // Complementary filter
-  prevData.accelX = alpha * accelX + (1 - alpha) * prevData.accelX;
-  prevData.accelY = alpha * accelY + (1 - alpha) * prevData.accelY;
-  prevData.accelZ = alpha * accelZ + (1 - alpha) * prevData.accelZ;
-  prevData.tiltSide = alpha * tiltSide + (1 - alpha) * prevData.tiltSide;
-  prevData.tiltFB = alpha * tiltFB + (1 - alpha) * prevData.tiltFB;
-  return prevData;
+  LOG(MSG_MPU_INIT_OK);
+  if (MPU_USE_FIFO && !mpu6050StartFifo(MPU_SAMPLE_RATE_HZ))
+    LOG(MSG_MPU_FIFO_UNAVAILABLE);
+}
+
+static bool configureFifoTransaction(void *context) {
+  uint16_t sampleRateHz = *(const uint16_t *)context;
+  mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
+  mpu.setGyroRange(MPU6050_RANGE_500_DEG);
+  // DLPF on (184 Hz) puts the internal rate at 1 kHz
+  mpu.setFilterBandwidth(MPU6050_BAND_184_HZ);
+  writeRegister(REG_SMPLRT_DIV, (uint8_t)(1000 / sampleRateHz - 1));
+  writeRegister(REG_INT_PIN_CFG, 0x00); // active high, push-pull, 50 us pulse
+  writeRegister(REG_INT_ENABLE, INT_DATA_RDY);
+  writeRegister(REG_FIFO_EN, FIFO_EN_ACCEL_GYRO);
+  resetFifo();
+  return true;
+}
+
+bool mpu6050StartFifo(uint16_t sampleRateHz) {
+  if (sampleRateHz < 4 || sampleRateHz > 1000 || fifoTaskHandle != NULL)
+    return false;
+  static uint16_t requestedRate;
+  requestedRate = sampleRateHz;
+  if (!i2cBusRun(I2C_DEVICE_MPU6050, I2C_PRIORITY_HIGH,
+                 configureFifoTransaction, &requestedRate, 1000))
+    return false;
+  startFifoTask(sampleRateHz);
+  return true;
 }
+
+static void startFifoTask(uint16_t sampleRateHz) {
+  sampleRate = 1000 / (1000 / sampleRateHz);
+  samplePeriodUs = 1000000UL / sampleRate;
+  xTaskCreatePinnedToCore(mpuFifoTask, "mpuFifo", 4096, NULL, 3,
+                          &fifoTaskHandle, 0);
+  pinMode(PIN_MPU_INT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_MPU_INT), onDataReady, RISING);
+}
+
+// A reset chip is back to polling defaults; in FIFO mode set it up again
+// for the running rate (the divider works out the same)
+static bool recoverTransaction(void *context) {
+  if (!mpu.begin())
+    return false;
+  return sampleRate == 0 || configureFifoTransaction(&sampleRate);
+}
+
+bool mpu6050Recover() {
+  return i2cBusSubmit(I2C_DEVICE_MPU6050, I2C_PRIORITY_HIGH,
+                      recoverTransaction, NULL);
+}
+
+static bool getEventTransaction(void *context) {
+  sensors_event_t *events = (sensors_event_t *)context;
+  return mpu.getEvent(&events[0], &events[1], &events[2]);
+}
+
+bool mpu6050ReadFrame(ImuFrame &frame) {
+  static sensors_event_t events[3]; // outlives a timed-out transaction
+  if (!i2cBusRun(I2C_DEVICE_MPU6050, I2C_PRIORITY_HIGH, getEventTransaction,
+                 events, 20))
+    return false;
+  const sensors_event_t &a = events[0];
+  const sensors_event_t &g = events[1];
+  frame.timestampUs = timebaseMicros();
+  frame.accelX = a.acceleration.x;
+  frame.accelY = a.acceleration.y;
+  frame.accelZ = a.acceleration.z;
+  frame.gyroX = g.gyro.x;
+  frame.gyroY = g.gyro.y;
+  frame.gyroZ = g.gyro.z;
+  return true;
+}
+
+size_t mpu6050ReadFrames(ImuFrame *frames, size_t maxFrames) {
+  return fifoFrames.popMany(frames, maxFrames);
+}
+
+uint16_t mpu6050SampleRate() { return sampleRate; }
+
+MpuFifoStats mpu6050FifoStats() { return fifoStats; }
@@ -0,0 +1,334 @@
+#include "raw_trace.h"
+#include "config.h"
+#include "config_store.h"
+#include "crc32.h"
+#include "ring_buffer.h"
+#include "varint.h"
+#include <atomic>
+#include <string.h>
+
+static_assert(CONFIG_BLOB_MAX_BYTES <= TRACE_FRAME_MAX_BYTES,
+              "a config blob fits one frame");
+
+// Floats go as their raw little-endian bits, so a replay sees exactly what
+// the tick saw
+static void writeBits(VarintWriter &w, float value) {
+  uint32_t raw;
+  memcpy(&raw, &value, sizeof(raw));
+  for (int i = 0; i < 4; i++)
+    w.byte((uint8_t)(raw >> (8 * i)));
+}
+
+static float readBits(VarintReader &r) {
+  uint32_t raw = 0;
+  for (int i = 0; i < 4; i++)
+    raw |= (uint32_t)r.byte() << (8 * i);
+  float value;
+  memcpy(&value, &raw, sizeof(value));
+  return value;
+}
+
+size_t traceEncodeTick(const RawSample &raw, uint64_t prevUs, uint8_t *out,
+                       size_t capacity) {
+  VarintWriter w = {out, capacity, 0, true};
+  w.varint(raw.timestampUs - prevUs);
+  writeBits(w, raw.lumens);
+  w.byte(raw.lidarCount);
+  for (uint8_t i = 0; i < raw.lidarCount; i++) {
+    w.zigzag((int64_t)(raw.timestampUs - raw.lidar[i].timestampUs));
+    w.zigzag(raw.lidar[i].distance);
+  }
+  w.zigzag((int64_t)(raw.timestampUs - raw.mpu.timestampUs));
+  writeBits(w, raw.mpu.accelX);
+  writeBits(w, raw.mpu.accelY);
+  writeBits(w, raw.mpu.accelZ);
+  writeBits(w, raw.mpu.tiltSide);
+  writeBits(w, raw.mpu.tiltFB);
+  return w.ok ? w.length : 0;
+}
+
+bool traceDecodeTick(const uint8_t *payload, size_t length, uint64_t prevUs,
+                     RawSample &raw) {
+  VarintReader r = {payload, length, 0, true};
+  raw = RawSample();
+  raw.timestampUs = prevUs + r.varint();
+  raw.lumens = readBits(r);
+  raw.lidarCount = r.byte();
+  if (raw.lidarCount > LIDAR_MAX_SAMPLES_PER_TICK)
+    return false;
+  for (uint8_t i = 0; i < raw.lidarCount; i++) {
+    raw.lidar[i].timestampUs = raw.timestampUs - r.zigzag();
+    raw.lidar[i].distance = (int)r.zigzag();
+  }
+  raw.mpu.timestampUs = raw.timestampUs - r.zigzag();
+  raw.mpu.accelX = readBits(r);
+  raw.mpu.accelY = readBits(r);
+  raw.mpu.accelZ = readBits(r);
+  raw.mpu.tiltSide = readBits(r);
+  raw.mpu.tiltFB = readBits(r);
+  return r.ok && r.pos == length;
+}
+
+size_t traceFrame(TraceFrameType type, const uint8_t *payload, size_t length,
+                  uint8_t *out, size_t capacity) {
+  VarintWriter w = {out, capacity, 0, length <= TRACE_FRAME_MAX_BYTES};
+  w.byte(TRACE_FRAME_MAGIC);
+  w.byte(type);
+  w.varint(length);
+  for (size_t i = 0; i < length; i++)
+    w.byte(payload[i]);
+  if (!w.ok)
+    return 0;
+  w.byte((uint8_t)crc32(out + 1, w.length - 1));
+  return w.ok ? w.length : 0;
+}
+
+TraceReader::TraceReader(FrameFn onFrame, void *context)
+    : onFrame(onFrame), context(context), length(0), skippedBytes(0) {}
+
+void TraceReader::skip(size_t count) {
+  memmove(buffer, buffer + count, length - count);
+  length -= count;
+  skippedBytes += count;
+}
+
+void TraceReader::feed(const uint8_t *data, size_t count) {
+  while (count > 0) {
+    size_t take = sizeof(buffer) - length;
+    take = take < count ? take : count;
+    memcpy(buffer + length, data, take);
+    length += take;
+    data += take;
+    count -= take;
+
+    // The buffer holds two of the largest frames, so once it is aligned
+    // on a magic byte a whole frame is either there or still to come
+    for (;;) {
+      size_t start = 0;
+      while (start < length && buffer[start] != TRACE_FRAME_MAGIC)
+        start++;
+      skip(start);
+      if (length < 3)
+        break;
+      size_t pos = 2, payload = 0;
+      bool complete = false;
+      for (int shift = 0; pos < length && shift < 21; shift += 7) {
+        uint8_t b = buffer[pos++];
+        payload |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete && pos < length) {
+        skip(1); // over-long length
+        continue;
+      }
+      if (!complete)
+        break;
+      if (buffer[1] >= TRACE_TYPES || payload > TRACE_FRAME_MAX_BYTES) {
+        skip(1);
+        continue;
+      }
+      size_t frame = pos + payload + 1;
+      if (length < frame)
+        break;
+      uint8_t crc = (uint8_t)crc32(buffer + 1, pos - 1 + payload);
+      if (crc != buffer[frame - 1]) {
+        skip(1);
+        continue;
+      }
+      onFrame((TraceFrameType)buffer[1], buffer + pos, payload, context);
+      memmove(buffer, buffer + frame, length - frame);
+      length -= frame;
+    }
+  }
+}
+
+// Queued units: u16 length, then SYNC, CONFIG and TICK frames of one tick
+static RingBuffer<uint8_t, TRACE_BUFFER_BYTES> queue;
+static std::atomic<bool> recording(false);
+static TraceStats stats = {};
+// Producer-owned (the control task)
+static bool needSync = true;
+static size_t sinceSync = 0; // bytes queued since the last SYNC
+static uint64_t prevTickUs = 0;
+static RuntimeConfig lastConfig;
+// Consumer-owned: length of the unit whose header was popped already
+static size_t pendingLength = 0;
+
+static const size_t UNIT_MAX_BYTES = 2 + 3 * TRACE_FRAME_MAX_BYTES;
+static_assert(UNIT_MAX_BYTES < TRACE_BUFFER_BYTES,
+              "the trace buffer holds the largest tick");
+
+void traceStart() {
+  needSync = true;
+  recording.store(true, std::memory_order_release);
+}
+
+void traceStop() { recording.store(false, std::memory_order_release); }
+
+void traceRecord(const RawSample &raw, const RuntimeConfig &cfg) {
+  if (!recording.load(std::memory_order_acquire))
+    return;
+  static uint8_t unit[UNIT_MAX_BYTES];
+  uint8_t payload[TRACE_FRAME_MAX_BYTES];
+  bool sync = needSync || sinceSync >= TRACE_SYNC_BYTES;
+  bool config = sync || memcmp(&cfg, &lastConfig, sizeof(cfg)) != 0;
+
+  size_t length = 2;
+  if (sync) {
+    payload[0] = TRACE_VERSION;
+    length += traceFrame(TRACE_SYNC, payload, 1, unit + length,
+                         sizeof(unit) - length);
+  }
+  if (config) {
+    size_t n = configSerialize(payload, sizeof(payload), cfg);
+    length += traceFrame(TRACE_CONFIG, payload, n, unit + length,
+                         sizeof(unit) - length);
+  }
+  size_t n = traceEncodeTick(raw, sync ? 0 : prevTickUs, payload,
+                             sizeof(payload));
+  length += traceFrame(TRACE_TICK, payload, n, unit + length,
+                       sizeof(unit) - length);
+  unit[0] = (uint8_t)(length - 2);
+  unit[1] = (uint8_t)((length - 2) >> 8);
+  if (!queue.pushMany(unit, length)) {
+    // The next tick that fits starts over with SYNC and CONFIG
+    stats.dropped++;
+    needSync = true;
+    return;
+  }
+  if (sync) {
+    needSync = false;
+    sinceSync = 0;
+  }
+  if (config) {
+    lastConfig = cfg;
+    stats.configs++;
+  }
+  sinceSync += length;
+  prevTickUs = raw.timestampUs;
+  stats.ticks++;
+}
+
+size_t traceDrain(uint8_t *out, size_t capacity) {
+  size_t length = 0;
+  for (;;) {
+    if (pendingLength == 0) {
+      uint8_t header[2];
+      if (queue.size() < sizeof(header))
+        break;
+      queue.popMany(header, sizeof(header));
+      pendingLength = header[0] | header[1] << 8;
+    }
+    // Units are pushed whole, so the rest is already there
+    if (capacity - length < pendingLength)
+      break;
+    length += queue.popMany(out + length, pendingLength);
+    pendingLength = 0;
+  }
+  return length;
+}
+
+TraceStats traceStats() { return stats; }
+
+struct TraceSectorHeader {
+  uint32_t magic;
+  uint32_t sequence;
+};
+
+TraceFlash::TraceFlash() : storage(NULL), sequence(0), sector(0), offset(0) {}
+
+// Leaves the current sector as it was on failure, so the next append
+// tries again; an erase may be refused for lack of slack (flash_storage.h)
+bool TraceFlash::openSector(size_t index, uint32_t nextSequence) {
+  size_t base = index * storage->sectorSize();
+  TraceSectorHeader header = {TRACE_SECTOR_MAGIC, nextSequence};
+  if (!storage->eraseSector(base) ||
+      !storage->write(base, &header, sizeof(header)))
+    return false;
+  sector = index;
+  sequence = nextSequence;
+  offset = sizeof(header);
+  return true;
+}
+
+bool TraceFlash::begin(FlashStorage *flash) {
+  storage = flash;
+  if (storage == NULL || storage->size() < 2 * storage->sectorSize())
+    return false;
+  size_t sectors = storage->size() / storage->sectorSize();
+  size_t newest = sectors - 1;
+  uint32_t newestSequence = 0;
+  for (size_t i = 0; i < sectors; i++) {
+    TraceSectorHeader header;
+    if (storage->read(i * storage->sectorSize(), &header, sizeof(header)) &&
+        header.magic == TRACE_SECTOR_MAGIC &&
+        header.sequence > newestSequence) {
+      newest = i;
+      newestSequence = header.sequence;
+    }
+  }
+  // Full, so the first append opens the sector after the newest
+  sector = newest;
+  sequence = newestSequence;
+  offset = storage->sectorSize();
+  return true;
+}
+
+bool TraceFlash::append(const uint8_t *data, size_t length) {
+  if (storage == NULL)
+    return false;
+  size_t sectorSize = storage->sectorSize();
+  while (length > 0) {
+    if (offset == sectorSize) {
+      size_t sectors = storage->size() / sectorSize;
+      if (!openSector((sector + 1) % sectors, sequence + 1))
+        return false;
+    }
+    size_t chunk = sectorSize - offset;
+    chunk = chunk < length ? chunk : length;
+    if (!storage->write(sector * sectorSize + offset, data, chunk))
+      return false;
+    offset += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+bool TraceFlash::readAll(FlashStorage *storage, TraceReader &reader) {
+  if (storage == NULL)
+    return false;
+  size_t sectorSize = storage->sectorSize();
+  size_t sectors = storage->size() / sectorSize;
+  uint32_t fed = 0; // sequence of the last sector fed
+  for (;;) {
+    // The oldest sector not fed yet; sectors are few, so just rescan
+    size_t next = sectors;
+    uint32_t nextSequence = 0;
+    for (size_t i = 0; i < sectors; i++) {
+      TraceSectorHeader header;
+      if (!storage->read(i * sectorSize, &header, sizeof(header)))
+        return false;
+      if (header.magic == TRACE_SECTOR_MAGIC && header.sequence > fed &&
+          (next == sectors || header.sequence < nextSequence)) {
+        next = i;
+        nextSequence = header.sequence;
+      }
+    }
+    if (next == sectors)
+      return true;
+    uint8_t chunk[256];
+    for (size_t at = sizeof(TraceSectorHeader); at < sectorSize;) {
+      size_t n = sectorSize - at < sizeof(chunk) ? sectorSize - at
+                                                 : sizeof(chunk);
+      if (!storage->read(next * sectorSize + at, chunk, n))
+        return false;
+      reader.feed(chunk, n);
+      at += n;
+    }
+    fed = nextSequence;
+  }
+}
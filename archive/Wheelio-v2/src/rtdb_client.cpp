@@ -0,0 +1,155 @@
+#include "rtdb_client.h"
+#include "config.h"
+#include "http_response.h"
+#include "timebase.h"
+#include <Arduino.h>
+#include <FirebaseESP32.h>
+#include <WiFiClientSecure.h>
+#include <string.h>
+
+#define RTDB_PORT 443
+#define RTDB_TIMEOUT_MS 5000
+// ID tokens last an hour and the Firebase client renews them early; copying
+// the current one every few minutes keeps the per-request path heap-free
+#define RTDB_TOKEN_REFRESH_MS (5 * 60 * 1000UL)
+
+static WiFiClientSecure client;
+static char host[96];
+static char token[1400];
+static uint32_t tokenCopiedMs = 0;
+static char header[256];
+static char line[128];
+static const char *lastError = "";
+
+void rtdbInit() {
+  // FIREBASE_HOST is "https://<name>.firebasedatabase.app/"
+  const char *start = strstr(FIREBASE_HOST, "://");
+  start = start ? start + 3 : FIREBASE_HOST;
+  size_t n = strcspn(start, "/");
+  if (n >= sizeof(host))
+    n = sizeof(host) - 1;
+  memcpy(host, start, n);
+  host[n] = '\0';
+  // Same as the Firebase client's default: no certificate pinning
+  client.setInsecure();
+  client.setTimeout(RTDB_TIMEOUT_MS / 1000);
+}
+
+static bool refreshToken(bool force) {
+  uint32_t now = timebaseMillis();
+  if (!force && token[0] && now - tokenCopiedMs < RTDB_TOKEN_REFRESH_MS)
+    return true;
+  String current = Firebase.getToken();
+  if (current.length() == 0 || current.length() >= sizeof(token))
+    return false;
+  memcpy(token, current.c_str(), current.length() + 1);
+  tokenCopiedMs = now;
+  return true;
+}
+
+static bool connect() {
+  if (client.connected())
+    return true;
+  client.stop();
+  if (!client.connect(host, RTDB_PORT)) {
+    lastError = "connection failed";
+    return false;
+  }
+  return true;
+}
+
+// Reads one header line into `line` without the CRLF
+static bool readLine() {
+  size_t n = client.readBytesUntil('\n', line, sizeof(line) - 1);
+  if (n == 0 && !client.connected())
+    return false;
+  if (n > 0 && line[n - 1] == '\r')
+    n--;
+  line[n] = '\0';
+  return true;
+}
+
+// Reads one response head into `head`; false on a broken or missing one
+static bool readHead(HttpResponseHead &head) {
+  httpResponseBegin(head);
+  bool more = readLine() && httpResponseLine(head, line);
+  while (more && readLine())
+    more = httpResponseLine(head, line);
+  return head.status != 0 && !more;
+}
+
+// Consumes the response; returns the HTTP status (0 on a broken reply).
+// Writes use print=silent, so a success is a 204 without a body; the
+// connection stays open unless the reply says otherwise or was cut short.
+static int readResponse() {
+  HttpResponseHead head;
+  do {
+    if (!readHead(head)) {
+      client.stop();
+      return 0;
+    }
+  } while (head.status / 100 == 1); // interim reply, the real one follows
+
+  // Body is the echoed data or an error object; only the status matters
+  long unread = head.bodyLength;
+  uint32_t deadline = timebaseMillis() + RTDB_TIMEOUT_MS;
+  while (unread > 0 && (int32_t)(deadline - timebaseMillis()) > 0) {
+    int n = client.read((uint8_t *)line, unread < (long)sizeof(line)
+                                             ? (size_t)unread
+                                             : sizeof(line));
+    if (n > 0)
+      unread -= n;
+    else if (!client.connected())
+      break;
+  }
+  if (!httpResponseReusable(head, unread))
+    client.stop();
+  return head.status;
+}
+
+bool rtdbWrite(RtdbMethod method, const char *path, const char *body,
+               size_t length) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!refreshToken(attempt > 0)) {
+      lastError = "no auth token";
+      return false;
+    }
+    if (!connect())
+      return false;
+
+    int n = snprintf(header, sizeof(header),
+                     "%s %s.json?print=silent&auth=",
+                     method == RTDB_PUT ? "PUT" : "PATCH", path);
+    if (n <= 0 || n >= (int)sizeof(header)) {
+      lastError = "path too long";
+      return false;
+    }
+    client.write((const uint8_t *)header, n);
+    client.write((const uint8_t *)token, strlen(token));
+    n = snprintf(header, sizeof(header),
+                 " HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                 "Content-Length: %u\r\nConnection: keep-alive\r\n\r\n",
+                 host, (unsigned)length);
+    client.write((const uint8_t *)header, n);
+    if (client.write((const uint8_t *)body, length) != length) {
+      lastError = "write failed";
+      client.stop();
+      continue; // stale keep-alive connection: reconnect once
+    }
+
+    int status = readResponse();
+    if (status >= 200 && status < 300)
+      return true;
+    if (status == 401) {
+      lastError = "unauthorized";
+      continue; // token expired between copies: fetch it again
+    }
+    lastError = status == 0 ? "no response" : "request rejected";
+    if (status == 0)
+      continue;
+    return false;
+  }
+  return false;
+}
+
+const char *rtdbLastError() { return lastError; }
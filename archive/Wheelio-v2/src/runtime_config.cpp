@@ -0,0 +1,32 @@
+#include "runtime_config.h"
+#include "config.h"
+#include "snapshot.h"
+
+static const RuntimeConfig DEFAULTS = {
+    DEFAULT_TILT_SIDE_THRESHOLD,
+    DEFAULT_TILT_FB_THRESHOLD,
+    DEFAULT_DIST_THRESHOLD,
+    DEFAULT_LIGHT_THRESHOLD,
+    DEFAULT_ACCEL_THRESHOLD,
+    EMA_ALPHA_LIGHT, // lightAlpha
+    EMA_ALPHA_LIDAR, // lidarAlpha
+    EMA_ALPHA_MPU,   // mpuAlpha
+    0.0f,            // lightAdjustment
+    0.0f,            // lidarAdjustment
+    0.0f,            // accelXAdjustment
+    0.0f,            // tiltSideAdjustment
+    0.0f,            // tiltFBAdjustment
+    ADAPTIVE_FAST_PERIOD_MS,
+    ADAPTIVE_IDLE_PERIOD_MS,
+    ADAPTIVE_FAST_PROXIMITY,
+    ADAPTIVE_IDLE_PROXIMITY,
+};
+
+static RuntimeConfig draft = DEFAULTS;
+static Snapshot<RuntimeConfig> published(DEFAULTS);
+
+RuntimeConfig &configDraft() { return draft; }
+
+void configPublish() { published.publish(draft); }
+
+const RuntimeConfig &configAcquire() { return published.acquire(); }
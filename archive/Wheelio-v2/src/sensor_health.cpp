@@ -0,0 +1,97 @@
+#include "sensor_health.h"
+#include "config.h"
+#include "debug_log.h"
+#include "warning_rules.h"
+
+static const char *const SENSOR_NAMES[SENSOR_COUNT] = {"imu", "lidar"};
+static const char *const STATE_NAMES[] = {"ok", "stale", "failed"};
+
+// Deadline and the rules each sensor feeds, in SensorId order
+static const uint32_t DEADLINE_MS[SENSOR_COUNT] = {SENSOR_IMU_DEADLINE_MS,
+                                                   SENSOR_LIDAR_DEADLINE_MS};
+static const uint8_t SENSOR_RULES[SENSOR_COUNT] = {MPU_RULES, LIDAR_RULES};
+
+static_assert(SENSOR_COUNT * 2 <= 8, "the packed states fit a byte");
+
+struct SensorHealth {
+  SensorHealthStats stats;
+  bool started;
+  uint64_t lastFreshUs; // the deadline runs from here
+  uint64_t retryAtUs;
+  uint32_t retryMs;
+};
+
+static SensorHealth health[SENSOR_COUNT] = {};
+
+bool sensorHealthUpdate(SensorId sensor, bool fresh, uint64_t nowUs) {
+  SensorHealth &h = health[sensor];
+  SensorHealthStats &s = h.stats;
+  if (!h.started || fresh) {
+    // Until the first tick the sensor has had no chance to deliver
+    h.started = true;
+    h.lastFreshUs = nowUs;
+    h.retryMs = SENSOR_RETRY_MS;
+  }
+  if (fresh) {
+    if (s.state == HEALTH_FAILED)
+      s.recoveries++;
+    if (s.state != HEALTH_OK)
+      LOG(MSG_SENSOR_OK, SENSOR_NAMES[sensor]);
+    s.state = HEALTH_OK;
+    return false;
+  }
+
+  uint64_t silentUs = nowUs - h.lastFreshUs;
+  uint64_t deadlineUs = DEADLINE_MS[sensor] * 1000ULL;
+  if (s.state == HEALTH_OK && silentUs > deadlineUs) {
+    s.misses++;
+    s.state = HEALTH_STALE;
+    LOG(MSG_SENSOR_STALE, SENSOR_NAMES[sensor], DEADLINE_MS[sensor]);
+  }
+  if (s.state == HEALTH_STALE &&
+      silentUs > deadlineUs + SENSOR_FAIL_AFTER_MS * 1000ULL) {
+    s.failures++;
+    s.state = HEALTH_FAILED;
+    h.retryAtUs = nowUs;
+    LOG(MSG_SENSOR_FAILED, SENSOR_NAMES[sensor]);
+  }
+  if (s.state != HEALTH_FAILED || nowUs < h.retryAtUs)
+    return false;
+  s.reinits++;
+  h.retryAtUs = nowUs + h.retryMs * 1000ULL;
+  h.retryMs = h.retryMs * 2 > SENSOR_RETRY_MAX_MS ? SENSOR_RETRY_MAX_MS
+                                                  : h.retryMs * 2;
+  return true;
+}
+
+HealthState sensorHealthState(SensorId sensor) {
+  return health[sensor].stats.state;
+}
+
+SensorHealthStats sensorHealthStats(SensorId sensor) {
+  return health[sensor].stats;
+}
+
+uint8_t sensorHealthUsableRules() {
+  uint8_t rules = RULES_ALL;
+  for (int i = 0; i < SENSOR_COUNT; i++)
+    if (health[i].stats.state == HEALTH_FAILED)
+      rules &= ~SENSOR_RULES[i];
+  return rules;
+}
+
+uint8_t sensorHealthPacked() {
+  uint8_t packed = 0;
+  for (int i = 0; i < SENSOR_COUNT; i++)
+    packed |= health[i].stats.state << (2 * i);
+  return packed;
+}
+
+void sensorHealthReset() {
+  for (int i = 0; i < SENSOR_COUNT; i++)
+    health[i] = SensorHealth();
+}
+
+const char *sensorName(SensorId sensor) { return SENSOR_NAMES[sensor]; }
+
+const char *healthStateName(HealthState state) { return STATE_NAMES[state]; }
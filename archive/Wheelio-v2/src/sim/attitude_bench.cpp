@@ -0,0 +1,178 @@
+#include "attitude.h"
+#include "config.h"
+#include "ema_filter.h"
+#include "sim.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+// Compares tilt from the gyro + accel estimator with the chain it replaced
+// (atan2 of accel, a per-frame EMA, then the control loop's per-tick EMA)
+// on a scripted ride at the FIFO rate: the lean steps between a safe and a
+// dangerous angle while the accelerometer sees noise, vibration and bumps.
+// Reports the delay from the real lean crossing the threshold to the
+// warning, the tilt error while holding a lean, and false warnings. The
+// per-frame cost includes one clock read.
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const uint32_t RATE_HZ = 1000;
+static const uint32_t FRAMES_PER_TICK = RATE_HZ * CONTROL_PERIOD_MS / 1000;
+static const float THRESHOLD = DEFAULT_TILT_SIDE_THRESHOLD;
+static const float SAFE_LEAN = 10.0f, DANGER_LEAN = 36.0f;
+static const double STEP_S = 5.0;  // each lean held this long
+static const double RAMP_S = 0.1;  // to reach it
+static const double SETTLE_S = 1.0; // excluded from the error figures
+
+static uint32_t rngState = 99;
+
+// Uniform noise in [-amplitude, amplitude]
+static float noise(float amplitude) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return amplitude * ((float)(rngState & 0xFFFF) / 32767.5f - 1.0f);
+}
+
+static double leanAt(double t) {
+  int step = (int)(t / STEP_S);
+  double from = step % 2 ? SAFE_LEAN : DANGER_LEAN;
+  double to = step % 2 ? DANGER_LEAN : SAFE_LEAN;
+  if (step == 0)
+    from = to;
+  double k = fmin(1.0, (t - step * STEP_S) / RAMP_S);
+  return from + (to - from) * k;
+}
+
+static ImuFrame frameAt(uint64_t us) {
+  double t = us / 1e6;
+  double lean = leanAt(t) * M_PI / 180.0;
+  double rate = (leanAt(t + 0.0005) - leanAt(t - 0.0005)) / 0.001;
+  ImuFrame frame;
+  frame.timestampUs = us;
+  // Engine vibration, sensor noise, and a 40 ms bump every 0.7 s
+  float vibration = 2.0f * (float)sin(t * 2 * M_PI * 25.0);
+  float bump = fmod(t, 0.7) < 0.04 ? 5.0f : 0.0f;
+  frame.accelX = noise(0.5f);
+  frame.accelY = 9.81f * (float)sin(lean) + bump + noise(0.5f);
+  frame.accelZ = 9.81f * (float)cos(lean) + vibration + noise(0.5f);
+  frame.gyroX = (float)(rate * M_PI / 180.0) + 0.01f + noise(0.03f);
+  frame.gyroY = 0.01f + noise(0.03f);
+  frame.gyroZ = noise(0.03f);
+  return frame;
+}
+
+// What used to be readMpuData() plus tiltSideFilter
+struct LegacyChain {
+  float alpha;
+  float frameTilt = 0.0f;
+  TunableEMAFilter tickFilter{EMA_ALPHA_MPU};
+
+  LegacyChain()
+      : alpha(1.0f - powf(1.0f - MPU_SMOOTHING_ALPHA, 1.0f / FRAMES_PER_TICK)) {
+  }
+  void frame(const ImuFrame &f) {
+    float tilt = atan2f(f.accelY, f.accelZ) * 57.2957795f;
+    frameTilt = alpha * tilt + (1 - alpha) * frameTilt;
+  }
+  float tick() { return tickFilter.update(frameTilt); }
+};
+
+struct FusedChain {
+  AttitudeEstimator attitude{MPU_FUSION_KP, MPU_FUSION_KI,
+                             MPU_FUSION_ACCEL_GATE};
+  void frame(const ImuFrame &f) { attitude.update(f); }
+  float tick() { return attitude.tiltSide(); }
+};
+
+struct ChainResult {
+  double meanDelayMs, maxDelayMs;
+  uint32_t missed;      // dangerous leans never warned about
+  double rmsError;      // degrees, while holding a lean
+  uint32_t falseAlarms; // ticks warning while safe
+  double nsPerFrame;
+};
+
+template <typename Chain>
+static ChainResult run(Chain &chain, double seconds) {
+  rngState = 99; // same ride for every chain
+  ChainResult result = {};
+  double delaySum = 0.0, errorSum = 0.0;
+  uint32_t delays = 0, errorTicks = 0;
+  double crossedAt = -1.0; // real lean crossed the threshold, not warned yet
+  bool wasOver = false;
+  double busyNs = 0.0;
+
+  uint64_t frames = (uint64_t)(seconds * RATE_HZ);
+  for (uint64_t i = 1; i <= frames; i++) {
+    uint64_t us = i * 1000000ULL / RATE_HZ;
+    ImuFrame frame = frameAt(us);
+    SteadyClock::time_point start = SteadyClock::now();
+    chain.frame(frame);
+    busyNs += std::chrono::duration<double, std::nano>(SteadyClock::now() -
+                                                       start)
+                  .count();
+    double t = us / 1e6;
+    double truth = leanAt(t);
+    bool over = truth > THRESHOLD;
+    if (over && !wasOver)
+      crossedAt = t;
+    if (!over && wasOver && crossedAt >= 0.0) {
+      result.missed++;
+      crossedAt = -1.0;
+    }
+    wasOver = over;
+    if (i % FRAMES_PER_TICK)
+      continue;
+
+    float tilt = chain.tick();
+    bool warn = tilt > THRESHOLD;
+    if (warn && crossedAt >= 0.0) {
+      double delayMs = (t - crossedAt) * 1000.0;
+      delaySum += delayMs;
+      delays++;
+      if (delayMs > result.maxDelayMs)
+        result.maxDelayMs = delayMs;
+      crossedAt = -1.0;
+    }
+    double sinceStep = fmod(t, STEP_S);
+    if (sinceStep >= SETTLE_S) {
+      errorSum += (tilt - truth) * (tilt - truth);
+      errorTicks++;
+      if (warn && !over)
+        result.falseAlarms++;
+    }
+  }
+  result.meanDelayMs = delays ? delaySum / delays : 0.0;
+  result.rmsError = errorTicks ? sqrt(errorSum / errorTicks) : 0.0;
+  result.nsPerFrame = busyNs / frames;
+  return result;
+}
+
+static void print(const char *name, const ChainResult &r) {
+  printf("%-22s %9.0f %9.0f %7u %9.2f %7u %9.1f\n", name, r.meanDelayMs,
+         r.maxDelayMs, r.missed, r.rmsError, r.falseAlarms, r.nsPerFrame);
+}
+
+int runAttitudeBenchmark(uint32_t seconds) {
+  LegacyChain legacy;
+  FusedChain fused;
+  ChainResult before = run(legacy, seconds);
+  ChainResult after = run(fused, seconds);
+
+  printf("lean steps %.0f <-> %.0f deg every %.0f s, warning above %.0f deg, "
+         "%u s at %u Hz\n",
+         SAFE_LEAN, DANGER_LEAN, STEP_S, THRESHOLD, seconds, RATE_HZ);
+  printf("%-22s %9s %9s %7s %9s %7s %9s\n", "tilt source", "delay ms",
+         "max ms", "missed", "rms deg", "false", "ns/frame");
+  print("accel atan2 + 2x EMA", before);
+  print("Mahony gyro + accel", after);
+  printf("%u accel samples outside the gate\n",
+         fused.attitude.rejectedAccel());
+
+  bool ok = after.missed == 0 && after.maxDelayMs < before.maxDelayMs &&
+            after.rmsError <= before.rmsError &&
+            after.falseAlarms <= before.falseAlarms;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
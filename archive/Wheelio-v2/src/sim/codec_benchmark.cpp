@@ -0,0 +1,145 @@
+#include "actuators.h"
+#include "config.h"
+#include "control.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "sensor_health.h"
+#include "sim.h"
+#include "telemetry_codec.h"
+#include "telemetry_json.h"
+#include "timebase.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+// Compares the packed telemetry codec with the per-field JSON upload on
+// samples from the simulated control loop: bytes per sample, encode and
+// decode time, and a round trip within the quantization step.
+
+using SteadyClock = std::chrono::steady_clock;
+
+static double nsSince(SteadyClock::time_point start) {
+  return std::chrono::duration<double, std::nano>(SteadyClock::now() - start)
+      .count();
+}
+
+static std::vector<TelemetrySample> recordSamples(uint32_t count) {
+  simSeed(7);
+  lightSensorInit();
+  mpu6050Init();
+  lidarInit();
+  actuatorsInit();
+
+  std::vector<TelemetrySample> samples(count);
+  SensorData data = {};
+  for (uint32_t i = 0; i < count; i++) {
+    simAdvanceMicros(CONTROL_PERIOD_MS * 1000ULL);
+    RawSample raw;
+    controlAcquire(raw);
+    controlCheckHealth(raw);
+    const RuntimeConfig &cfg = configAcquire();
+    controlFilter(raw, cfg, data);
+    samples[i] = TelemetrySample();
+    samples[i].timestampUs = raw.timestampUs;
+    samples[i].epochMs = timebaseEpochMs();
+    samples[i].data = data;
+    samples[i].actuators = controlDecide(data, cfg, raw.timestampUs);
+    samples[i].health = sensorHealthPacked();
+  }
+  return samples;
+}
+
+static bool close(float decoded, float original, float scale) {
+  return fabsf(decoded - original) <= 0.5f / scale + fabsf(original) * 1e-6f;
+}
+
+static bool sameSample(const TelemetrySample &a, const TelemetrySample &b) {
+  return a.timestampUs == b.timestampUs / 1000 * 1000 &&
+         a.epochMs == b.epochMs &&
+         a.actuators.fogLight == b.actuators.fogLight &&
+         a.actuators.warningLight == b.actuators.warningLight &&
+         a.actuators.buzzer == b.actuators.buzzer &&
+         a.actuators.rules == b.actuators.rules && a.health == b.health &&
+         close(a.data.lumensRaw, b.data.lumensRaw, TELEMETRY_CODEC_SCALE[0]) &&
+         close(a.data.distanceRaw, b.data.distanceRaw,
+               TELEMETRY_CODEC_SCALE[1]) &&
+         close(a.data.accelXRaw, b.data.accelXRaw, TELEMETRY_CODEC_SCALE[2]) &&
+         close(a.data.tiltSideRaw, b.data.tiltSideRaw,
+               TELEMETRY_CODEC_SCALE[3]) &&
+         close(a.data.tiltFBRaw, b.data.tiltFBRaw, TELEMETRY_CODEC_SCALE[4]);
+}
+
+static void printRow(const char *name, size_t bytes, double ns, size_t count) {
+  printf("%-18s %12.1f %12.1f\n", name, (double)bytes / count, ns / count);
+}
+
+int runCodecBenchmark(uint32_t count) {
+  count -= count % TELEMETRY_REPLAY_BATCH;
+  if (count == 0)
+    count = TELEMETRY_REPLAY_BATCH;
+  std::vector<TelemetrySample> samples = recordSamples(count);
+  bool ok = true;
+
+  // Current upload: one multi-location JSON document per batch
+  static char body[TELEMETRY_JSON_BUFFER_BYTES];
+  size_t jsonBytes = 0;
+  SteadyClock::time_point t = SteadyClock::now();
+  for (uint32_t i = 0; i < count; i += TELEMETRY_BATCH_SIZE)
+    jsonBytes +=
+        telemetryToJson(&samples[i], TELEMETRY_BATCH_SIZE, body, sizeof(body));
+  double jsonNs = nsSince(t);
+
+  printf("telemetry codec v%d, %u samples from the simulated loop\n",
+         TELEMETRY_CODEC_VERSION, count);
+  printf("%-18s %12s %12s\n", "format", "bytes/sample", "encode ns");
+  printRow("json", jsonBytes, jsonNs, count);
+
+  const uint32_t batchSizes[] = {TELEMETRY_BATCH_SIZE, TELEMETRY_REPLAY_BATCH};
+  for (uint32_t batch : batchSizes) {
+    std::vector<uint8_t> packed(TELEMETRY_ENCODED_BOUND(batch));
+    std::vector<char> text((packed.size() + 2) / 3 * 4 + 1);
+    std::vector<TelemetrySample> decoded(batch);
+    size_t packedBytes = 0, textBytes = 0;
+    double encodeNs = 0, decodeNs = 0;
+    for (uint32_t i = 0; i < count; i += batch) {
+      t = SteadyClock::now();
+      size_t length =
+          telemetryEncode(&samples[i], batch, packed.data(), packed.size());
+      encodeNs += nsSince(t);
+      packedBytes += length;
+      size_t textLength =
+          base64Encode(packed.data(), length, text.data(), text.size());
+      textBytes += textLength;
+      std::vector<uint8_t> unpacked(length);
+      ok = ok && base64Decode(text.data(), textLength, unpacked.data(),
+                              unpacked.size()) == (int)length &&
+           unpacked == std::vector<uint8_t>(packed.begin(),
+                                            packed.begin() + length);
+
+      t = SteadyClock::now();
+      int n = telemetryDecode(packed.data(), length, decoded.data(), batch);
+      decodeNs += nsSince(t);
+      ok = ok && n == (int)batch;
+      for (int k = 0; ok && k < n; k++)
+        ok = sameSample(decoded[k], samples[i + k]);
+
+      // Truncation and a wrong version must be rejected, not misread
+      ok = ok && telemetryDecode(packed.data(), length - 1, decoded.data(),
+                                 batch) == -1;
+      packed[0]++;
+      ok = ok && telemetryDecode(packed.data(), length, decoded.data(),
+                                 batch) == -1;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "packed x%u", batch);
+    printRow(name, packedBytes, encodeNs, count);
+    snprintf(name, sizeof(name), "  as base64");
+    printRow(name, textBytes, encodeNs, count);
+    printf("%-18s %12s %12.1f\n", "  decode", "", decodeNs / count);
+  }
+
+  printf("round trip within quantization: %s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include "config_params.h"
+#include "config_store.h"
+#include "control.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+// Feeds /parameters stream events through configApplyEvent(), standing in
+// for the RTDB stream on the board, and checks what they change. Then
+// round-trips the NVS blob.
+
+// What the control loop would see on its next tick
+static const RuntimeConfig &live() { return configAcquire(); }
+
+static void setDraft(float RuntimeConfig::*field, float value) {
+  configDraft().*field = value;
+  configPublish();
+}
+
+int runConfigCheck() {
+  printf("config stream events:\n");
+
+  // Initial "put" of the whole document, including keys we do not know
+  ConfigEventResult r = configApplyEvent(
+      "/",
+      "{\"TILT_SIDE_THRESHOLD\": 25, \"DIST_THRESHOLD\":150.5,"
+      "\"EMA_ALPHA_LIDAR\":0.3,\"LIGHT_ADJUSTMENT\":-12,"
+      "\"note\":\"set by dashboard\",\"nested\":{\"a\":[1,2]}}");
+  simCheck(r.applied == 4 && r.rejected == 2,
+           "whole document applies known keys");
+  simCheck(live().tiltSideThreshold == 25.0f &&
+               live().distThreshold == 150.5f && live().lidarAlpha == 0.3f &&
+               live().lightAdjustment == -12.0f,
+           "values land in their targets");
+  simCheck(r.persistChanged, "threshold change requests a save");
+
+  r = configApplyEvent("/TILT_FB_THRESHOLD", "12");
+  simCheck(r.applied == 1 && live().tiltFBThreshold == 12.0f,
+           "single key event");
+
+  r = configApplyEvent("/TILT_FB_THRESHOLD", "12");
+  simCheck(r.applied == 0 && r.unchanged == 1 && !r.persistChanged,
+           "same value is not a change");
+
+  r = configApplyEvent("/LIGHT_ADJUSTMENT", "3");
+  simCheck(r.applied == 1 && r.persistChanged, "adjustment is persisted too");
+
+  r = configApplyEvent("/EMA_ALPHA_MPU", "1.5");
+  simCheck(r.rejected == 1 && live().mpuAlpha != 1.5f,
+           "out-of-range value rejected");
+
+  r = configApplyEvent("/DIST_THRESHOLD", "\"far\"");
+  simCheck(r.rejected == 1 && live().distThreshold == 150.5f,
+           "non-number rejected");
+
+  r = configApplyEvent("/DIST_THRESHOLD", "null");
+  simCheck(r.applied + r.rejected == 0 && live().distThreshold == 150.5f,
+           "deleted key keeps its value");
+
+  r = configApplyEvent("/", "{\"LIGHT_THRESHOLD\":800}");
+  simCheck(r.applied == 1 && live().lightThreshold == 800.0f &&
+               live().tiltSideThreshold == 25.0f,
+           "patch at the root leaves other keys alone");
+
+  r = configApplyEvent("/", "{\"LIGHT_THRESHOLD\":900,");
+  simCheck(r.applied == 1, "truncated document applies what parsed");
+
+  // A snapshot taken before an event is not touched by it
+  const RuntimeConfig &before = configAcquire();
+  configApplyEvent("/", "{\"TILT_FB_THRESHOLD\":20,\"DIST_THRESHOLD\":90}");
+  simCheck(before.tiltFBThreshold == 12.0f && before.distThreshold == 150.5f,
+           "held snapshot keeps the old values");
+  simCheck(live().tiltFBThreshold == 20.0f && live().distThreshold == 90.0f,
+           "next acquire sees the whole event");
+  configDraft().lightThreshold = 1.0f;
+  simCheck(live().lightThreshold == 900.0f,
+           "draft is invisible until published");
+  setDraft(&RuntimeConfig::lightThreshold, 900.0f);
+
+  // The filters follow alpha changes from the next tick on
+  sensorFilters.updateChannel(CHANNEL_LIDAR, 0.0f);
+  configApplyEvent("/EMA_ALPHA_LIDAR", "1");
+  RawSample raw = {};
+  raw.lidar[0].distance = 42.0f;
+  raw.lidarCount = 1;
+  SensorData out;
+  controlFilter(raw, live(), out);
+  simCheck(sensorFilters.getValue(CHANNEL_LIDAR) == 42.0f,
+           "alpha change reaches the filter");
+
+  printf("NVS blob:\n");
+  uint8_t blob[CONFIG_BLOB_MAX_BYTES], again[CONFIG_BLOB_MAX_BYTES];
+  size_t length = configSerialize(blob, sizeof(blob));
+  simCheck(length > 0 && configSerialize(again, sizeof(again)) == length &&
+               memcmp(blob, again, length) == 0,
+           "same settings give the same bytes");
+
+  RuntimeConfig saved = live();
+  setDraft(&RuntimeConfig::tiltSideThreshold, 1.0f);
+  setDraft(&RuntimeConfig::lightAdjustment, 0.0f);
+  setDraft(&RuntimeConfig::lidarAlpha, 0.5f);
+  simCheck(configDeserialize(blob, length) &&
+               live().tiltSideThreshold == saved.tiltSideThreshold &&
+               live().lightAdjustment == saved.lightAdjustment &&
+               live().lidarAlpha == saved.lidarAlpha,
+           "load restores thresholds, adjustments, alphas");
+  memcpy(again, blob, length);
+  again[length - 1] ^= 0x01;
+  setDraft(&RuntimeConfig::tiltSideThreshold, 1.0f);
+  simCheck(!configDeserialize(again, length) &&
+               live().tiltSideThreshold == 1.0f,
+           "CRC mismatch rejected, nothing applied");
+  memcpy(again, blob, length);
+  again[4]++; // version
+  simCheck(!configDeserialize(again, length), "other version rejected");
+  simCheck(!configDeserialize(blob, length - 1), "truncated blob rejected");
+
+  // Out-of-range values in an otherwise valid blob are skipped
+  setDraft(&RuntimeConfig::tiltSideThreshold, 500.0f);
+  length = configSerialize(again, sizeof(again));
+  setDraft(&RuntimeConfig::tiltSideThreshold, saved.tiltSideThreshold);
+  simCheck(configDeserialize(again, length) &&
+               live().tiltSideThreshold == saved.tiltSideThreshold,
+           "out-of-range stored value ignored");
+  printf("  %zu bytes for %zu tunables\n", configSerialize(blob, sizeof(blob)),
+         CONFIG_PARAM_COUNT);
+
+  printf("%s\n", simAllOk() ? "PASS" : "FAIL");
+  return simAllOk() ? 0 : 1;
+}
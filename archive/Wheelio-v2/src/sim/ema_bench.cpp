@@ -0,0 +1,36 @@
+#include "ema_benchmark.h"
+#include "sim.h"
+#include <chrono>
+#include <stdio.h>
+
+// Host side of emaBenchmark(): times each filter variant in ns and checks
+// that every variant tracks a double-precision EMA.
+
+static uint32_t nowNs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Worst tolerated deviation per variant, in full-scale units: float
+// rounding, then a few Q15 / Q31 steps of rounding dead band
+static const float MAX_ERROR[EMA_BENCH_VARIANTS] = {
+    1e-5f, 1e-5f, 2e-4f, 1e-6f, 2e-4f, 1e-6f, 1e-5f, 1e-5f};
+
+int runEmaBenchmark(uint32_t samples) {
+  EmaBenchResult results[EMA_BENCH_VARIANTS];
+  size_t n = emaBenchmark(nowNs, samples, results, EMA_BENCH_VARIANTS);
+
+  printf("EMA filters, %u samples each\n", samples);
+  printf("%-42s %10s %10s\n", "variant", "ns/sample", "max error");
+  bool ok = n == EMA_BENCH_VARIANTS;
+  for (size_t i = 0; i < n; i++) {
+    bool within = results[i].maxError <= MAX_ERROR[i];
+    printf("%-42s %10.2f %10.2g%s\n", results[i].name,
+           results[i].countsPerSample, results[i].maxError,
+           within ? "" : "  too far from reference");
+    ok = ok && within;
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include "flash_storage.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+// NOR flash emulated in a file: erase fills a sector with 0xFF and writes
+// AND into what is already there, so a write can only clear bits.
+class FileFlash : public FlashStorage {
+private:
+  FILE *file;
+  size_t bytes;
+  size_t sector;
+
+  bool inRange(size_t offset, size_t length) const {
+    return offset <= bytes && length <= bytes - offset;
+  }
+
+public:
+  FileFlash(FILE *file, size_t bytes, size_t sector)
+      : file(file), bytes(bytes), sector(sector) {}
+  ~FileFlash() override { fclose(file); }
+
+  size_t size() const override { return bytes; }
+  size_t sectorSize() const override { return sector; }
+
+  bool read(size_t offset, void *data, size_t length) override {
+    return inRange(offset, length) &&
+           fseek(file, (long)offset, SEEK_SET) == 0 &&
+           fread(data, 1, length, file) == length;
+  }
+
+  bool write(size_t offset, const void *data, size_t length) override {
+    uint8_t current[256];
+    const uint8_t *src = (const uint8_t *)data;
+    if (!inRange(offset, length))
+      return false;
+    while (length > 0) {
+      size_t chunk = length < sizeof(current) ? length : sizeof(current);
+      if (!read(offset, current, chunk))
+        return false;
+      for (size_t i = 0; i < chunk; i++)
+        current[i] &= src[i];
+      if (fseek(file, (long)offset, SEEK_SET) != 0 ||
+          fwrite(current, 1, chunk, file) != chunk)
+        return false;
+      offset += chunk;
+      src += chunk;
+      length -= chunk;
+    }
+    return fflush(file) == 0;
+  }
+
+  bool eraseSector(size_t offset) override {
+    uint8_t erased[256];
+    memset(erased, 0xFF, sizeof(erased));
+    if (offset % sector != 0 || !inRange(offset, sector) ||
+        fseek(file, (long)offset, SEEK_SET) != 0)
+      return false;
+    for (size_t done = 0; done < sector; done += sizeof(erased)) {
+      size_t chunk = sector - done < sizeof(erased) ? sector - done
+                                                    : sizeof(erased);
+      if (fwrite(erased, 1, chunk, file) != chunk)
+        return false;
+    }
+    return fflush(file) == 0;
+  }
+};
+
+FlashStorage *simFileFlash(const char *path, size_t size, size_t sectorSize) {
+  FILE *file = path ? fopen(path, "r+b") : tmpfile();
+  if (file == NULL && path != NULL)
+    file = fopen(path, "w+b");
+  if (file == NULL || sectorSize == 0 || size % sectorSize != 0)
+    return NULL;
+
+  // A new (or short) file starts out erased
+  fseek(file, 0, SEEK_END);
+  long have = ftell(file);
+  for (long i = have < 0 ? 0 : have; i < (long)size; i++)
+    fputc(0xFF, file);
+  fflush(file);
+  return new FileFlash(file, size, sectorSize);
+}
@@ -0,0 +1,143 @@
+#include "flash_storage.h"
+#include "sim.h"
+#include "telemetry_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Exercises TelemetryLog against the file-backed flash emulator: recovery
+// after a power cycle, CRC rejection of a damaged record, wrap-around once
+// the ring is full, and erase-count levelling across segments.
+
+static TelemetrySample makeSample(uint32_t seq) {
+  TelemetrySample sample = {};
+  sample.timestampUs = 1000000ULL + seq;
+  sample.epochMs = 1704067200000ULL + seq;
+  sample.data.lumensRaw = (float)seq;
+  sample.data.distanceRaw = (float)seq * 0.5f;
+  sample.actuators.buzzer = seq & 1;
+  return sample;
+}
+
+static uint32_t seqOf(const TelemetrySample &sample) {
+  return (uint32_t)(sample.timestampUs - 1000000ULL);
+}
+
+// Clear a few bits in the payload holding sample `seq`, as a torn or worn
+// write would
+static bool damageSample(FlashStorage *flash, uint32_t seq) {
+  std::vector<uint8_t> image(flash->size());
+  if (!flash->read(0, image.data(), image.size()))
+    return false;
+  uint64_t needle = makeSample(seq).timestampUs;
+  for (size_t i = 0; i + sizeof(needle) <= image.size(); i++) {
+    if (memcmp(&image[i], &needle, sizeof(needle)) == 0) {
+      static const uint8_t zero = 0;
+      return flash->write(i + sizeof(needle), &zero, 1);
+    }
+  }
+  return false;
+}
+
+static void checkRecovery(const char *path) {
+  printf("recovery after power cycle:\n");
+  remove(path);
+  FlashStorage *flash = simFileFlash(path, 16 * 4096, 4096);
+  TelemetryLog log;
+  simCheck(flash != NULL && log.begin(flash), "format empty flash");
+  for (uint32_t i = 0; i < 200; i++)
+    log.append(makeSample(i));
+  TelemetrySample out[64];
+  size_t n = log.peek(out, 40);
+  simCheck(n == 40 && seqOf(out[0]) == 0 && seqOf(out[39]) == 39,
+           "peek returns oldest first");
+  log.consume(40);
+  delete flash;
+
+  flash = simFileFlash(path, 16 * 4096, 4096);
+  TelemetryLog reopened;
+  simCheck(reopened.begin(flash), "reopen");
+  simCheck(reopened.pending() == 160, "sent records stay sent");
+  n = reopened.peek(out, 64);
+  simCheck(n == 64 && seqOf(out[0]) == 40 && seqOf(out[63]) == 103,
+           "replay resumes at first unsent");
+  TelemetrySample expected = makeSample(40);
+  simCheck(memcmp(&out[0], &expected, sizeof(expected)) == 0,
+           "payload survives byte for byte");
+
+  reopened.append(makeSample(200));
+  simCheck(reopened.pending() == 161, "append after reopen");
+
+  simCheck(damageSample(flash, 50), "damage record 50 on flash");
+  delete flash;
+  flash = simFileFlash(path, 16 * 4096, 4096);
+  TelemetryLog damaged;
+  damaged.begin(flash);
+  simCheck(damaged.stats().corrupt == 1 && damaged.pending() == 160,
+           "CRC mismatch is skipped and counted");
+  bool seen = false;
+  uint32_t last = 39;
+  bool ordered = true;
+  while ((n = damaged.peek(out, 64)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      seen = seen || seqOf(out[i]) == 50;
+      ordered = ordered && seqOf(out[i]) > last;
+      last = seqOf(out[i]);
+    }
+    damaged.consume(n);
+  }
+  simCheck(!seen && ordered && last == 200,
+           "drain skips it and stays in order");
+  simCheck(damaged.pending() == 0, "fully drained");
+  delete flash;
+  remove(path);
+}
+
+static void checkWrap() {
+  printf("wrap-around on a full ring:\n");
+  const size_t segments = 6, sector = 512;
+  FlashStorage *flash = simFileFlash(NULL, segments * sector, sector);
+  TelemetryLog log;
+  log.begin(flash);
+  size_t capacity = log.capacity();
+  uint32_t total = (uint32_t)capacity * 20;
+  for (uint32_t i = 0; i < total; i++)
+    log.append(makeSample(i));
+  TelemetryLogStats stats = log.stats();
+  simCheck(log.pending() >= capacity && log.pending() < total,
+           "newest capacity() samples survive");
+  simCheck(stats.lost + log.pending() == total, "every sample sent or lost");
+
+  std::vector<TelemetrySample> out(log.pending());
+  size_t n = log.peek(out.data(), out.size());
+  bool ordered = n == out.size();
+  for (size_t i = 1; i < n; i++)
+    ordered = ordered && seqOf(out[i]) == seqOf(out[i - 1]) + 1;
+  simCheck(ordered && seqOf(out[n - 1]) == total - 1,
+           "survivors are the newest, contiguous");
+
+  // Alternate filling and draining, so segments cycle with data pending
+  for (uint32_t round = 0; round < 50; round++) {
+    for (uint32_t i = 0; i < capacity / 3; i++)
+      log.append(makeSample(total++));
+    n = log.peek(out.data(), capacity / 4);
+    log.consume(n);
+  }
+  stats = log.stats();
+  uint32_t fairShare = (stats.erases + segments - 1) / segments;
+  printf("  %u erases over %zu segments, max %u per segment\n", stats.erases,
+         segments, stats.maxEraseCount);
+  simCheck(stats.maxEraseCount <= fairShare + 1, "erases spread evenly");
+
+  TelemetryLog reopened;
+  reopened.begin(flash);
+  simCheck(reopened.pending() == log.pending(), "reopen after wrap");
+  delete flash;
+}
+
+int runFlashLogCheck(const char *path) {
+  checkRecovery(path);
+  checkWrap();
+  printf("%s\n", simAllOk() ? "PASS" : "FAIL");
+  return simAllOk() ? 0 : 1;
+}
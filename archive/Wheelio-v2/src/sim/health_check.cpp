@@ -0,0 +1,119 @@
+#include "actuators.h"
+#include "control.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "sensor_health.h"
+#include "sim.h"
+#include "telemetry.h"
+#include "telemetry_json.h"
+#include "timebase.h"
+#include "warning_rules.h"
+#include <stdio.h>
+
+// Takes each simulated I2C sensor away in the middle of a ride and checks
+// that the control loop degrades instead of stopping: the sensor goes stale
+// and then failed within its deadlines, its warning rules drop out while
+// the other sensor's keep working, re-initializations are attempted with
+// backoff, and the sensor is back in service once it answers one.
+
+// What the ticks of one stretch of the ride did
+struct HealthRun {
+  uint32_t ticks;
+  uint8_t rules;          // every RuleBit that was on
+  uint8_t rulesOutFailed; // failed sensors' RuleBits that were on anyway
+  uint64_t failedAtUs;    // first tick the faulted sensor was FAILED, or 0
+  uint64_t okAtUs;        // first tick it was OK again, or 0
+};
+
+static HealthRun runUntil(uint64_t endUs, SensorId watched,
+                          SensorData &data) {
+  HealthRun run = {};
+  while (timebaseMicros() < endUs) {
+    simAdvanceMicros(controlPeriodMs() * 1000ULL);
+    ActuatorState state = controlTick(data);
+    run.ticks++;
+    run.rules |= state.rules;
+    run.rulesOutFailed |= state.rules & ~sensorHealthUsableRules();
+    HealthState health = sensorHealthState(watched);
+    if (health == HEALTH_FAILED && run.failedAtUs == 0)
+      run.failedAtUs = timebaseMicros();
+    if (health == HEALTH_OK && run.okAtUs == 0)
+      run.okAtUs = timebaseMicros();
+  }
+  return run;
+}
+
+static uint64_t seconds(uint32_t s) { return s * 1000000ULL; }
+
+int runHealthCheck() {
+  simSeed(1);
+  lightSensorInit();
+  mpu6050Init();
+  lidarInit();
+  actuatorsInit();
+  SensorData data = {};
+
+  printf("healthy ride:\n");
+  HealthRun run = runUntil(seconds(50), SENSOR_LIDAR, data);
+  simCheck(sensorHealthPacked() == 0, "both sensors ok");
+  simCheck(sensorHealthStats(SENSOR_LIDAR).failures == 0 &&
+               sensorHealthStats(SENSOR_IMU).failures == 0,
+           "no failures");
+
+  // The hard lean at 57..60 s must still warn without the lidar
+  printf("lidar stops answering at 50 s:\n");
+  simSensorFault(SENSOR_LIDAR, true);
+  run = runUntil(seconds(62), SENSOR_LIDAR, data);
+  SensorHealthStats lidar = sensorHealthStats(SENSOR_LIDAR);
+  uint64_t failAfterUs =
+      (SENSOR_LIDAR_DEADLINE_MS + SENSOR_FAIL_AFTER_MS) * 1000ULL;
+  simCheck(run.failedAtUs != 0 &&
+               run.failedAtUs - seconds(50) <= failAfterUs + seconds(1),
+           "lidar failed within deadline + fail time + one tick");
+  simCheck(lidar.misses == 1 && lidar.failures == 1, "one miss, one failure");
+  simCheck(lidar.reinits >= 3, "re-initializations attempted with backoff");
+  simCheck(sensorHealthState(SENSOR_IMU) == HEALTH_OK, "imu still ok");
+  simCheck(run.rulesOutFailed == 0, "no lidar rule on once it failed");
+  simCheck(run.rules & MPU_RULES, "imu warnings still raised");
+
+  char body[TELEMETRY_JSON_BUFFER_BYTES];
+  TelemetrySample sample = {};
+  sample.health = sensorHealthPacked();
+  size_t length = telemetryToJson(&sample, 1, body, sizeof(body));
+  simCheck(length > 0 && length <= TELEMETRY_JSON_ENTRY_BYTES + 2,
+           "failed state fits the telemetry entry bound");
+
+  printf("lidar repaired at 62 s:\n");
+  simSensorFault(SENSOR_LIDAR, false);
+  run = runUntil(seconds(62 + SENSOR_RETRY_MAX_MS / 1000), SENSOR_LIDAR,
+                 data);
+  lidar = sensorHealthStats(SENSOR_LIDAR);
+  simCheck(sensorHealthState(SENSOR_LIDAR) == HEALTH_OK,
+           "back in service after a re-initialization");
+  simCheck(lidar.recoveries == 1, "one recovery counted");
+  printf("  back at %.1f s after %u re-initializations\n",
+         run.okAtUs / 1e6, lidar.reinits);
+
+  uint64_t imuFaultUs = timebaseMicros();
+  printf("imu stops answering for 3 s:\n");
+  simSensorFault(SENSOR_IMU, true);
+  run = runUntil(imuFaultUs + seconds(3), SENSOR_IMU, data);
+  simCheck(sensorHealthState(SENSOR_IMU) == HEALTH_FAILED, "imu failed");
+  simCheck(!(sensorHealthUsableRules() & MPU_RULES) &&
+               (sensorHealthUsableRules() & LIDAR_RULES),
+           "imu rules out, lidar rules kept");
+  simCheck(run.rulesOutFailed == 0, "no imu rule on once it failed");
+  simSensorFault(SENSOR_IMU, false);
+  runUntil(timebaseMicros() + seconds(SENSOR_RETRY_MAX_MS / 1000),
+           SENSOR_IMU, data);
+  simCheck(sensorHealthPacked() == 0, "both sensors ok again");
+
+  char health[HEALTH_JSON_BYTES];
+  length = healthToJson(0, health, sizeof(health));
+  simCheck(length > 0, "health counters fit their report");
+  printf("  %s\n", health);
+
+  printf("%s\n", simAllOk() ? "PASS" : "FAIL");
+  return simAllOk() ? 0 : 1;
+}
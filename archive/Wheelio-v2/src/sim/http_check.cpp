@@ -0,0 +1,96 @@
+#include "http_response.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+// Feeds canned RTDB replies through the response-head parser the way
+// rtdb_client.cpp reads them off the socket, and checks how much body it
+// reads and whether it would keep the connection. A write that closes the
+// connection costs the next one a TLS handshake and its heap allocations,
+// which the native allocation counter cannot see.
+
+struct Reply {
+  int status;
+  long body; // bytes read after the head, -1 until the connection closes
+  bool reused;
+};
+
+// Splits `raw` into CRLF lines like readLine(), reads the head (skipping
+// interim 1xx replies) and then the body it announces
+static Reply parse(const char *raw) {
+  Reply reply = {0, 0, false};
+  const char *p = raw;
+  char line[128];
+  HttpResponseHead head;
+  do {
+    httpResponseBegin(head);
+    bool more = true;
+    while (more && *p) {
+      size_t n = strcspn(p, "\n");
+      size_t copy = n < sizeof(line) - 1 ? n : sizeof(line) - 1;
+      memcpy(line, p, copy);
+      if (copy > 0 && line[copy - 1] == '\r')
+        copy--;
+      line[copy] = '\0';
+      p += p[n] ? n + 1 : n;
+      more = httpResponseLine(head, line);
+    }
+    if (head.status == 0 || more)
+      return reply;
+  } while (head.status / 100 == 1);
+
+  long available = (long)strlen(p);
+  long unread = head.bodyLength;
+  if (unread > 0) {
+    long got = unread < available ? unread : available;
+    reply.body = got;
+    unread -= got;
+  } else if (unread < 0) {
+    reply.body = -1;
+  }
+  reply.status = head.status;
+  reply.reused = httpResponseReusable(head, unread);
+  return reply;
+}
+
+int runHttpCheck() {
+  printf("RTDB replies:\n");
+  Reply r = parse("HTTP/1.1 204 No Content\r\n"
+                  "Connection: keep-alive\r\n"
+                  "Access-Control-Allow-Origin: *\r\n\r\n");
+  simCheck(r.status == 204 && r.body == 0 && r.reused,
+           "print=silent 204 without Content-Length keeps it");
+  r = parse("HTTP/1.1 204 No Content\r\nContent-Length: 12\r\n\r\n");
+  simCheck(r.body == 0 && r.reused, "204 has no body whatever it announces");
+  r = parse("HTTP/1.1 304 Not Modified\r\nETag: \"x\"\r\n\r\n");
+  simCheck(r.status == 304 && r.body == 0 && r.reused, "304 keeps it");
+  r = parse("HTTP/1.1 100 Continue\r\n\r\n"
+            "HTTP/1.1 204 No Content\r\n\r\n");
+  simCheck(r.status == 204 && r.reused, "interim 100 skipped");
+  r = parse("HTTP/1.1 200 OK\r\ncontent-length:  2\r\n\r\n{}");
+  simCheck(r.status == 200 && r.body == 2 && r.reused,
+           "body read to its length, any header case");
+  r = parse("HTTP/1.1 401 Unauthorized\r\nContent-Length: 60\r\n\r\n"
+            "{\"error\" : \"Auth token is expired\"}");
+  simCheck(r.status == 401 && !r.reused, "body cut short closes it");
+
+  printf("replies that close:\n");
+  r = parse("HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n");
+  simCheck(r.status == 204 && !r.reused, "Connection: close");
+  r = parse("HTTP/1.1 200 OK\r\n\r\n{}");
+  simCheck(r.status == 200 && r.body == -1 && !r.reused,
+           "200 without a length reads until close");
+  r = parse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\n{}");
+  simCheck(r.body == -1 && !r.reused, "chunked body reads until close");
+  r = parse("HTTP/1.1 200 OK\r\nContent-Length: 2x\r\n\r\n{}");
+  simCheck(r.status == 200 && !r.reused, "bad length");
+  r = parse("HTTP/1.0 204 No Content\r\n\r\n");
+  simCheck(r.status == 204 && !r.reused, "HTTP/1.0 without keep-alive");
+  r = parse("HTTP/1.1 204 No Content\r\n");
+  simCheck(r.status == 0, "head cut short is no reply");
+  r = parse("<html>502 Bad Gateway</html>\r\n");
+  simCheck(r.status == 0, "not HTTP is no reply");
+
+  printf("%s\n", simAllOk() ? "PASS" : "FAIL");
+  return simAllOk() ? 0 : 1;
+}
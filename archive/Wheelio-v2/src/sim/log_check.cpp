@@ -0,0 +1,89 @@
+#include "crc32.h"
+#include "debug_log.h"
+#include "sim.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// Logs from several threads at once, as the control, uploader and config
+// tasks do, while one thread drains the ring the way logTask does. Every
+// frame must carry a good CRC, each producer's records must arrive in
+// order, and the records seen plus the reported drops must add up to what
+// was logged. The frames go to `path` for scripts/log_decode.py.
+
+static const uint32_t PRODUCERS = 4;
+static std::atomic<uint32_t> producersDone(0);
+
+static void producer(uint32_t id, uint32_t records) {
+  for (uint32_t i = 0; i < records; i++) {
+    LOG(MSG_LOG_CHECK, id, i, i * 0.5f, "from a producer thread");
+    std::this_thread::yield(); // tasks log between other work
+  }
+  producersDone.fetch_add(1, std::memory_order_release);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int runLogCheck(const char *path, uint32_t records) {
+  FILE *out = fopen(path, "wb");
+  if (out == NULL) {
+    printf("cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<std::thread> threads;
+  for (uint32_t id = 0; id < PRODUCERS; id++)
+    threads.emplace_back(producer, id, records);
+
+  uint32_t seen = 0, drops = 0, badFrames = 0, outOfOrder = 0;
+  int64_t last[PRODUCERS];
+  for (uint32_t id = 0; id < PRODUCERS; id++)
+    last[id] = -1;
+  static uint8_t buffer[1024];
+  for (;;) {
+    bool done = producersDone.load(std::memory_order_acquire) == PRODUCERS;
+    size_t length = logDrain(buffer, sizeof(buffer));
+    fwrite(buffer, 1, length, out);
+    for (size_t at = 0; at < length;) {
+      const uint8_t *frame = buffer + at;
+      size_t size = LOG_FRAME_BYTES(frame[3]);
+      if (frame[0] != LOG_FRAME_MAGIC || at + size > length ||
+          (uint8_t)crc32(frame + 1, size - 2) != frame[size - 1]) {
+        badFrames++;
+        break;
+      }
+      uint16_t message = frame[1] | frame[2] << 8;
+      if (message == MSG_LOG_DROPPED) {
+        drops += get32(frame + 8);
+      } else if (message == MSG_LOG_CHECK) {
+        uint32_t id = get32(frame + 8), index = get32(frame + 12);
+        if (id >= PRODUCERS || (int64_t)index <= last[id])
+          outOfOrder++;
+        else
+          last[id] = index;
+        seen++;
+      }
+      at += size;
+    }
+    if (done && length == 0 && logDropped() == drops)
+      break;
+    if (length == 0)
+      std::this_thread::yield();
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  fclose(out);
+
+  uint32_t total = PRODUCERS * records;
+  printf("log check: %u threads x %u records, %u drained, %u dropped "
+         "(ring of %u)\n",
+         PRODUCERS, records, seen, drops, LOG_BUFFER_RECORDS);
+  printf("bad frames: %u, out-of-order records: %u\n", badFrames, outOfOrder);
+  printf("frames written to %s\n", path);
+  bool ok = badFrames == 0 && outOfOrder == 0 && seen + drops == total;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
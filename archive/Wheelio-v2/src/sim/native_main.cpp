@@ -0,0 +1,232 @@
+// Native (host) runner for the Wheelio control loop.
+//
+// Runs the same sensor -> FilterBank -> threshold -> actuator -> upload path
+// as the board, against the simulated backends and a virtual clock, and
+// prints the latency.h histograms: host cost of each stage and the age of
+// the (virtual-time) sensor data at the actuator write.
+//
+//   pio run -e native
+//   .pio/build/native/program [periods] [seed] [fixed]
+//                                                   control loop profile over
+//                                                   periods x 100 ms; fixed
+//                                                   pins the rate at 100 ms
+//   .pio/build/native/program stress [iterations]   Snapshot two-thread test
+//   .pio/build/native/program flashlog [file]       offline log checks
+//   .pio/build/native/program codec [samples]       packed vs JSON telemetry
+//   .pio/build/native/program config                parameter stream events
+//   .pio/build/native/program ema [samples]         EMA filter variant cost
+//   .pio/build/native/program attitude [seconds]    fused vs accel-only tilt
+//   .pio/build/native/program log [file] [records]  multi-task logging check
+//   .pio/build/native/program portal [seconds]      control ticks, portal open
+//   .pio/build/native/program health                sensor failure and recovery
+//   .pio/build/native/program http                  RTDB reply parsing
+//   .pio/build/native/program trace [file] [periods]
+//                                                   record a ride, replay it
+//                                                   bit-identically
+//   .pio/build/native/program replay <file> [timeline]
+//                                                   replay a recorded trace
+
+#include "actuators.h"
+#include "alloc_counter.h"
+#include "config.h"
+#include "control.h"
+#include "latency.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "runtime_config.h"
+#include "sensor_health.h"
+#include "sim.h"
+#include "telemetry.h"
+#include "telemetry_uplink.h"
+#include "timebase.h"
+#include "uploader.h"
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static const uint64_t TICK_US = CONTROL_PERIOD_MS * 1000ULL;
+
+// The control stages are timed by latency.h; the uploader's side here
+struct UploadStats {
+  uint64_t totalNs;
+  uint64_t maxNs;
+  uint32_t count;
+};
+
+static UploadStats uploadStats;
+
+static void recordUpload(SteadyClock::time_point start) {
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    SteadyClock::now() - start)
+                    .count();
+  uploadStats.totalNs += ns;
+  if (ns > uploadStats.maxNs)
+    uploadStats.maxNs = ns;
+  uploadStats.count++;
+}
+
+// Simulated dead zones: the uplink drops for OUTAGE_US out of every
+// OUTAGE_CYCLE_US, so the offline log fills and then drains
+static const uint64_t OUTAGE_CYCLE_US = 600000000ULL; // 10 min
+static const uint64_t OUTAGE_US = 180000000ULL;       // 3 min
+
+// A count (or seed) from the command line. Anything but a whole number of
+// at least `least` ends the run: a count of 0 makes the benchmarks divide
+// by zero.
+static uint32_t argOr(int argc, char **argv, int index, uint32_t fallback,
+                      uint32_t least = 1) {
+  if (argc <= index)
+    return fallback;
+  const char *arg = argv[index];
+  char *end;
+  errno = 0;
+  unsigned long value = strtoul(arg, &end, 10);
+  if (end == arg || *end != '\0' || arg[0] == '-' || errno == ERANGE ||
+      value > UINT32_MAX || value < least) {
+    fprintf(stderr, "%s: expected a number >= %u, got \"%s\"\n", argv[0],
+            least, arg);
+    exit(2);
+  }
+  return (uint32_t)value;
+}
+
+static int runControlLoop(uint32_t periods, uint32_t seed, bool fixedRate) {
+  simSeed(seed);
+  if (fixedRate) {
+    configDraft().fastPeriodMs = CONTROL_PERIOD_MS;
+    configDraft().idlePeriodMs = CONTROL_PERIOD_MS;
+    configPublish();
+  }
+  lightSensorInit();
+  mpu6050Init();
+  lidarInit();
+  actuatorsInit();
+  uploaderInit();
+  FlashStorage *flash = simFileFlash(NULL, 64 * 4096, 4096);
+  uplinkInit(flash);
+
+  SensorData data = {};
+  uint32_t uploadAllocs = 0;
+  uint32_t ticks = 0, idleTicks = 0, queued = 0;
+  uint64_t endUs = timebaseMicros() + periods * TICK_US;
+  SteadyClock::time_point runStart = SteadyClock::now();
+  while (timebaseMicros() < endUs) {
+    simAdvanceMicros(controlPeriodMs() * 1000ULL);
+    simSetOnline(timebaseMicros() % OUTAGE_CYCLE_US <
+                 OUTAGE_CYCLE_US - OUTAGE_US);
+    ticks++;
+
+    TelemetrySample sample = {};
+    sample.timestampUs = timebaseMicros();
+    sample.epochMs = timebaseEpochMs();
+    sample.actuators = controlTick(data);
+    sample.data = data;
+    sample.health = sensorHealthPacked();
+#if TELEMETRY_LATENCY
+    sample.latencyUs = latencySensorAgeUs();
+#endif
+    const RuntimeConfig &cfg = configAcquire();
+    if (cfg.idlePeriodMs > cfg.fastPeriodMs &&
+        controlPeriodMs() >= cfg.idlePeriodMs)
+      idleTicks++;
+    if (telemetryDue(sample)) {
+      queued++;
+      if (!telemetryBuffer.push(sample))
+        latencyCountDrop(DROP_TELEMETRY_FULL);
+    }
+
+    // firebaseTask's side, run inline once per tick
+    SteadyClock::time_point t = SteadyClock::now();
+    uint32_t allocsBefore = allocCount();
+    uplinkPoll(telemetryBuffer, false, timebaseMicros());
+    uploadAllocs += allocCount() - allocsBefore;
+    recordUpload(t);
+  }
+  double wallS = std::chrono::duration<double>(SteadyClock::now() - runStart)
+                     .count();
+
+  printf("Wheelio native run: %u ticks (%.1f s simulated) in %.3f s wall, "
+         "%.0f ticks/s\n",
+         ticks, periods * (TICK_US / 1e6), wallS,
+         wallS > 0 ? ticks / wallS : 0.0);
+  printf("%s rate: mean period %.1f ms, %.1f%% of ticks idle, %u samples "
+         "queued\n",
+         fixedRate ? "fixed" : "adaptive", periods * (TICK_US / 1e3) / ticks,
+         100.0 * idleTicks / ticks, queued);
+  printf("%-10s %9s %11s %11s %11s %11s\n", "stage", "calls", "mean ns",
+         "p50 ns", "p99 ns", "max ns");
+  for (int m = 0; m < LATENCY_METRICS; m++) {
+    const LatencyHistogram &h = latencyHistogram((LatencyMetric)m);
+    printf("%-10s %9u %11.0f %11u %11u %11u\n",
+           latencyMetricName((LatencyMetric)m), h.count,
+           h.count ? (double)h.totalNs / h.count : 0.0,
+           latencyPercentileNs(h, 0.5f), latencyPercentileNs(h, 0.99f),
+           h.maxNs);
+  }
+  printf("%-10s %9u %11.0f %11s %11s %11llu\n", "upload", uploadStats.count,
+         uploadStats.count ? (double)uploadStats.totalNs / uploadStats.count
+                           : 0.0,
+         "", "", (unsigned long long)uploadStats.maxNs);
+  printf("dropped: %u %s, %u %s\n", latencyDrops(DROP_LIDAR_NONE),
+         latencyDropName(DROP_LIDAR_NONE), latencyDrops(DROP_TELEMETRY_FULL),
+         latencyDropName(DROP_TELEMETRY_FULL));
+  const SimActuatorLog &act = simActuators();
+  printf("actuators: fog %u toggles, warning %u toggles, buzzer %u toggles\n",
+         act.fogToggles, act.warningToggles, act.buzzerToggles);
+  MpuFifoStats imu = mpu6050FifoStats();
+  printf("imu: %u frames at %u Hz, %u dropped, %u overflows\n", imu.frames,
+         mpu6050SampleRate(), imu.dropped, imu.overflows);
+  LidarStats lidar = lidarStats();
+  printf("lidar: %u ranges, %u rejected\n", lidar.samples, lidar.invalid);
+  const SimUploadLog &up = simUploads();
+  printf("uploads: %u requests, %u samples, %zu bytes (%.1f bytes/sample), "
+         "%u health reports\n",
+         up.uploads, up.samples, up.bytes,
+         up.samples ? (double)up.bytes / up.samples : 0.0, up.healthReports);
+  printf("upload path heap allocations: %u\n", uploadAllocs);
+  UplinkStats uplink = uplinkStats();
+  TelemetryLogStats tlog = uplinkLogStats();
+  printf("uplink: %u live, %u logged offline, %u replayed, %u dropped; "
+         "backlog %zu, %u lost, %u erases\n",
+         uplink.sent, uplink.logged, uplink.replayed, uplink.dropped,
+         uplinkBacklog(), tlog.lost, tlog.erases);
+  delete flash;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "stress") == 0)
+    return runSnapshotStress(argOr(argc, argv, 2, 5000000));
+  if (argc > 1 && strcmp(argv[1], "config") == 0)
+    return runConfigCheck();
+  if (argc > 1 && strcmp(argv[1], "ema") == 0)
+    return runEmaBenchmark(argOr(argc, argv, 2, 10000000));
+  if (argc > 1 && strcmp(argv[1], "attitude") == 0)
+    return runAttitudeBenchmark(argOr(argc, argv, 2, 60));
+  if (argc > 1 && strcmp(argv[1], "codec") == 0)
+    return runCodecBenchmark(argOr(argc, argv, 2, 100000));
+  if (argc > 1 && strcmp(argv[1], "flashlog") == 0)
+    return runFlashLogCheck(argc > 2 ? argv[2] : "wheelio_tlog.bin");
+  if (argc > 1 && strcmp(argv[1], "log") == 0)
+    return runLogCheck(argc > 2 ? argv[2] : "wheelio_log.bin",
+                       argOr(argc, argv, 3, 20000));
+  if (argc > 1 && strcmp(argv[1], "portal") == 0)
+    return runPortalCheck(argOr(argc, argv, 2, 3));
+  if (argc > 1 && strcmp(argv[1], "health") == 0)
+    return runHealthCheck();
+  if (argc > 1 && strcmp(argv[1], "http") == 0)
+    return runHttpCheck();
+  if (argc > 1 && strcmp(argv[1], "trace") == 0)
+    return runTraceCheck(argc > 2 ? argv[2] : "wheelio_trace.bin",
+                         argOr(argc, argv, 3, 18000));
+  if (argc > 2 && strcmp(argv[1], "replay") == 0)
+    return runTraceReplay(argv[2], argc > 3 ? argv[3] : NULL);
+  return runControlLoop(argOr(argc, argv, 1, 100000),
+                        argOr(argc, argv, 2, 1, 0),
+                        argc > 3 && strcmp(argv[3], "fixed") == 0);
+}
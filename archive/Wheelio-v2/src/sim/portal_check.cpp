@@ -0,0 +1,117 @@
+#include "control.h"
+#include "runtime_config.h"
+#include "sim.h"
+#include "wifi_portal.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+// Runs the control loop in real time, scheduled like controlTask, while
+// the WiFi portal is open, and records how late each tick starts against
+// the period the previous tick asked for. With the portal polled from its
+// own thread, as portalTask does on the board, no tick may start more than
+// MAX_LATENESS late. The same run with the portal polled inline from the
+// control loop, the way loop() used to block in startConfigPortal(), must
+// show the stall, or the measurement is not seeing anything.
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Well below the 300 ms one emulated portal step blocks for, well above
+// host scheduling noise. On the board the jitter metric holds the real
+// bound (one FreeRTOS tick).
+static const double MAX_LATENESS_MS = 100.0;
+static const std::chrono::milliseconds PORTAL_POLL(10);
+
+static std::atomic<bool> running(false);
+
+static void portalThread() {
+  while (running.load(std::memory_order_acquire)) {
+    wifiPortalPoll();
+    std::this_thread::sleep_for(PORTAL_POLL);
+  }
+}
+
+struct PortalRun {
+  uint32_t ticks;
+  double maxLatenessMs;
+  bool connected;
+};
+
+static PortalRun runWithPortal(uint32_t seconds, bool inlinePortal) {
+  wifiPortalRequest();
+  wifiPortalPoll(); // open it
+  running.store(true, std::memory_order_release);
+  std::thread portal;
+  if (!inlinePortal)
+    portal = std::thread(portalThread);
+
+  PortalRun run = {0, 0.0, false};
+  SensorData data = {};
+  SteadyClock::time_point start = SteadyClock::now();
+  SteadyClock::time_point end = start + std::chrono::seconds(seconds);
+  SteadyClock::time_point due = start; // vTaskDelayUntil's wake time
+  SteadyClock::time_point expected = start;
+  while (SteadyClock::now() < end) {
+    SteadyClock::time_point tickStart = SteadyClock::now();
+    double lateMs =
+        std::chrono::duration<double, std::milli>(tickStart - expected)
+            .count();
+    if (lateMs > run.maxLatenessMs)
+      run.maxLatenessMs = lateMs;
+    run.ticks++;
+
+    simAdvanceMicros(controlPeriodMs() * 1000ULL);
+    controlTick(data);
+    if (inlinePortal)
+      wifiPortalPoll();
+
+    // Overrun: restart the schedule from now, as controlTask does
+    std::chrono::milliseconds period(controlPeriodMs());
+    expected = tickStart + period;
+    due += period;
+    if (SteadyClock::now() >= due)
+      due = SteadyClock::now();
+    std::this_thread::sleep_until(due);
+  }
+
+  // Credentials entered: the portal connects on its next poll
+  simPortalSubmit();
+  SteadyClock::time_point giveUp =
+      SteadyClock::now() + std::chrono::seconds(2);
+  while (wifiPortalState() == WIFI_PORTAL_OPEN &&
+         SteadyClock::now() < giveUp) {
+    if (inlinePortal)
+      wifiPortalPoll();
+    else
+      std::this_thread::sleep_for(PORTAL_POLL);
+  }
+  running.store(false, std::memory_order_release);
+  if (portal.joinable())
+    portal.join();
+  run.connected = wifiPortalState() == WIFI_PORTAL_CONNECTED;
+  return run;
+}
+
+int runPortalCheck(uint32_t seconds) {
+  simSeed(1);
+  // Every tick at the fast period, the tightest schedule the loop runs
+  configDraft().idlePeriodMs = configDraft().fastPeriodMs;
+  configPublish();
+  wifiPortalBegin();
+
+  PortalRun task = runWithPortal(seconds, false);
+  printf("portal in its own task: %u ticks in %u s, max lateness %.2f ms "
+         "(limit %.1f ms), %s\n",
+         task.ticks, seconds, task.maxLatenessMs, MAX_LATENESS_MS,
+         task.connected ? "connected" : "NOT connected");
+  PortalRun inlined = runWithPortal(seconds, true);
+  printf("portal polled inline:   %u ticks in %u s, max lateness %.2f ms\n",
+         inlined.ticks, seconds, inlined.maxLatenessMs);
+
+  bool ok = task.connected && inlined.connected &&
+            task.maxLatenessMs <= MAX_LATENESS_MS &&
+            inlined.maxLatenessMs > MAX_LATENESS_MS;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include "actuators.h"
+#include "sim.h"
+
+static SimActuatorLog actuatorLog = {};
+
+const SimActuatorLog &simActuators() { return actuatorLog; }
+
+void actuatorsInit() {
+  setFogLight(false);
+  setWarningLight(false);
+  setBuzzer(false);
+}
+
+void setFogLight(bool on) {
+  actuatorLog.fogToggles += (on != actuatorLog.fogLight);
+  actuatorLog.fogLight = on;
+  actuatorLog.writes++;
+}
+
+void setWarningLight(bool on) {
+  actuatorLog.warningToggles += (on != actuatorLog.warningLight);
+  actuatorLog.warningLight = on;
+  actuatorLog.writes++;
+}
+
+void setBuzzer(bool on) {
+  actuatorLog.buzzerToggles += (on != actuatorLog.buzzer);
+  actuatorLog.buzzer = on;
+  actuatorLog.writes++;
+}
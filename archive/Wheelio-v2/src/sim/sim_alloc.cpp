@@ -0,0 +1,29 @@
+#include "alloc_counter.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// Counts every operator new in the native build
+static std::atomic<uint32_t> allocations(0);
+
+uint32_t allocCount() { return allocations.load(std::memory_order_relaxed); }
+
+bool allocCountEnabled() { return true; }
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = malloc(size ? size : 1);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete[](void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
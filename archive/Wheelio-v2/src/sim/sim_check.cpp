@@ -0,0 +1,11 @@
+#include "sim.h"
+#include <stdio.h>
+
+static bool allOk = true;
+
+void simCheck(bool ok, const char *what) {
+  printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+  allOk = allOk && ok;
+}
+
+bool simAllOk() { return allOk; }
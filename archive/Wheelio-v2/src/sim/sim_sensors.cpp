@@ -0,0 +1,218 @@
+#include "config.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "ring_buffer.h"
+#include "sensor_health.h"
+#include "sim.h"
+#include "timebase.h"
+#include <math.h>
+
+// Simulated ride: light drifts between daylight and tunnel, obstacles come
+// and go in front of the lidar, and the rider leans through corners with an
+// occasional hard lean that should trip the warning. The last two minutes
+// of every ten the bike stands upright with nothing in front of it.
+
+static uint32_t rngState = 1;
+
+void simSeed(uint32_t seed) { rngState = seed ? seed : 1; }
+
+// xorshift32, deterministic across hosts
+static uint32_t nextRandom() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// Uniform noise in [-amplitude, amplitude]
+static float noise(float amplitude) {
+  return amplitude * ((float)(nextRandom() & 0xFFFF) / 32767.5f - 1.0f);
+}
+
+static float seconds() { return timebaseMicros() / 1e6f; }
+
+// Injected faults. A faulted sensor stops answering and stays hung, as
+// after a brown-out, until its driver re-initializes it with the fault gone.
+static bool faulted[SENSOR_COUNT] = {};
+static bool hung[SENSOR_COUNT] = {};
+
+void simSensorFault(SensorId sensor, bool failed) {
+  faulted[sensor] = failed;
+  if (failed)
+    hung[sensor] = true;
+}
+
+static bool answering(SensorId sensor) { return !hung[sensor]; }
+
+// Runs at once; a faulted sensor does not answer it
+static bool reinit(SensorId sensor) {
+  if (!faulted[sensor])
+    hung[sensor] = false;
+  return true;
+}
+
+// 1 while riding, 0 while parked, with 2 s ramps between
+static double riding(double t) {
+  double phase = fmod(t, 600.0);
+  if (phase < 480.0)
+    return fmin(1.0, phase / 2.0);
+  return fmax(0.0, 1.0 - (phase - 480.0) / 2.0);
+}
+
+static LightStats lightStatsSim = {};
+static uint64_t lastLightUs = 0;
+
+void lightSensorInit() { lastLightUs = timebaseMicros(); }
+
+// Returns the latest oversampled estimate, like the DMA driver: the mean of
+// LIGHT_ADC_SAMPLE_RATE_HZ / LIGHT_OUTPUT_RATE_HZ conversions, whose noise
+// shrinks with the square root of the block size.
+float readLightLevel() {
+  uint64_t now = timebaseMicros();
+  uint32_t outputs =
+      (uint32_t)((now - lastLightUs) * LIGHT_OUTPUT_RATE_HZ / 1000000ULL);
+  lastLightUs += outputs * (1000000ULL / LIGHT_OUTPUT_RATE_HZ);
+  lightStatsSim.outputs += outputs;
+  lightStatsSim.samples +=
+      outputs * (LIGHT_ADC_SAMPLE_RATE_HZ / LIGHT_OUTPUT_RATE_HZ);
+
+  float t = seconds();
+  float counts = 2800.0f + 900.0f * sinf(t * 0.05f);
+  float block = (float)(LIGHT_ADC_SAMPLE_RATE_HZ / LIGHT_OUTPUT_RATE_HZ);
+  counts += noise(150.0f / sqrtf(block));
+  return lightCountsToLux(counts);
+}
+
+LightStats lightSensorStats() { return lightStatsSim; }
+
+static uint64_t nextRangeUs = 0;
+static uint32_t rangeIntervalMs = LIDAR_INTER_MEASUREMENT_MS;
+static LidarStats lidarStatsSim = {};
+
+void lidarInit() { nextRangeUs = timebaseMicros(); }
+
+// Ranges complete every lidarSetInterval() ms; a shorter timing budget
+// gives noisier ranges, as on the VL53L0X.
+bool lidarReadSample(LidarSample &sample) {
+  if (!answering(SENSOR_LIDAR)) {
+    nextRangeUs = timebaseMicros() + rangeIntervalMs * 1000ULL;
+    return false;
+  }
+  while (nextRangeUs <= timebaseMicros()) {
+    uint64_t us = nextRangeUs;
+    nextRangeUs += rangeIntervalMs * 1000ULL;
+    // Occasional sensor-rejected range (signal fail, wrap-around)
+    if ((nextRandom() % 16) == 0) {
+      lidarStatsSim.invalid++;
+      continue;
+    }
+    float t = us / 1e6f;
+    float sigma = 8.0f * sqrtf(33000.0f / LIDAR_TIMING_BUDGET_US);
+    float distance = 140.0f + 80.0f * sinf(t * 0.3f) + noise(sigma);
+    if (riding(t) < 1.0)
+      distance = LIDAR_MAX_RANGE_CM;
+    sample.timestampUs = us;
+    sample.distance = distance > LIDAR_MAX_RANGE_CM ? LIDAR_MAX_RANGE_CM
+                                                    : (int)distance;
+    lidarStatsSim.samples++;
+    return true;
+  }
+  return false;
+}
+
+int readLidarDistance() {
+  LidarSample sample;
+  int distance = -1;
+  while (lidarReadSample(sample))
+    distance = sample.distance;
+  return distance;
+}
+
+void lidarSetInterval(uint32_t ms) {
+  rangeIntervalMs = ms < LIDAR_INTER_MEASUREMENT_MS
+                        ? LIDAR_INTER_MEASUREMENT_MS
+                        : ms;
+}
+
+LidarStats lidarStats() { return lidarStatsSim; }
+
+bool lidarRecover() { return reinit(SENSOR_LIDAR); }
+
+static uint16_t mpuRate = 0;
+static uint64_t nextFrameUs = 0;
+static MpuFifoStats mpuStats = {};
+// The board's ring between the FIFO task and the control loop, so a tick
+// too long for it drops frames here too
+static RingBuffer<ImuFrame, MPU_FRAME_RING> mpuFrames;
+
+// Degrees; double so the gyro rate below can difference it at 1 ms steps
+static double leanAt(double t) {
+  double lean = 20.0 * sin(t * 0.4);
+  // Hard lean for 3 s every minute, reached and left within 0.25 s
+  double phase = fmod(t, 60.0) - 57.0;
+  if (phase > 0.0) {
+    double k = fmin(1.0, fmin(phase, 3.0 - phase) / 0.25);
+    lean += (38.0 - lean) * k;
+  }
+  return lean * riding(t);
+}
+
+static ImuFrame frameAt(uint64_t us) {
+  float t = us / 1e6f;
+  double ts = us / 1e6;
+  float lean = (float)(leanAt(ts) * M_PI / 180.0);
+  ImuFrame frame;
+  frame.timestampUs = us;
+  frame.accelX = 0.4f * sinf(t * 1.3f) + noise(0.3f);
+  frame.accelY = 9.81f * sinf(lean) + noise(0.2f);
+  frame.accelZ = 9.81f * cosf(lean) + noise(0.2f);
+  // Roll rate matching the lean, plus noise and a small bias
+  double rate = (leanAt(ts + 0.0005) - leanAt(ts - 0.0005)) / 0.001;
+  frame.gyroX = (float)(rate * M_PI / 180.0) + 0.005f + noise(0.02f);
+  frame.gyroY = noise(0.02f);
+  frame.gyroZ = noise(0.02f);
+  return frame;
+}
+
+void mpu6050Init() {
+  if (MPU_USE_FIFO)
+    mpu6050StartFifo(MPU_SAMPLE_RATE_HZ);
+}
+
+bool mpu6050ReadFrame(ImuFrame &frame) {
+  if (!answering(SENSOR_IMU))
+    return false;
+  frame = frameAt(timebaseMicros());
+  return true;
+}
+
+bool mpu6050StartFifo(uint16_t sampleRateHz) {
+  if (sampleRateHz < 4 || sampleRateHz > 1000)
+    return false;
+  mpuRate = sampleRateHz;
+  nextFrameUs = timebaseMicros();
+  return true;
+}
+
+size_t mpu6050ReadFrames(ImuFrame *frames, size_t maxFrames) {
+  uint64_t now = timebaseMicros();
+  uint64_t periodUs = 1000000ULL / mpuRate;
+  if (!answering(SENSOR_IMU)) {
+    nextFrameUs = now + periodUs;
+    return 0;
+  }
+  for (; nextFrameUs <= now; nextFrameUs += periodUs) {
+    if (mpuFrames.push(frameAt(nextFrameUs)))
+      mpuStats.frames++;
+    else
+      mpuStats.dropped++;
+  }
+  return mpuFrames.popMany(frames, maxFrames);
+}
+
+uint16_t mpu6050SampleRate() { return mpuRate; }
+
+MpuFifoStats mpu6050FifoStats() { return mpuStats; }
+
+bool mpu6050Recover() { return reinit(SENSOR_IMU); }
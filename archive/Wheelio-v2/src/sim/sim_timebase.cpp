@@ -0,0 +1,22 @@
+#include "sim.h"
+#include "timebase.h"
+#include <chrono>
+
+static uint64_t nowUs = 0;
+
+void simAdvanceMicros(uint64_t us) { nowUs += us; }
+
+uint32_t timebaseMillis() { return (uint32_t)(nowUs / 1000); }
+
+uint64_t timebaseMicros() { return nowUs; }
+
+// The simulated clock is always synced, starting at 2024-01-01T00:00:00Z
+uint64_t timebaseEpochMs() { return 1704067200000ULL + nowUs / 1000; }
+
+uint32_t timebaseCycles() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t timebaseCyclesPerUs() { return 1000; }
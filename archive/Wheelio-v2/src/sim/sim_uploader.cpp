@@ -0,0 +1,48 @@
+#include "config.h"
+#include "sim.h"
+#include "telemetry_codec.h"
+#include "telemetry_json.h"
+#include "uploader.h"
+#include <stdio.h>
+
+static SimUploadLog uploadLog = {};
+static bool online = true;
+
+void simSetOnline(bool up) { online = up; }
+
+const SimUploadLog &simUploads() { return uploadLog; }
+
+void uploaderInit() {}
+
+bool uploaderReady() { return online; }
+
+bool uploaderSendBatch(const TelemetrySample *samples, size_t count) {
+  if (!online)
+    return false;
+  size_t bytes;
+  if (TELEMETRY_PACKED) {
+    static uint8_t packed[TELEMETRY_ENCODED_BOUND(TELEMETRY_REPLAY_BATCH)];
+    static char text[(sizeof(packed) + 2) / 3 * 4 + 1];
+    size_t length = telemetryEncode(samples, count, packed, sizeof(packed));
+    bytes = base64Encode(packed, length, text, sizeof(text)) + 2; // quotes
+  } else {
+    // Same body the board writes to the socket
+    static char body[TELEMETRY_JSON_BUFFER_BYTES];
+    bytes = telemetryToJson(samples, count, body, sizeof(body));
+  }
+  uploadLog.uploads++;
+  uploadLog.samples += count;
+  uploadLog.bytes += bytes;
+  return true;
+}
+
+bool uploaderSendHealth() {
+  if (!online)
+    return false;
+  // No I2C bus in the simulation
+  static char body[HEALTH_JSON_BYTES];
+  if (healthToJson(0, body, sizeof(body)) == 0)
+    return false;
+  uploadLog.healthReports++;
+  return true;
+}
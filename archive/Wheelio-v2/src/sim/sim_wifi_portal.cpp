@@ -0,0 +1,39 @@
+#include "sim.h"
+#include "wifi_portal.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// On the board a poll that serves the portal page runs a WiFi scan and
+// blocks for a second or more. Here every poll while open holds the calling
+// thread for longer than the slowest control period.
+static const std::chrono::milliseconds SERVE_TIME(300);
+
+static std::atomic<bool> requested(false);
+static std::atomic<bool> submitted(false);
+static std::atomic<uint8_t> state(WIFI_PORTAL_CLOSED);
+
+void simPortalSubmit() { submitted.store(true); }
+
+// The simulated board has a saved network
+bool wifiPortalBegin() {
+  state.store(WIFI_PORTAL_CONNECTED);
+  return true;
+}
+
+void wifiPortalRequest() { requested.store(true); }
+
+WifiPortalState wifiPortalPoll() {
+  if (requested.exchange(false) && state.load() != WIFI_PORTAL_OPEN) {
+    submitted.store(false);
+    state.store(WIFI_PORTAL_OPEN);
+  }
+  if (state.load() == WIFI_PORTAL_OPEN) {
+    std::this_thread::sleep_for(SERVE_TIME);
+    if (submitted.exchange(false))
+      state.store(WIFI_PORTAL_CONNECTED);
+  }
+  return (WifiPortalState)state.load();
+}
+
+WifiPortalState wifiPortalState() { return (WifiPortalState)state.load(); }
@@ -0,0 +1,114 @@
+#include "control.h"
+#include "runtime_config.h"
+#include "sim.h"
+#include "snapshot.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+// Hammers Snapshot<SensorData> from two threads the way the control task
+// and loop() use it. Every published struct has all fields set to the
+// same sequence number, so a torn read shows up as mismatched fields and a
+// stale slot shows up as the sequence going backwards. Then does the same
+// for RuntimeConfig through configPublish()/configAcquire(), as the config
+// stream task and the control loop do.
+
+static Snapshot<SensorData> snapshot;
+static std::atomic<bool> writerDone(false);
+
+static void writer(uint32_t iterations) {
+  for (uint32_t i = 1; i <= iterations; i++) {
+    float v = (float)i;
+    SensorData data = {v, v, v, v, v};
+    snapshot.publish(data);
+  }
+  writerDone.store(true, std::memory_order_release);
+}
+
+static const size_t CONFIG_FIELDS = sizeof(RuntimeConfig) / sizeof(float);
+static_assert(sizeof(RuntimeConfig) == CONFIG_FIELDS * sizeof(float),
+              "RuntimeConfig is all floats");
+
+static void configWriter(uint32_t iterations) {
+  RuntimeConfig &draft = configDraft();
+  for (uint32_t i = 1; i <= iterations; i++) {
+    float fields[CONFIG_FIELDS];
+    for (size_t f = 0; f < CONFIG_FIELDS; f++)
+      fields[f] = (float)i;
+    memcpy(&draft, fields, sizeof(fields));
+    configPublish();
+  }
+  writerDone.store(true, std::memory_order_release);
+}
+
+static bool allFieldsEqual(const RuntimeConfig &cfg) {
+  float fields[CONFIG_FIELDS];
+  memcpy(fields, &cfg, sizeof(fields));
+  for (size_t i = 1; i < CONFIG_FIELDS; i++) {
+    if (fields[i] != fields[0])
+      return false;
+  }
+  return true;
+}
+
+static bool runConfigStress(uint32_t iterations) {
+  // Sequence 0 first, so reads before the writer gets going are consistent
+  configDraft() = {};
+  configPublish();
+  writerDone.store(false, std::memory_order_relaxed);
+  std::thread producer(configWriter, iterations);
+
+  uint32_t reads = 0, torn = 0, backwards = 0;
+  float last = 0.0f;
+  for (;;) {
+    bool done = writerDone.load(std::memory_order_acquire);
+    const RuntimeConfig &cfg = configAcquire();
+    reads++;
+    if (!allFieldsEqual(cfg))
+      torn++;
+    if (cfg.tiltSideThreshold < last)
+      backwards++;
+    last = cfg.tiltSideThreshold;
+    if (done && last == (float)iterations)
+      break;
+  }
+  producer.join();
+
+  printf("config stress: %u publishes, %u acquires, last seq %.0f\n",
+         iterations, reads, last);
+  printf("torn reads: %u, out-of-order reads: %u\n", torn, backwards);
+  return torn == 0 && backwards == 0;
+}
+
+int runSnapshotStress(uint32_t iterations) {
+  std::thread producer(writer, iterations);
+
+  uint32_t reads = 0, fresh = 0, torn = 0, backwards = 0;
+  float last = 0.0f;
+  for (;;) {
+    bool done = writerDone.load(std::memory_order_acquire);
+    SensorData data;
+    bool isFresh = snapshot.read(data);
+    reads++;
+    fresh += isFresh;
+    if (data.distanceRaw != data.lumensRaw ||
+        data.accelXRaw != data.lumensRaw ||
+        data.tiltSideRaw != data.lumensRaw || data.tiltFBRaw != data.lumensRaw)
+      torn++;
+    if (data.lumensRaw < last)
+      backwards++;
+    last = data.lumensRaw;
+    if (done && !isFresh)
+      break;
+  }
+  producer.join();
+
+  printf("snapshot stress: %u publishes, %u reads (%u fresh), last seq %.0f\n",
+         iterations, reads, fresh, last);
+  printf("torn reads: %u, out-of-order reads: %u\n", torn, backwards);
+  bool ok = torn == 0 && backwards == 0 && last == (float)iterations;
+  ok = runConfigStress(iterations) && ok;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
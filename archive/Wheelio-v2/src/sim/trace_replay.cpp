@@ -0,0 +1,283 @@
+#include "actuators.h"
+#include "config.h"
+#include "config_store.h"
+#include "control.h"
+#include "crc32.h"
+#include "flash_storage.h"
+#include "latency.h"
+#include "lidar_sensor.h"
+#include "light_sensor.h"
+#include "mpu6050_sensor.h"
+#include "raw_trace.h"
+#include "runtime_config.h"
+#include "sensor_health.h"
+#include "sim.h"
+#include "timebase.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Raw sensor traces on the host. `trace` records a simulated ride the way
+// the board does, to a stream file and to a small flash ring, with a
+// threshold change and a lidar outage on the way, then replays the stream
+// through the same filter and rule code and requires the replayed actuator
+// timeline to be bit-identical to the live one. `replay` runs any recorded
+// trace, a serial capture or a dump of the "trace" partition, as fast as
+// the host goes and prints the actuator changes, so two firmware versions
+// can be diffed on the same ride.
+
+using SteadyClock = std::chrono::steady_clock;
+
+// CRC over everything a tick decided: its time, the relays, the rules,
+// sensor health and the filtered values
+struct Timeline {
+  uint32_t ticks;
+  uint32_t crc;
+};
+
+static void addTick(Timeline &timeline, uint64_t us,
+                    const ActuatorState &state, uint8_t health,
+                    const SensorData &data) {
+  uint8_t tick[8 + 5 + 5 * sizeof(float)];
+  memcpy(tick, &us, 8);
+  tick[8] = state.fogLight;
+  tick[9] = state.warningLight;
+  tick[10] = state.buzzer;
+  tick[11] = state.rules;
+  tick[12] = health;
+  const float values[5] = {data.lumensRaw, data.distanceRaw, data.accelXRaw,
+                           data.tiltSideRaw, data.tiltFBRaw};
+  memcpy(tick + 13, values, sizeof(values));
+  timeline.crc = crc32(tick, sizeof(tick), timeline.crc);
+  timeline.ticks++;
+}
+
+struct Replay {
+  Timeline timeline;
+  std::vector<uint32_t> raw; // per-tick CRC of the decoded sample
+  bool synced, configured;
+  uint64_t prevUs, firstUs, lastUs;
+  uint32_t waiting; // ticks before the first SYNC and CONFIG
+  uint32_t bad;     // ticks that failed to decode
+  uint32_t restarts;
+  FILE *changes; // actuator changes, or NULL
+  bool hasLast;
+  ActuatorState last;
+  uint8_t lastHealth;
+};
+
+static void replayTick(Replay &r, const RawSample &raw) {
+  // Time going backwards is a reboot: start over as the board did
+  if (r.timeline.ticks > 0 && raw.timestampUs < r.lastUs) {
+    controlReset();
+    r.restarts++;
+  }
+  SensorData data = {};
+  uint32_t t = latencyStart();
+  ActuatorState state = controlStep(raw, configAcquire(), data, t);
+  uint8_t health = sensorHealthPacked();
+  addTick(r.timeline, raw.timestampUs, state, health, data);
+
+  uint8_t absolute[TRACE_FRAME_MAX_BYTES];
+  size_t length = traceEncodeTick(raw, 0, absolute, sizeof(absolute));
+  r.raw.push_back(crc32(absolute, length));
+  if (r.timeline.ticks == 1)
+    r.firstUs = raw.timestampUs;
+  r.lastUs = raw.timestampUs;
+
+  bool changed = !r.hasLast || state.fogLight != r.last.fogLight ||
+                 state.warningLight != r.last.warningLight ||
+                 state.buzzer != r.last.buzzer ||
+                 state.rules != r.last.rules || health != r.lastHealth;
+  if (r.changes != NULL && changed)
+    fprintf(r.changes, "%llu %d %d %d 0x%02x 0x%02x\n",
+            (unsigned long long)raw.timestampUs, state.fogLight,
+            state.warningLight, state.buzzer, state.rules, health);
+  r.hasLast = true;
+  r.last = state;
+  r.lastHealth = health;
+}
+
+static void onFrame(TraceFrameType type, const uint8_t *payload,
+                    size_t length, void *context) {
+  Replay &r = *(Replay *)context;
+  if (type == TRACE_SYNC) {
+    r.synced = length == 1 && payload[0] == TRACE_VERSION;
+    r.prevUs = 0; // the next tick's time is absolute
+  } else if (type == TRACE_CONFIG) {
+    if (r.synced)
+      r.configured = configDeserialize(payload, length);
+  } else if (!r.synced || !r.configured) {
+    r.waiting++;
+  } else {
+    RawSample raw;
+    if (!traceDecodeTick(payload, length, r.prevUs, raw)) {
+      r.bad++;
+      r.synced = false; // the next delta has nothing to go from
+      return;
+    }
+    r.prevUs = raw.timestampUs;
+    replayTick(r, raw);
+  }
+}
+
+static void startReplay(Replay &r, FILE *changes) {
+  controlReset();
+  r = Replay();
+  r.changes = changes;
+  if (changes != NULL)
+    fprintf(changes, "# uptime_us fog warning buzzer rules health\n");
+}
+
+// A dump of the trace partition starts with a sector header; anything else
+// is read as a stream
+static bool replayFile(const char *path, Replay &r, uint32_t &skipped) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+  uint32_t magic = 0;
+  bool dump = fread(&magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              magic == TRACE_SECTOR_MAGIC;
+  TraceReader reader(onFrame, &r);
+  if (dump) {
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    FlashStorage *flash = simFileFlash(path, size, 4096);
+    bool ok = flash != NULL && TraceFlash::readAll(flash, reader);
+    delete flash;
+    skipped = reader.skipped();
+    return ok;
+  }
+  rewind(file);
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    reader.feed(chunk, n);
+  fclose(file);
+  skipped = reader.skipped();
+  return true;
+}
+
+int runTraceReplay(const char *path, const char *timelinePath) {
+  FILE *changes = stdout;
+  if (timelinePath != NULL && (changes = fopen(timelinePath, "w")) == NULL) {
+    printf("cannot open %s\n", timelinePath);
+    return 1;
+  }
+  Replay r;
+  startReplay(r, changes);
+  uint32_t skipped = 0;
+  SteadyClock::time_point start = SteadyClock::now();
+  bool ok = replayFile(path, r, skipped);
+  double wallS =
+      std::chrono::duration<double>(SteadyClock::now() - start).count();
+  if (changes != stdout)
+    fclose(changes);
+  if (!ok) {
+    printf("cannot read %s\n", path);
+    return 1;
+  }
+  double rideS = (r.lastUs - r.firstUs) / 1e6;
+  printf("%u ticks, %.1f s of ride in %.3f s (%.0fx real time), timeline "
+         "%08x\n",
+         r.timeline.ticks, rideS, wallS, wallS > 0 ? rideS / wallS : 0.0,
+         r.timeline.crc);
+  printf("%u ticks before the first sync, %u bad, %u reboots, %u bytes "
+         "skipped\n",
+         r.waiting, r.bad, r.restarts, skipped);
+  return r.timeline.ticks > 0 && r.bad == 0 ? 0 : 1;
+}
+
+static const uint64_t TICK_US = CONTROL_PERIOD_MS * 1000ULL;
+static const size_t RING_SECTORS = 16;
+
+int runTraceCheck(const char *path, uint32_t periods) {
+  FILE *stream = fopen(path, "wb");
+  FlashStorage *ring = simFileFlash(NULL, RING_SECTORS * 4096, 4096);
+  TraceFlash flash;
+  if (stream == NULL || !flash.begin(ring)) {
+    printf("cannot open %s\n", path);
+    return 1;
+  }
+  simSeed(1);
+  lightSensorInit();
+  mpu6050Init();
+  lidarInit();
+  actuatorsInit();
+  controlReset();
+  traceStart();
+
+  // The live ride, drained every tick the way the sink tasks keep up
+  Timeline live = {};
+  SensorData data = {};
+  uint64_t endUs = timebaseMicros() + periods * TICK_US;
+  uint64_t changeUs = timebaseMicros() + periods * TICK_US / 2;
+  uint64_t outageUs = timebaseMicros() + periods * TICK_US / 4;
+  size_t bytes = 0;
+  static uint8_t frames[1024];
+  while (timebaseMicros() < endUs) {
+    simAdvanceMicros(controlPeriodMs() * 1000ULL);
+    uint64_t now = timebaseMicros();
+    if (now >= changeUs && changeUs != 0) {
+      configDraft().distThreshold = 150.0f;
+      configPublish();
+      changeUs = 0;
+    }
+    simSensorFault(SENSOR_LIDAR, now >= outageUs &&
+                                     now < outageUs + 5000000ULL);
+    ActuatorState state = controlTick(data);
+    addTick(live, now, state, sensorHealthPacked(), data);
+    size_t length = traceDrain(frames, sizeof(frames));
+    fwrite(frames, 1, length, stream);
+    flash.append(frames, length);
+    bytes += length;
+  }
+  traceStop();
+  fclose(stream);
+  TraceStats stats = traceStats();
+  printf("recorded %u ticks, %u configs, %zu bytes (%.1f bytes/tick), "
+         "%u dropped\n",
+         stats.ticks, stats.configs, bytes,
+         stats.ticks ? (double)bytes / stats.ticks : 0.0, stats.dropped);
+  simCheck(stats.ticks == live.ticks && stats.dropped == 0,
+           "every tick recorded");
+  simCheck(stats.configs >= 2, "config recorded again after the change");
+
+  Replay replay;
+  startReplay(replay, NULL);
+  uint32_t skipped = 0;
+  SteadyClock::time_point start = SteadyClock::now();
+  replayFile(path, replay, skipped);
+  double wallS =
+      std::chrono::duration<double>(SteadyClock::now() - start).count();
+  double rideS = (replay.lastUs - replay.firstUs) / 1e6;
+  printf("replayed %.1f s of ride in %.3f s, %.0fx real time\n", rideS,
+         wallS, wallS > 0 ? rideS / wallS : 0.0);
+  simCheck(replay.timeline.ticks == live.ticks && replay.bad == 0 &&
+               skipped == 0,
+           "stream replays every tick");
+  simCheck(replay.timeline.crc == live.crc,
+           "replayed timeline bit-identical to the live one");
+  printf("  live %08x, replay %08x\n", live.crc, replay.timeline.crc);
+
+  Replay tail;
+  startReplay(tail, NULL);
+  TraceReader reader(onFrame, &tail);
+  simCheck(TraceFlash::readAll(ring, reader) && tail.bad == 0 &&
+               tail.timeline.ticks > 0 &&
+               tail.timeline.ticks < replay.timeline.ticks,
+           "flash ring holds the newest ticks");
+  simCheck(tail.raw.size() <= replay.raw.size() &&
+               std::equal(tail.raw.begin(), tail.raw.end(),
+                          replay.raw.end() - tail.raw.size()),
+           "flash ring ticks match the end of the stream");
+  printf("  %u ticks (%.1f s) in %zu sectors\n", tail.timeline.ticks,
+         (tail.lastUs - tail.firstUs) / 1e6, RING_SECTORS);
+  delete ring;
+
+  printf("%s\n", simAllOk() ? "PASS" : "FAIL");
+  return simAllOk() ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "telemetry.h"
+#include <stdlib.h>
+
+TelemetryBuffer telemetryBuffer;
+
+bool telemetryDue(const TelemetrySample &sample) {
+  static bool started = false;
+  static uint64_t lastUs = 0;
+  static ActuatorState last = {};
+  static uint8_t lastHealth = 0;
+  const ActuatorState &now = sample.actuators;
+  bool changed = now.fogLight != last.fogLight ||
+                 now.warningLight != last.warningLight ||
+                 now.buzzer != last.buzzer || now.rules != last.rules ||
+                 sample.health != lastHealth;
+  // 10% slack so a slightly early tick at the nominal rate still counts
+  if (started && !changed &&
+      sample.timestampUs - lastUs < CONTROL_PERIOD_MS * 900ULL)
+    return false;
+  started = true;
+  lastUs = sample.timestampUs;
+  last = now;
+  lastHealth = sample.health;
+  return true;
+}
+
+static const char PUSH_CHARS[] =
+    "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+
+void telemetryPushKey(uint64_t epochMs, char key[21]) {
+  static uint64_t lastMs = 0;
+  static uint8_t suffix[12];
+
+  // Same millisecond: bump the random suffix so the new key sorts after
+  if (epochMs == lastMs) {
+    int i = 11;
+    while (i >= 0 && suffix[i] == 63)
+      suffix[i--] = 0;
+    if (i >= 0)
+      suffix[i]++;
+  } else {
+    lastMs = epochMs;
+    for (int i = 0; i < 12; i++)
+      suffix[i] = rand() % 64;
+  }
+
+  for (int i = 7; i >= 0; i--) {
+    key[i] = PUSH_CHARS[epochMs % 64];
+    epochMs /= 64;
+  }
+  for (int i = 0; i < 12; i++)
+    key[8 + i] = PUSH_CHARS[suffix[i]];
+  key[20] = '\0';
+}
@@ -0,0 +1,180 @@
+#include "telemetry_codec.h"
+#include "varint.h"
+#include "warning_rules.h"
+#include <math.h>
+#include <string.h>
+
+#define FLAG_FOG 0x01
+#define FLAG_WARNING 0x02
+#define FLAG_BUZZER 0x04
+#define FLAG_NO_EPOCH 0x08
+#define FLAG_RULES_SHIFT 4 // every RuleBit but RULE_DARK
+
+// RULE_DARK travels as the fog light, the only actuator it drives
+static const uint8_t FLAG_RULES = RULES_ALL & ~FOG_RULES;
+static_assert(FOG_RULES == 1u << RULE_DARK && FLAG_RULES == 0x0F,
+              "the rules field is four bits below RULE_DARK");
+
+static const int FIELDS = 5;
+
+static void fieldsOf(const SensorData &data, float values[FIELDS]) {
+  values[0] = data.lumensRaw;
+  values[1] = data.distanceRaw;
+  values[2] = data.accelXRaw;
+  values[3] = data.tiltSideRaw;
+  values[4] = data.tiltFBRaw;
+}
+
+static int32_t quantize(float value, float scale) {
+  float q = roundf(value * scale);
+  if (!(q > -2147483520.0f)) // also catches NaN
+    return INT32_MIN + 1;
+  if (q > 2147483520.0f)
+    return INT32_MAX;
+  return (int32_t)q;
+}
+
+size_t telemetryEncode(const TelemetrySample *samples, size_t count,
+                       uint8_t *out, size_t capacity) {
+  VarintWriter w = {out, capacity, 0, true};
+  uint64_t prevMs = count ? samples[0].timestampUs / 1000 : 0;
+  uint64_t prevEpoch = count ? samples[0].epochMs : 0;
+  int32_t prev[FIELDS] = {};
+
+  w.byte(TELEMETRY_CODEC_VERSION);
+  w.varint(count);
+  w.varint(prevMs);
+  w.varint(prevEpoch);
+  for (size_t i = 0; i < count && w.ok; i++) {
+    const TelemetrySample &sample = samples[i];
+    uint64_t ms = sample.timestampUs / 1000;
+    uint8_t flags = (sample.actuators.fogLight ? FLAG_FOG : 0) |
+                    (sample.actuators.warningLight ? FLAG_WARNING : 0) |
+                    (sample.actuators.buzzer ? FLAG_BUZZER : 0) |
+                    (sample.epochMs == 0 ? FLAG_NO_EPOCH : 0) |
+                    (sample.actuators.rules & FLAG_RULES) << FLAG_RULES_SHIFT;
+    w.byte(flags);
+    w.byte(sample.health);
+    w.varint(ms - prevMs);
+    if (sample.epochMs != 0) {
+      // Usually 0: wall clock advances with uptime
+      w.zigzag((int64_t)(sample.epochMs - prevEpoch) - (int64_t)(ms - prevMs));
+      prevEpoch = sample.epochMs;
+    }
+    prevMs = ms;
+
+    float values[FIELDS];
+    fieldsOf(sample.data, values);
+    for (int f = 0; f < FIELDS; f++) {
+      int32_t q = quantize(values[f], TELEMETRY_CODEC_SCALE[f]);
+      w.zigzag((int64_t)q - prev[f]);
+      prev[f] = q;
+    }
+  }
+  return w.ok ? w.length : 0;
+}
+
+int telemetryDecode(const uint8_t *data, size_t length,
+                    TelemetrySample *samples, size_t maxSamples) {
+  VarintReader r = {data, length, 0, true};
+  if (r.byte() != TELEMETRY_CODEC_VERSION || !r.ok)
+    return -1;
+  uint64_t count = r.varint();
+  uint64_t ms = r.varint();
+  uint64_t epoch = r.varint();
+  if (!r.ok || count > maxSamples)
+    return -1;
+
+  int64_t q[FIELDS] = {};
+  for (uint64_t i = 0; i < count; i++) {
+    uint8_t flags = r.byte(); // every bit is defined
+    TelemetrySample &sample = samples[i];
+    sample.health = r.byte();
+    uint64_t dt = r.varint();
+    ms += dt;
+    sample.timestampUs = ms * 1000;
+    if (flags & FLAG_NO_EPOCH) {
+      sample.epochMs = 0;
+    } else {
+      epoch += dt + r.zigzag();
+      sample.epochMs = epoch;
+    }
+    sample.actuators.fogLight = flags & FLAG_FOG;
+    sample.actuators.warningLight = flags & FLAG_WARNING;
+    sample.actuators.buzzer = flags & FLAG_BUZZER;
+    sample.actuators.rules = (flags >> FLAG_RULES_SHIFT) |
+                             (sample.actuators.fogLight ? FOG_RULES : 0);
+
+    float values[FIELDS];
+    for (int f = 0; f < FIELDS; f++) {
+      q[f] += r.zigzag();
+      if (q[f] < INT32_MIN || q[f] > INT32_MAX)
+        return -1;
+      values[f] = (float)q[f] / TELEMETRY_CODEC_SCALE[f];
+    }
+    sample.data.lumensRaw = values[0];
+    sample.data.distanceRaw = values[1];
+    sample.data.accelXRaw = values[2];
+    sample.data.tiltSideRaw = values[3];
+    sample.data.tiltFBRaw = values[4];
+    if (!r.ok)
+      return -1;
+  }
+  return r.pos == length ? (int)count : -1;
+}
+
+static const char BASE64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64Encode(const uint8_t *data, size_t length, char *out,
+                    size_t capacity) {
+  size_t needed = (length + 2) / 3 * 4;
+  if (needed + 1 > capacity)
+    return 0;
+  char *p = out;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t chunk = (uint32_t)data[i] << 16;
+    if (i + 1 < length)
+      chunk |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < length)
+      chunk |= data[i + 2];
+    *p++ = BASE64[(chunk >> 18) & 63];
+    *p++ = BASE64[(chunk >> 12) & 63];
+    *p++ = i + 1 < length ? BASE64[(chunk >> 6) & 63] : '=';
+    *p++ = i + 2 < length ? BASE64[chunk & 63] : '=';
+  }
+  *p = '\0';
+  return needed;
+}
+
+static int base64Value(char c) {
+  const char *hit = c ? strchr(BASE64, c) : NULL;
+  return hit ? (int)(hit - BASE64) : -1;
+}
+
+int base64Decode(const char *text, size_t length, uint8_t *out,
+                 size_t capacity) {
+  if (length % 4 != 0)
+    return -1;
+  size_t n = 0;
+  for (size_t i = 0; i < length; i += 4) {
+    int v[4];
+    int pad = 0;
+    for (int k = 0; k < 4; k++) {
+      char c = text[i + k];
+      if (c == '=' && i + 4 == length && k >= 2) {
+        v[k] = 0;
+        pad++;
+      } else if (pad > 0 || (v[k] = base64Value(c)) < 0) {
+        return -1;
+      }
+    }
+    uint32_t chunk = (v[0] << 18) | (v[1] << 12) | (v[2] << 6) | v[3];
+    for (int k = 0; k < 3 - pad; k++) {
+      if (n >= capacity)
+        return -1;
+      out[n++] = (uint8_t)(chunk >> (16 - 8 * k));
+    }
+  }
+  return (int)n;
+}
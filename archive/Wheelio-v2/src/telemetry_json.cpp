@@ -0,0 +1,75 @@
+#include "telemetry_json.h"
+#include "json_writer.h"
+#include "sensor_health.h"
+#include "warning_rules.h"
+
+size_t telemetryToJson(const TelemetrySample *samples, size_t count, char *out,
+                       size_t capacity) {
+  JsonWriter json(out, capacity);
+  json.beginObject();
+  for (size_t i = 0; i < count; i++) {
+    const TelemetrySample &sample = samples[i];
+    const SensorData &data = sample.data;
+    char key[21];
+    telemetryPushKey(sample.epochMs ? sample.epochMs
+                                    : sample.timestampUs / 1000,
+                     key);
+
+    json.beginObject(key);
+    json.beginObject("sensors")
+        .field("light", data.lumensRaw)
+        .field("lidar", data.distanceRaw)
+        .field("tilt_side", data.tiltSideRaw)
+        .field("tilt_fb", data.tiltFBRaw)
+        .field("accel_x", data.accelXRaw)
+        .endObject();
+    json.beginObject("actuators")
+        .field("fog_light", sample.actuators.fogLight)
+        .field("warning_light", sample.actuators.warningLight)
+        .field("buzzer", sample.actuators.buzzer)
+        .endObject();
+    json.field("warning", warningMessage(sample.actuators.rules));
+    if (sample.health) {
+      // Only while a sensor is out; no "health" reads as all ok
+      json.beginObject("health");
+      for (int s = 0; s < SENSOR_COUNT; s++)
+        json.field(sensorName((SensorId)s),
+                   healthStateName(sensorHealthUnpack(sample.health,
+                                                      (SensorId)s)));
+      json.endObject();
+    }
+    json.field("uptime_ms", (uint64_t)(sample.timestampUs / 1000));
+#if TELEMETRY_LATENCY
+    json.field("latency_us", (uint64_t)sample.latencyUs);
+#endif
+    if (sample.epochMs) {
+      json.field("timestamp", sample.epochMs);
+    } else if (i == count - 1) {
+      // No wall clock yet: only the newest sample gets the server time, so
+      // the dashboard's latest-by-timestamp still picks the right entry
+      json.serverValue("timestamp", "timestamp");
+    }
+    json.endObject();
+  }
+  json.endObject();
+  return json.ok() ? json.length() : 0;
+}
+
+size_t healthToJson(uint32_t busRecoveries, char *out, size_t capacity) {
+  JsonWriter json(out, capacity);
+  json.beginObject();
+  for (int s = 0; s < SENSOR_COUNT; s++) {
+    SensorHealthStats stats = sensorHealthStats((SensorId)s);
+    json.beginObject(sensorName((SensorId)s))
+        .field("state", healthStateName(stats.state))
+        .field("missed", (uint64_t)stats.misses)
+        .field("failed", (uint64_t)stats.failures)
+        .field("reinits", (uint64_t)stats.reinits)
+        .field("recovered", (uint64_t)stats.recoveries)
+        .endObject();
+  }
+  json.field("i2c_recoveries", (uint64_t)busRecoveries);
+  json.serverValue("timestamp", "timestamp");
+  json.endObject();
+  return json.ok() ? json.length() : 0;
+}
@@ -0,0 +1,301 @@
+#include "telemetry_log.h"
+#include "crc32.h"
+#include <string.h>
+
+#define SEGMENT_MAGIC 0x474C5457u // "WTLG"
+#define RECORD_MAGIC 0xA55Au
+#define SENT_MARKER 0x00000000u
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t sequence;   // increases every time a segment is (re)opened
+  uint32_t eraseCount; // lifetime erases of this segment
+  uint32_t crc;        // over the three fields above
+};
+
+struct RecordHeader {
+  uint16_t magic;
+  uint16_t length; // payload bytes
+  uint32_t crc;    // over the payload
+  uint32_t sent;   // 0xFFFFFFFF while pending, programmed to 0 once sent
+};
+
+static const uint32_t RECORD_SIZE =
+    (sizeof(RecordHeader) + sizeof(TelemetrySample) + 3) & ~3u;
+static const uint32_t FIRST_RECORD = sizeof(SegmentHeader);
+
+enum RecordState { RECORD_ERASED, RECORD_GARBAGE, RECORD_PRESENT };
+
+static bool headerValid(const SegmentHeader &header) {
+  return header.magic == SEGMENT_MAGIC &&
+         header.crc == crc32(&header, offsetof(SegmentHeader, crc));
+}
+
+TelemetryLog::TelemetryLog()
+    : storage(NULL), segmentCount(0), segmentSize(0), headSequence(0),
+      head(), tail(), pendingCount(0), logStats() {}
+
+size_t TelemetryLog::address(const Position &pos) const {
+  return (size_t)pos.segment * segmentSize + pos.offset;
+}
+
+size_t TelemetryLog::capacity() const {
+  if (segmentCount == 0)
+    return 0;
+  return (size_t)(segmentCount - 1) *
+         ((segmentSize - FIRST_RECORD) / RECORD_SIZE);
+}
+
+bool TelemetryLog::openSegment(uint32_t segment, uint32_t sequence) {
+  size_t base = (size_t)segment * segmentSize;
+  SegmentHeader old;
+  uint32_t eraseCount = 1;
+  if (storage->read(base, &old, sizeof(old)) && headerValid(old))
+    eraseCount = old.eraseCount + 1;
+
+  if (!storage->eraseSector(base))
+    return false;
+  logStats.erases++;
+  if (eraseCount > logStats.maxEraseCount)
+    logStats.maxEraseCount = eraseCount;
+
+  SegmentHeader header = {SEGMENT_MAGIC, sequence, eraseCount, 0};
+  header.crc = crc32(&header, offsetof(SegmentHeader, crc));
+  if (!storage->write(base, &header, sizeof(header)))
+    return false;
+  headSequence = sequence;
+  head.segment = segment;
+  head.offset = FIRST_RECORD;
+  return true;
+}
+
+// Reads the record at pos. Returns false at the end of the segment's data
+// (erased or unreadable header); `valid` is false on a CRC mismatch.
+bool TelemetryLog::readRecord(const Position &pos, TelemetrySample *sample,
+                              bool &sent, bool &valid, uint32_t &state) {
+  RecordHeader header;
+  if (pos.offset + RECORD_SIZE > segmentSize ||
+      !storage->read(address(pos), &header, sizeof(header))) {
+    state = RECORD_GARBAGE;
+    return false;
+  }
+  if (header.magic == 0xFFFF && header.length == 0xFFFF) {
+    state = RECORD_ERASED;
+    return false;
+  }
+  if (header.magic != RECORD_MAGIC ||
+      header.length != sizeof(TelemetrySample)) {
+    state = RECORD_GARBAGE;
+    return false;
+  }
+  state = RECORD_PRESENT;
+  sent = header.sent == SENT_MARKER;
+  TelemetrySample payload;
+  valid = storage->read(address(pos) + sizeof(header), &payload,
+                        sizeof(payload)) &&
+          crc32(&payload, sizeof(payload)) == header.crc;
+  if (valid && sample != NULL)
+    *sample = payload;
+  return true;
+}
+
+// Step to the following record slot, moving to the next segment when this
+// one is full or its data ended early. Returns false at the head.
+bool TelemetryLog::nextRecord(Position &pos) {
+  if (pos.segment == head.segment && pos.offset >= head.offset)
+    return false;
+  pos.offset += RECORD_SIZE;
+  if (pos.offset + RECORD_SIZE > segmentSize && pos.segment != head.segment) {
+    pos.segment = (pos.segment + 1) % segmentCount;
+    pos.offset = FIRST_RECORD;
+  }
+  return !(pos.segment == head.segment && pos.offset >= head.offset);
+}
+
+// Advance pos to the first unsent, intact record (or to the head)
+void TelemetryLog::skipSent(Position &pos) {
+  while (!(pos.segment == head.segment && pos.offset >= head.offset)) {
+    bool sent, valid;
+    uint32_t state;
+    if (!readRecord(pos, NULL, sent, valid, state)) {
+      if (pos.segment == head.segment)
+        break;
+      // Data in this segment ended early (torn write before a reboot)
+      pos.segment = (pos.segment + 1) % segmentCount;
+      pos.offset = FIRST_RECORD;
+      continue;
+    }
+    if (valid && !sent)
+      return;
+    nextRecord(pos);
+  }
+  pos = head;
+}
+
+uint32_t TelemetryLog::countPending(uint32_t segment) {
+  uint32_t count = 0;
+  Position pos = {segment, FIRST_RECORD};
+  bool sent, valid;
+  uint32_t state;
+  while (!(pos.segment == head.segment && pos.offset >= head.offset) &&
+         readRecord(pos, NULL, sent, valid, state)) {
+    if (valid && !sent)
+      count++;
+    pos.offset += RECORD_SIZE;
+  }
+  return count;
+}
+
+bool TelemetryLog::begin(FlashStorage *flash) {
+  storage = flash;
+  segmentSize = storage->sectorSize();
+  segmentCount = storage->size() / segmentSize;
+  pendingCount = 0;
+  logStats = TelemetryLogStats();
+  if (segmentCount < 3 || segmentSize < FIRST_RECORD + RECORD_SIZE)
+    return false;
+
+  // Find the newest and oldest segments by sequence number
+  bool found = false;
+  uint32_t newest = 0, oldest = 0;
+  uint32_t newestSeq = 0, oldestSeq = 0;
+  for (uint32_t s = 0; s < segmentCount; s++) {
+    SegmentHeader header;
+    if (!storage->read((size_t)s * segmentSize, &header, sizeof(header)) ||
+        !headerValid(header))
+      continue;
+    if (header.eraseCount > logStats.maxEraseCount)
+      logStats.maxEraseCount = header.eraseCount;
+    if (!found || header.sequence > newestSeq) {
+      newest = s;
+      newestSeq = header.sequence;
+    }
+    if (!found || header.sequence < oldestSeq) {
+      oldest = s;
+      oldestSeq = header.sequence;
+    }
+    found = true;
+  }
+
+  if (!found) {
+    if (!openSegment(0, 1))
+      return false;
+    tail = head;
+    return true;
+  }
+
+  // Find the write position in the newest segment
+  headSequence = newestSeq;
+  head.segment = newest;
+  head.offset = FIRST_RECORD;
+  bool sent, valid;
+  uint32_t state = RECORD_ERASED;
+  for (;;) {
+    if (!readRecord(head, NULL, sent, valid, state))
+      break;
+    head.offset += RECORD_SIZE;
+  }
+  if (state == RECORD_GARBAGE)
+    head.offset = segmentSize; // never write over a torn record
+
+  // Walk oldest -> newest counting what is still unsent
+  bool haveTail = false;
+  for (uint32_t s = oldest;; s = (s + 1) % segmentCount) {
+    Position pos = {s, FIRST_RECORD};
+    while (!(pos.segment == head.segment && pos.offset >= head.offset) &&
+           readRecord(pos, NULL, sent, valid, state)) {
+      if (!valid) {
+        logStats.corrupt++;
+      } else if (!sent) {
+        pendingCount++;
+        if (!haveTail) {
+          tail = pos;
+          haveTail = true;
+        }
+      }
+      pos.offset += RECORD_SIZE;
+    }
+    if (s == newest)
+      break;
+  }
+  if (!haveTail)
+    tail = head;
+  return true;
+}
+
+bool TelemetryLog::append(const TelemetrySample &sample) {
+  if (storage == NULL)
+    return false;
+
+  if (head.offset + RECORD_SIZE > segmentSize) {
+    uint32_t next = (head.segment + 1) % segmentCount;
+    if (pendingCount > 0 && tail.segment == next) {
+      // Ring is full: recycle the oldest segment and lose what it held
+      uint32_t dropped = countPending(next);
+      logStats.lost += dropped;
+      pendingCount -= dropped;
+      tail.segment = (next + 1) % segmentCount;
+      tail.offset = FIRST_RECORD;
+    }
+    if (!openSegment(next, headSequence + 1))
+      return false;
+    if (pendingCount > 0)
+      skipSent(tail);
+  }
+
+  uint8_t record[RECORD_SIZE];
+  memset(record, 0xFF, sizeof(record));
+  RecordHeader header = {RECORD_MAGIC, sizeof(TelemetrySample),
+                         crc32(&sample, sizeof(sample)), 0xFFFFFFFFu};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), &sample, sizeof(sample));
+  if (!storage->write(address(head), record, sizeof(record)))
+    return false;
+
+  if (pendingCount == 0)
+    tail = head;
+  head.offset += RECORD_SIZE;
+  pendingCount++;
+  logStats.appended++;
+  return true;
+}
+
+size_t TelemetryLog::peek(TelemetrySample *samples, size_t maxSamples) {
+  size_t n = 0;
+  Position pos = tail;
+  while (n < maxSamples &&
+         !(pos.segment == head.segment && pos.offset >= head.offset)) {
+    bool sent, valid;
+    uint32_t state;
+    if (!readRecord(pos, &samples[n], sent, valid, state)) {
+      if (pos.segment == head.segment)
+        break;
+      pos.segment = (pos.segment + 1) % segmentCount;
+      pos.offset = FIRST_RECORD;
+      continue;
+    }
+    if (valid && !sent)
+      n++;
+    nextRecord(pos);
+  }
+  return n;
+}
+
+void TelemetryLog::consume(size_t count) {
+  static const uint32_t sentMarker = SENT_MARKER;
+  while (count > 0 && pendingCount > 0) {
+    skipSent(tail);
+    if (tail.segment == head.segment && tail.offset >= head.offset)
+      break;
+    storage->write(address(tail) + offsetof(RecordHeader, sent), &sentMarker,
+                   sizeof(sentMarker));
+    pendingCount--;
+    logStats.replayed++;
+    count--;
+    nextRecord(tail);
+  }
+  if (pendingCount == 0)
+    tail = head;
+  else
+    skipSent(tail);
+}
@@ -0,0 +1,68 @@
+#include "telemetry_uplink.h"
+#include "config.h"
+#include "uploader.h"
+
+static TelemetryLog offlineLog;
+static bool logReady = false;
+static UplinkStats stats = {};
+static TelemetryBatch batch;
+static TelemetrySample replay[TELEMETRY_REPLAY_BATCH];
+static uint64_t lastReplayUs = 0;
+static uint64_t lastHealthUs = 0;
+
+bool uplinkInit(FlashStorage *storage) {
+  logReady = storage != NULL && offlineLog.begin(storage);
+  return storage == NULL || logReady;
+}
+
+static void logBatch() {
+  for (size_t i = 0; i < batch.size(); i++) {
+    if (logReady && offlineLog.append(batch.data()[i]))
+      stats.logged++;
+    else
+      stats.dropped++;
+  }
+}
+
+void uplinkPoll(TelemetryBuffer &buffer, bool paused, uint64_t nowUs) {
+  bool linkUp = !paused && uploaderReady();
+
+  if (batch.fill(buffer, nowUs)) {
+    if (linkUp && uploaderSendBatch(batch.data(), batch.size())) {
+      stats.sent += batch.size();
+    } else {
+      if (linkUp) {
+        stats.failures++;
+        linkUp = false; // don't pile a replay onto a failing link
+      }
+      logBatch();
+    }
+    batch.clear();
+  }
+
+  // Counters are cumulative: a report that fails is simply superseded
+  if (linkUp && nowUs - lastHealthUs >= HEALTH_REPORT_INTERVAL_MS * 1000ULL) {
+    lastHealthUs = nowUs;
+    uploaderSendHealth();
+  }
+
+  if (!linkUp || !logReady || offlineLog.pending() == 0 ||
+      nowUs - lastReplayUs < TELEMETRY_REPLAY_INTERVAL_MS * 1000ULL)
+    return;
+  lastReplayUs = nowUs;
+  size_t count = offlineLog.peek(replay, TELEMETRY_REPLAY_BATCH);
+  if (count == 0)
+    return;
+  if (uploaderSendBatch(replay, count)) {
+    offlineLog.consume(count);
+    stats.replayed += count;
+  } else {
+    stats.failures++;
+  }
+}
+
+UplinkStats uplinkStats() { return stats; }
+
+size_t uplinkBacklog() { return logReady ? offlineLog.pending() : 0; }
+
+TelemetryLogStats uplinkLogStats() { return offlineLog.stats(); }
@@ -0,0 +1,21 @@
+#include "timebase.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+uint32_t timebaseMillis() { return (uint32_t)(esp_timer_get_time() / 1000); }
+
+uint64_t timebaseMicros() { return (uint64_t)esp_timer_get_time(); }
+
+uint64_t timebaseEpochMs() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  if (now.tv_sec < 1600000000) // not synced yet
+    return 0;
+  return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+uint32_t timebaseCycles() { return ESP.getCycleCount(); }
+
+uint32_t timebaseCyclesPerUs() { return getCpuFrequencyMhz(); }
@@ -0,0 +1,41 @@
+#include "warning_rules.h"
+#include <math.h>
+
+// Triggered, or still holding within the hysteresis band once on
+static bool triggered(const Rule &rule, float reading, float threshold,
+                      bool on) {
+  switch (rule.test) {
+  case RULE_ABOVE_ABS:
+    return fabsf(reading) > (on ? threshold - rule.hysteresis : threshold);
+  case RULE_BELOW:
+    return reading < (on ? threshold + rule.hysteresis : threshold);
+  case RULE_IN_RANGE:
+    return reading > 0.0f &&
+           reading < (on ? threshold + rule.hysteresis : threshold);
+  }
+  return false;
+}
+
+WarningRules::WarningRules() : mask(0), onSinceUs() {}
+
+uint8_t WarningRules::evaluate(const SensorData &data,
+                               const RuntimeConfig &cfg, uint64_t nowUs,
+                               uint8_t usable) {
+  uint8_t next = 0;
+  for (size_t i = 0; i < RULE_COUNT; i++) {
+    const Rule &rule = WARNING_RULES[i];
+    uint8_t bit = 1u << i;
+    bool on = mask & bit;
+    if (!(usable & bit))
+      continue;
+    if (triggered(rule, data.*rule.reading, cfg.*rule.threshold, on)) {
+      if (!on)
+        onSinceUs[i] = nowUs;
+      next |= bit;
+    } else if (on && nowUs - onSinceUs[i] < rule.minOnMs * 1000ULL) {
+      next |= bit;
+    }
+  }
+  mask = next;
+  return mask;
+}
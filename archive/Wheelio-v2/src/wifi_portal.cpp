@@ -0,0 +1,37 @@
+#include "wifi_portal.h"
+#include "config.h"
+#include <WiFiManager.h>
+#include <atomic>
+
+static WiFiManager wm;
+static std::atomic<bool> requested(false);
+static std::atomic<uint8_t> state(WIFI_PORTAL_CLOSED);
+
+bool wifiPortalBegin() {
+  wm.setConfigPortalBlocking(false);
+  wm.setConfigPortalTimeout(WIFI_PORTAL_TIMEOUT_S);
+  wm.setConnectTimeout(WIFI_CONNECT_TIMEOUT_S);
+  // Non-blocking, a failed autoConnect leaves the portal running
+  bool connected = wm.autoConnect(WIFI_AP_NAME, WIFI_AP_PASSWORD);
+  state.store(connected ? WIFI_PORTAL_CONNECTED : WIFI_PORTAL_OPEN);
+  return connected;
+}
+
+void wifiPortalRequest() { requested.store(true); }
+
+WifiPortalState wifiPortalPoll() {
+  if (requested.exchange(false) && state.load() != WIFI_PORTAL_OPEN) {
+    wm.startConfigPortal(WIFI_AP_NAME, WIFI_AP_PASSWORD); // returns at once
+    state.store(WIFI_PORTAL_OPEN);
+  }
+  if (state.load() == WIFI_PORTAL_OPEN) {
+    // DNS and the web page; the page's WiFi scan is the slow part
+    if (wm.process())
+      state.store(WIFI_PORTAL_CONNECTED);
+    else if (!wm.getConfigPortalActive())
+      state.store(WIFI_PORTAL_TIMED_OUT);
+  }
+  return (WifiPortalState)state.load();
+}
+
+WifiPortalState wifiPortalState() { return (WifiPortalState)state.load(); }
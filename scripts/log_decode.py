@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Wheelio Log Decoder
+Turns the binary log frames written by the board (debug_log.h) back into
+text, using the message table in include/log_messages.h.
+
+    python3 scripts/log_decode.py capture.bin
+    python3 scripts/log_decode.py /dev/ttyUSB0 --baud 115200
+
+Bytes outside a valid frame (the boot banner, the EMA benchmark) are passed
+through as they are. Raw trace frames (raw_trace.h, TRACE_SINK 1) are left
+out of the text; --trace saves them for the native build's replay mode:
+
+    python3 scripts/log_decode.py capture.bin --trace ride.trace
+    .pio/build/native/program replay ride.trace
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0xA5
+HEADER = 8  # magic, message (u16), words (u8), timestamp (u32)
+TRACE_MAGIC = 0xB7
+TRACE_TYPES = 3
+TRACE_FRAME_MAX = 320
+LEVELS = {
+    "LOG_LEVEL_ERROR": "E",
+    "LOG_LEVEL_WARN": "W",
+    "LOG_LEVEL_INFO": "I",
+    "LOG_LEVEL_DEBUG": "D",
+}
+DEFAULT_TABLE = os.path.join(os.path.dirname(__file__), "..", "archive",
+                             "Wheelio-v2", "include", "log_messages.h")
+CONVERSION = re.compile(r"%[-+ #0-9.]*[hlz]*([a-zA-Z%])")
+
+
+def load_messages(path):
+    """Read X(id, level, "format") entries, in order, from log_messages.h"""
+    with open(path) as f:
+        text = f.read().replace("\\\n", " ")
+    entries = re.findall(r'X\(\s*(\w+),\s*(\w+),\s*"((?:[^"\\]|\\.)*)"\s*\)',
+                         text)
+    return [(name, LEVELS.get(level, "?"), fmt) for name, level, fmt in entries]
+
+
+def format_message(fmt, words, tail):
+    """Apply the C format to the argument words, in order"""
+    args = []
+    index = 0
+    for match in CONVERSION.finditer(fmt):
+        kind = match.group(1)
+        if kind == "%":
+            continue
+        if kind == "s":
+            args.append(tail.split(b"\0", 1)[0].decode("utf-8", "replace"))
+            continue
+        word = words[index] if index < len(words) else 0
+        index += 1
+        if kind in "di":
+            args.append(struct.unpack("<i", struct.pack("<I", word))[0])
+        elif kind in "fFgGeE":
+            args.append(struct.unpack("<f", struct.pack("<I", word))[0])
+        else:
+            args.append(word)
+    python_fmt = re.sub(r"(%[-+ #0-9.]*)[hlz]+", r"\1", fmt)
+    try:
+        return python_fmt % tuple(args)
+    except (TypeError, ValueError):
+        return "%s %r" % (fmt, args)
+
+
+def count_numbers(fmt):
+    """Argument words a format takes, strings excluded"""
+    return sum(1 for m in CONVERSION.finditer(fmt) if m.group(1) not in "%s")
+
+
+def trace_frame_size(buffer):
+    """Size of the trace frame at the start of buffer: 0 if it is not one,
+    None if more bytes are needed"""
+    if len(buffer) < 3:
+        return None
+    length = 0
+    pos = 2
+    for shift in (0, 7, 14):
+        if pos >= len(buffer):
+            return None
+        byte = buffer[pos]
+        pos += 1
+        length |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            break
+    else:
+        return 0
+    if buffer[1] >= TRACE_TYPES or length > TRACE_FRAME_MAX:
+        return 0
+    size = pos + length + 1
+    if len(buffer) < size:
+        return None
+    if zlib.crc32(bytes(buffer[1:size - 1])) & 0xFF != buffer[size - 1]:
+        return 0
+    return size
+
+
+class Decoder:
+    """Splits a byte stream into frames and pass-through text"""
+
+    def __init__(self, messages, out, trace=None):
+        self.messages = messages
+        self.out = out
+        self.trace = trace
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.last_us = None
+        self.wraps = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while self.buffer:
+            starts = [i for i in (self.buffer.find(MAGIC),
+                                  self.buffer.find(TRACE_MAGIC)) if i >= 0]
+            start = min(starts) if starts else -1
+            if start < 0:
+                self.text += self.buffer
+                self.buffer.clear()
+                break
+            self.text += self.buffer[:start]
+            del self.buffer[:start]
+            if self.buffer[0] == TRACE_MAGIC:
+                size = trace_frame_size(self.buffer)
+                if size is None:
+                    break
+                if size == 0:
+                    self.text.append(self.buffer.pop(0))
+                    continue
+                if self.trace:
+                    self.trace.write(self.buffer[:size])
+                del self.buffer[:size]
+                continue
+            if len(self.buffer) < HEADER:
+                break
+            message, words, timestamp = struct.unpack_from("<HBI",
+                                                           self.buffer, 1)
+            size = HEADER + 4 * words + 1
+            if message >= len(self.messages) or words > 10:
+                self.text.append(self.buffer.pop(0))
+                continue
+            if len(self.buffer) < size:
+                break
+            frame = bytes(self.buffer[:size])
+            if zlib.crc32(frame[1:-1]) & 0xFF != frame[-1]:
+                self.text.append(self.buffer.pop(0))
+                continue
+            del self.buffer[:size]
+            self.flush_text()
+            self.print_frame(message, words, timestamp, frame)
+
+    def flush_text(self):
+        if self.text:
+            self.out.write(self.text.decode("utf-8", "replace"))
+            self.text.clear()
+
+    def print_frame(self, message, words, timestamp, frame):
+        name, level, fmt = self.messages[message]
+        numbers = count_numbers(fmt)
+        payload = frame[HEADER:-1]
+        values = struct.unpack_from("<%dI" % min(numbers, words), payload)
+        tail = payload[4 * numbers:]
+        # The timestamp is 32-bit microseconds; it wraps every ~71 minutes
+        if self.last_us is not None and timestamp < self.last_us:
+            self.wraps += 1
+        self.last_us = timestamp
+        seconds = (self.wraps * 2 ** 32 + timestamp) / 1e6
+        self.out.write("%12.6f %s %s\n"
+                       % (seconds, level, format_message(fmt, values, tail)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("input", help="capture file or serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--messages", default=DEFAULT_TABLE,
+                        help="path to log_messages.h")
+    parser.add_argument("--trace", help="save raw trace frames to this file")
+    options = parser.parse_args()
+
+    trace = open(options.trace, "wb") if options.trace else None
+    decoder = Decoder(load_messages(options.messages), sys.stdout, trace)
+    if os.path.isfile(options.input):
+        with open(options.input, "rb") as f:
+            decoder.feed(f.read())
+    else:
+        import serial  # pyserial, only needed for live capture
+        port = serial.Serial(options.input, options.baud, timeout=0.1)
+        try:
+            while True:
+                decoder.feed(port.read(4096))
+                decoder.flush_text()
+                sys.stdout.flush()
+        except KeyboardInterrupt:
+            pass
+    decoder.flush_text()
+    if trace:
+        trace.close()
+
+
+if __name__ == "__main__":
+    main()
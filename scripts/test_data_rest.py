@@ -4,10 +4,13 @@ Test Data Generator for Wheelio Dashboard (REST API Version)
 Uses Firebase REST API instead of Admin SDK to avoid authentication issues
 """
 
+import os
+import re
 import requests
 import time
 import random
 import json
+from collections import namedtuple
 from datetime import datetime
 
 # Firebase configuration
@@ -36,73 +39,145 @@ def generate_sensor_data():
         "timestamp": int(time.time() * 1000)  # Milliseconds timestamp
     }
 
+# The rule table is read from the firmware sources, like log_decode.py reads
+# log_messages.h: WARNING_RULES from warning_rules.h, the default thresholds
+# and hysteresis from config.h, and the uploaded messages from control.cpp.
+FIRMWARE = os.path.join(os.path.dirname(__file__), "..", "archive",
+                        "Wheelio-v2")
+Rule = namedtuple("Rule", "bit sensor threshold test hysteresis min_on_ms "
+                          "actuators kind")
+
+def read_source(path):
+    with open(os.path.join(FIRMWARE, path)) as f:
+        return re.sub(r"//.*", "", f.read())
+
+def braced(text, name):
+    """The {...} initializer that follows `name` in a C++ source"""
+    start = text.index("{", text.index(name))
+    depth = 0
+    for end in range(start, len(text)):
+        depth += {"{": 1, "}": -1}.get(text[end], 0)
+        if depth == 0:
+            return text[start + 1:end]
+    raise ValueError("unterminated initializer for " + name)
+
+def load_defines(text):
+    """#define NAME value, for numeric values"""
+    return {name: float(int(value, 0)) if value.startswith("0x")
+            else float(value)
+            for name, value in re.findall(
+                r"^#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|-?[0-9.]+)[fF]?\s*$",
+                text, re.M)}
+
+RULE_TABLE = read_source("include/warning_rules.h")
+DEFINES = dict(load_defines(read_source("include/config.h")),
+               **load_defines(RULE_TABLE))
+FOG = int(DEFINES["ACTUATE_FOG"])
+WARNING_LIGHT = int(DEFINES["ACTUATE_WARNING_LIGHT"])
+BUZZER = int(DEFINES["ACTUATE_BUZZER"])
+
+def load_rules():
+    """WARNING_RULES as Rule tuples, with the firmware defaults filled in"""
+    # Upload keys of the SensorData fields, as telemetry_json.cpp writes them
+    sensors = {field: key for key, field in re.findall(
+        r'\.field\("(\w+)",\s*data\.(\w+)\)',
+        read_source("src/telemetry_json.cpp"))}
+    # RuntimeConfig fields and DEFAULTS line up by position
+    fields = re.findall(r"float\s+(\w+);",
+                        braced(read_source("include/runtime_config.h"),
+                               "struct RuntimeConfig"))
+    values = [v.strip() for v in braced(read_source("src/runtime_config.cpp"),
+                                        "DEFAULTS").split(",") if v.strip()]
+    defaults = {f: DEFINES.get(v) for f, v in zip(fields, values)}
+    kinds = re.findall(r"(WARNING_\w+)",
+                       braced(read_source("include/control.h"),
+                              "enum WarningKind"))
+
+    rules = []
+    rows = braced(RULE_TABLE, "WARNING_RULES[]")
+    for row in re.findall(r"\{([^{}]*)\}", rows):
+        bit, reading, threshold, test, hysteresis, min_on, acts, kind = (
+            v.strip() for v in row.split(","))
+        rules.append(Rule(
+            bit=len(rules),
+            sensor=sensors[reading.split("::")[1]],
+            threshold=defaults[threshold.split("::")[1]],
+            test=test,
+            hysteresis=DEFINES[hysteresis],
+            min_on_ms=DEFINES[min_on],
+            actuators=sum(int(DEFINES[a.strip()]) for a in acts.split("|")),
+            kind=kinds.index(kind)))
+    return rules
+
+def load_warning_messages():
+    """WARNING_MESSAGES from control.cpp, indexed by WarningKind"""
+    return re.findall(r'"([^"]*)"', braced(read_source("src/control.cpp"),
+                                           "WARNING_MESSAGES[]"))
+
+RULES = load_rules()
+WARNING_MESSAGES = load_warning_messages()
+
+def rules_driving(actuator):
+    return sum(1 << rule.bit for rule in RULES if rule.actuators & actuator)
+
+FOG_RULES = rules_driving(FOG)
+WARNING_LIGHT_RULES = rules_driving(WARNING_LIGHT)
+BUZZER_RULES = rules_driving(BUZZER)
+
+def warning_message(mask):
+    """warningMessage(): the message for the sensor groups in the mask"""
+    kind = 0
+    for rule in RULES:
+        if mask & (1 << rule.bit):
+            kind |= rule.kind
+    return WARNING_MESSAGES[kind]
+
+def rule_triggered(test, reading, threshold, hysteresis, on):
+    """The firmware's comparison, holding within the hysteresis once on"""
+    if test == "RULE_ABOVE_ABS":
+        return abs(reading) > (threshold - hysteresis if on else threshold)
+    if test == "RULE_BELOW":
+        return reading < (threshold + hysteresis if on else threshold)
+    # RULE_IN_RANGE: 0 means no target
+    return 0 < reading < (threshold + hysteresis if on else threshold)
+
+class RuleState:
+    """Rule mask and on times carried between samples, as on the device"""
+
+    def __init__(self):
+        self.mask = 0
+        self.on_since_ms = {}
+
+    def evaluate(self, sensors, now_ms):
+        mask = 0
+        for rule in RULES:
+            bit = 1 << rule.bit
+            on = bool(self.mask & bit)
+            if rule_triggered(rule.test, sensors[rule.sensor], rule.threshold,
+                              rule.hysteresis, on):
+                if not on:
+                    self.on_since_ms[rule.bit] = now_ms
+                mask |= bit
+            elif on and now_ms - self.on_since_ms[rule.bit] < rule.min_on_ms:
+                mask |= bit
+        self.mask = mask
+        return mask
+
+rule_state = RuleState()
+
 def calculate_actuators_and_warnings(sensor_data):
     """
-    Calculate actuator states and warning messages based on sensor thresholds
-    
-    Warning Rules:
-    - Side tilt > 30 degrees: buzzer + warning light
-    - Front/back tilt > 9 degrees: buzzer + warning light  
-    - Acceleration >= 2 m/s²: buzzer + warning light
-    - Lidar <= 1.50 meters: warning light only
-    
-    Automatic Features:
-    - Light < 1000 lux: fog light (automatic, not a warning)
+    Evaluate RULES once into a mask and derive the actuator states and the
+    warning message from it
     """
-    sensors = sensor_data["sensors"]
-    
-    # Initialize actuators
-    buzzer = False
-    warning_light = False
-    fog_light = False
-    warnings = []
-    
-    # Check side tilt (roll)
-    if abs(sensors["tilt_side"]) > 30:
-        buzzer = True
-        warning_light = True
-        warnings.append("Side tilt warning")
-    
-    # Check front/back tilt (pitch)
-    if abs(sensors["tilt_fb"]) > 9:
-        buzzer = True
-        warning_light = True
-        warnings.append("Pitch tilt warning")
-    
-    # Check acceleration
-    if abs(sensors["accel_x"]) >= 2.0:
-        buzzer = True
-        warning_light = True
-        warnings.append("High acceleration warning")
-    
-    # Check lidar distance (lidar now in centimeters)
-    if sensors["lidar"] <= 150:  # 150 cm = 1.50 meters
-        warning_light = True
-        warnings.append("Obstacle detected")
-    
-    # Check light level (fog light activates automatically, not a warning)
-    if sensors["light"] < 1000:
-        fog_light = True
-        # Note: Fog light activation is not a warning condition
-    
-    # Create warning message
-    if warnings:
-        if len(warnings) == 1:
-            warning_message = warnings[0]
-        else:
-            warning_message = " + ".join(warnings)
-    else:
-        warning_message = ""
-    
-    # Add actuators to sensor data
+    mask = rule_state.evaluate(sensor_data["sensors"], sensor_data["timestamp"])
     sensor_data["actuators"] = {
-        "buzzer": buzzer,
-        "warning_light": warning_light,
-        "fog_light": fog_light
+        "buzzer": bool(mask & BUZZER_RULES),
+        "warning_light": bool(mask & WARNING_LIGHT_RULES),
+        "fog_light": bool(mask & FOG_RULES)
     }
-    
-    sensor_data["warning"] = warning_message
-    
+    sensor_data["rules"] = mask
+    sensor_data["warning"] = warning_message(mask)
     return sensor_data
 
 def upload_to_firebase(data):
@@ -151,7 +226,7 @@ def create_test_scenarios():
         {
             "tilt_side": 5.0,
             "tilt_fb": 3.0,
-            "lidar": 120.0,  # 1.2 meters in centimeters
+            "lidar": 100.0,  # 1.0 meter in centimeters
             "light": 1300,
             "accel_x": 0.8
         },
@@ -187,13 +262,20 @@ def run_test_data_generator():
     print("🚀 Starting Wheelio Test Data Generator (REST API Version)")
     print(f"📊 Uploading to Firebase: {FIREBASE_URL}/{DATABASE_PATH}")
     print("⏱️  Upload interval: 1 second")
-    print("\n📋 Warning Rules:")
-    print("   • Side tilt > 30°: Buzzer + Warning Light")
-    print("   • Front/back tilt > 9°: Buzzer + Warning Light")
-    print("   • Acceleration ≥ 2 m/s²: Buzzer + Warning Light")
-    print("   • Lidar ≤ 1.50m: Warning Light")
-    print("\n💡 Automatic Features:")
-    print("   • Light < 1000 lux: Fog Light (visibility aid)")
+    print("\n📋 Rules:")
+    units = {"lidar": "cm", "tilt_side": "°", "tilt_fb": "°",
+             "accel_x": " m/s²", "light": " lux"}
+    ops = {"RULE_ABOVE_ABS": "|{}| >", "RULE_BELOW": "{} <",
+           "RULE_IN_RANGE": "{} <"}
+    names = [(BUZZER, "Buzzer"), (WARNING_LIGHT, "Warning Light"),
+             (FOG, "Fog Light")]
+    for rule in RULES:
+        outputs = " + ".join(label for flag, label in names
+                             if rule.actuators & flag)
+        test = ops[rule.test].format(rule.sensor)
+        message = WARNING_MESSAGES[rule.kind] if rule.kind else "not a warning"
+        print(f"   • {test} {rule.threshold:g}{units[rule.sensor]}: "
+              f"{outputs} ({message})")
     print("\n" + "="*50)
     
     # Test connection first
@@ -258,7 +340,7 @@ def run_test_data_generator():
                   f"Warning: {'⚠️  ON ' if actuators['warning_light'] else '✅ OFF'} | "
                   f"Fog: {'🌫️  ON ' if actuators['fog_light'] else '☀️  OFF'}")
             
-            if warning:
+            if warning != WARNING_MESSAGES[0]:
                 print(f"⚠️  Warning: {warning}")
             else:
                 print("✅ Status: All systems normal")